@@ -0,0 +1,156 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <algorithm>
+
+#include "../src/BPlusTreeIndex.h"
+#include "../src/BlockIndexFile.h"
+
+/**
+ * Test program for the B+tree index set
+ *
+ * Nodes of 32 bytes hold three entries, so a few hundred entries already give a tree
+ * of several levels. Entries are inserted and removed in random order and after each
+ * step every key, every gap between keys and the key above the last one is looked up
+ * and compared with a std::map of the same entries:
+ *   - insertEntry splits leaves and internal nodes up to a new root
+ *   - removeEntry frees emptied nodes and collapses single child roots, down to one
+ *     leaf once one entry is left (underfull nodes are not merged)
+ *   - updateEntry moves a block's highest key
+ *   - create bulk loads and a closed tree reopens with the same entries
+ */
+
+const char* TREE_FILE = "BPlusTreeIndexTest.bpt";
+const uint32_t NODE_SIZE = 32; // (32 - 8) / 8 = 3 entries per node
+const uint32_t NOT_FOUND = static_cast<uint32_t>(-1);
+
+static int failures = 0;
+
+static void check(const bool condition, const std::string& what)
+{
+    if (!condition)
+    {
+        std::cerr << "  FAILED: " << what << "\n";
+        ++failures;
+    }
+}
+
+/**
+ * @brief Compare every lookup of the tree with the model
+ * @return True if every lookup matched
+ */
+static bool matchesModel(BPlusTreeIndex& tree, const std::map<uint32_t, uint32_t>& model)
+{
+    if (tree.getEntryCount() != model.size()) return false;
+    if (tree.getTailRBN() != (model.empty() ? 0 : model.rbegin()->second)) return false;
+    uint32_t below = 0;
+    for (const auto& entry : model)
+    {
+        // The key itself and every key between it and the one below route to its block
+        if (tree.findRBNForKey(entry.first) != entry.second) return false;
+        if (entry.first > below + 1 && tree.findRBNForKey(below + 1) != entry.second) return false;
+        below = entry.first;
+    }
+    return tree.findRBNForKey(below + 1) == NOT_FOUND;
+}
+
+int main()
+{
+    std::cout << "=== B+Tree Index Set Test Program ===\n\n";
+    std::mt19937 rng(4004);
+
+    // Test 1: inserts into an empty tree split up to a new root
+    std::cout << "--- Test 1: Insert And Split ---\n";
+    BPlusTreeIndex tree;
+    if (!tree.create(TREE_FILE, NODE_SIZE, {}))
+    {
+        std::cerr << "Failed to create " << TREE_FILE << ": " << tree.getLastError() << "\n";
+        return 1;
+    }
+    std::vector<uint32_t> keys;
+    for (uint32_t i = 1; i <= 400; ++i) keys.push_back(i * 10);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    std::map<uint32_t, uint32_t> model;
+    bool inOrder = true;
+    for (const uint32_t key : keys)
+    {
+        const uint32_t rbn = key / 10 + 1000;
+        check(tree.insertEntry(key, rbn), "insert of " + std::to_string(key));
+        model[key] = rbn;
+        if (model.size() % 25 == 0 && !matchesModel(tree, model)) inOrder = false;
+    }
+    check(inOrder && matchesModel(tree, model), "lookups after the inserts");
+    std::cout << "400 entries inserted, height " << tree.getHeight() << "\n";
+    check(tree.getHeight() >= 5, "splits raised the tree to at least 5 levels");
+
+    // Test 2: reopening keeps every entry
+    std::cout << "--- Test 2: Close And Reopen ---\n";
+    tree.close();
+    check(tree.open(TREE_FILE), "reopen");
+    check(matchesModel(tree, model), "lookups after reopening");
+
+    // Test 3: highest key changes, the tail key included
+    std::cout << "--- Test 3: Update ---\n";
+    check(tree.updateEntry(2000, 2005, model[2000]), "update of 2000 to 2005");
+    model[2005] = model[2000];
+    model.erase(2000);
+    check(tree.updateEntry(4000, 4001, model[4000]), "update of the tail key");
+    model[4001] = model[4000];
+    model.erase(4000);
+    check(!tree.updateEntry(12345, 12346, 1), "update of a missing key fails");
+    check(matchesModel(tree, model), "lookups after the updates");
+
+    // Test 4: removals free nodes and collapse the root down to one leaf
+    std::cout << "--- Test 4: Remove And Collapse ---\n";
+    std::vector<std::pair<uint32_t, uint32_t>> entries(model.begin(), model.end());
+    std::shuffle(entries.begin(), entries.end(), rng);
+    inOrder = true;
+    for (size_t i = 0; i + 1 < entries.size(); ++i)
+    {
+        check(tree.removeEntry(entries[i].first, entries[i].second), "remove of " + std::to_string(entries[i].first));
+        model.erase(entries[i].first);
+        if (model.size() % 25 == 0 && !matchesModel(tree, model)) inOrder = false;
+    }
+    check(!tree.removeEntry(entries.front().first, entries.front().second), "second remove of a key fails");
+    check(inOrder && matchesModel(tree, model), "lookups after the removals");
+    std::cout << model.size() << " entries left, height " << tree.getHeight() << "\n";
+    check(tree.getHeight() == 1, "root collapsed to a single leaf");
+
+    check(tree.removeEntry(entries.back().first, entries.back().second), "remove of the last entry");
+    model.clear();
+    check(tree.getHeight() == 0 && tree.getEntryCount() == 0 && tree.getTailRBN() == 0, "empty tree");
+    check(tree.findRBNForKey(10) == NOT_FOUND, "lookup in an empty tree");
+
+    // Test 5: the emptied tree grows again
+    std::cout << "--- Test 5: Regrow ---\n";
+    for (uint32_t i = 1; i <= 50; ++i)
+    {
+        check(tree.insertEntry(i * 7, i), "reinsert of " + std::to_string(i * 7));
+        model[i * 7] = i;
+    }
+    check(matchesModel(tree, model), "lookups after regrowing");
+    tree.close();
+
+    // Test 6: bulk load matches incremental inserts
+    std::cout << "--- Test 6: Bulk Load ---\n";
+    std::vector<IndexEntry> sorted;
+    for (const auto& entry : model) sorted.push_back(IndexEntry{entry.first, entry.second});
+    BPlusTreeIndex loaded;
+    check(loaded.create(TREE_FILE, NODE_SIZE, sorted), "bulk load");
+    check(matchesModel(loaded, model), "lookups after the bulk load");
+    loaded.close();
+
+    std::remove(TREE_FILE);
+    if (failures > 0)
+    {
+        std::cout << "\n=== " << failures << " Checks Failed ===\n";
+        return 1;
+    }
+    std::cout << "\n=== All Tests Passed! ===\n";
+    return 0;
+}
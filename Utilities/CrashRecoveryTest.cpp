@@ -0,0 +1,346 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+
+#include "../src/CSVBuffer.h"
+#include "../src/HeaderBuffer.h"
+#include "../src/HeaderRecord.h"
+#include "../src/BlockBuffer.h"
+#include "../src/ZipCodeRecordView.h"
+#include "../src/BlockIndexFile.h"
+#include "../src/BPlusTreeIndex.h"
+#include "../src/FreeSpaceMap.h"
+#include "../src/WriteAheadLog.h"
+#include "../src/MappedFile.h"
+
+#if ZCD_HAS_MMAP
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Kill and recover test for the add, del and recover commands of the zcd utility
+ *
+ * The CSV is converted to a blocked file with small blocks. Each round deletes a batch of
+ * its keys or adds a batch of deleted ones back, and kills the utility (SIGKILL) after a
+ * random delay: before it opened its write-ahead log, mid-batch, or after checkpoints
+ * already emptied the log. A reader (range) then runs against the crashed file, and the
+ * crash is cleaned up either by recover or by running the same batch again. reorganize
+ * must refuse the crashed file while its stale flag is set or its log is not empty, and
+ * rewrite it otherwise. After every step the file must have:
+ *   - the stale flag clear
+ *   - sequence set keys strictly ascending
+ *   - a flat index and a B+tree index set that both match the highest key of every block
+ *   - once the batch has run again, exactly the keys expected
+ *
+ * The flat index named in the header (data/zipcode_data.idx) is overwritten, run it from a
+ * scratch directory.
+ *
+ * Usage: CrashRecoveryTest [zcd] [file.csv] [rounds] [batch]
+ *        (default ./zcd data/PT2_Randomized.csv 16 2000)
+ */
+
+const char* TEST_FILE = "CrashRecoveryTest.zcb";
+const char* BATCH_FILE = "CrashRecoveryTest.batch";
+const char* BLOCK_SIZE = "512";
+
+#if ZCD_HAS_MMAP
+
+/**
+ * @brief Run the utility with its output discarded
+ * @param killAfter [IN] Send SIGKILL after this long, negative to let it finish
+ * @param killed [OUT] True if the kill stopped it before it exited
+ * @return Exit status, -1 if it did not exit normally
+ */
+static int runUtility(const std::vector<std::string>& args, const std::chrono::microseconds killAfter, bool& killed)
+{
+    killed = false;
+    const pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0)
+    {
+        const int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0)
+        {
+            dup2(devNull, STDOUT_FILENO);
+            dup2(devNull, STDERR_FILENO);
+        }
+        std::vector<char*> argv;
+        for (const std::string& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    if (killAfter.count() >= 0)
+    {
+        std::this_thread::sleep_for(killAfter);
+        kill(pid, SIGKILL);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (WIFSIGNALED(status))
+    {
+        killed = WTERMSIG(status) == SIGKILL;
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * @brief Check the chain and both indexes of the test file
+ * @param expected [IN] Keys the file must hold, sorted, nullptr to skip the check
+ * @return True if the file is consistent
+ */
+static bool verifyFile(const std::vector<uint32_t>* expected)
+{
+    HeaderRecord header;
+    HeaderBuffer headerBuffer;
+    if (!headerBuffer.readHeader(TEST_FILE, header))
+    {
+        std::cerr << "  cannot read the header: " << headerBuffer.getLastError() << "\n";
+        return false;
+    }
+    if (header.getStaleFlag())
+    {
+        std::cerr << "  stale flag still set\n";
+        return false;
+    }
+
+    BlockIndexFile chain;
+    if (!chain.createIndexFromBlockedFile(TEST_FILE, header.getBlockSize(), header.getHeaderSize(),
+                                          header.getSequenceSetListRBN()))
+    {
+        std::cerr << "  cannot walk the sequence set\n";
+        return false;
+    }
+
+    BlockBuffer blocks;
+    if (!blocks.openFile(TEST_FILE, header.getHeaderSize()))
+    {
+        std::cerr << "  cannot open " << TEST_FILE << "\n";
+        return false;
+    }
+    blocks.setRecordFormat(header.getSizeFormatType());
+    std::vector<uint32_t> keys;
+    bool ascending = true;
+    blocks.scanRange(header.getSequenceSetListRBN(), 0, UINT32_MAX, header.getBlockSize(), header.getHeaderSize(), 0, 0,
+                     [&keys, &ascending](const ZipCodeRecordView& view)
+                     {
+                         if (!keys.empty() && view.getZipCode() <= keys.back()) ascending = false;
+                         keys.push_back(view.getZipCode());
+                         return true;
+                     });
+    blocks.closeFile();
+    if (!ascending)
+    {
+        std::cerr << "  sequence set keys out of order\n";
+        return false;
+    }
+
+    BlockIndexFile flat;
+    if (!flat.read(header.getIndexFileName()) || flat.getEntryCount() != chain.getEntryCount())
+    {
+        std::cerr << "  flat index missing or of the wrong size\n";
+        return false;
+    }
+    BPlusTreeIndex tree;
+    if (!tree.open(BPlusTreeIndex::pathFor(TEST_FILE)) || tree.getEntryCount() != chain.getEntryCount())
+    {
+        std::cerr << "  index set missing or of the wrong size\n";
+        return false;
+    }
+    for (size_t i = 0; i < chain.getEntryCount(); ++i)
+    {
+        const IndexEntry& entry = chain.getEntries()[i];
+        if (flat.getEntries()[i].key != entry.key || flat.getEntries()[i].recordRBN != entry.recordRBN)
+        {
+            std::cerr << "  flat index entry " << i << " does not match block " << entry.recordRBN << "\n";
+            return false;
+        }
+        if (tree.findRBNForKey(entry.key) != entry.recordRBN)
+        {
+            std::cerr << "  index set routes " << entry.key << " away from block " << entry.recordRBN << "\n";
+            return false;
+        }
+    }
+    if (chain.getEntryCount() > 0 && tree.getTailRBN() != chain.getEntries().back().recordRBN)
+    {
+        std::cerr << "  index set tail is not the last block\n";
+        return false;
+    }
+    tree.close();
+
+    if (expected != nullptr && keys != *expected)
+    {
+        std::cerr << "  " << keys.size() << " keys in the file, " << expected->size() << " expected\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Check whether an add or del left the test file unfinished
+ * @return True if the stale flag is set or the write-ahead log is not empty
+ */
+static bool unfinished()
+{
+    HeaderRecord header;
+    HeaderBuffer headerBuffer;
+    if (!headerBuffer.readHeader(TEST_FILE, header)) return true;
+    std::ifstream log(WriteAheadLog::pathFor(TEST_FILE), std::ios::binary | std::ios::ate);
+    return header.getStaleFlag() || (log && log.tellg() > 0);
+}
+
+/**
+ * @brief Write a batch for add (CSV lines) or del (one key per line)
+ */
+static bool writeBatch(const std::vector<ZipCodeRecord>& batch, const bool deleting)
+{
+    std::ofstream out(BATCH_FILE);
+    for (const ZipCodeRecord& rec : batch)
+    {
+        if (deleting)
+        {
+            out << rec.getZipCode() << "\n";
+            continue;
+        }
+        out << rec.getZipCode() << ",\"" << rec.getLocationName() << "\"," << rec.getState() << ",\""
+            << rec.getCounty() << "\"," << rec.getLatitude() << "," << rec.getLongitude() << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string zcd = argc > 1 ? argv[1] : "./zcd";
+    const std::string path = argc > 2 ? argv[2] : "data/PT2_Randomized.csv";
+    const size_t rounds = argc > 3 ? static_cast<size_t>(std::stoul(argv[3])) : 16;
+    const size_t batchSize = argc > 4 ? static_cast<size_t>(std::stoul(argv[4])) : 2000;
+
+    CSVBuffer csv;
+    if (!csv.openFile(path))
+    {
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    std::vector<ZipCodeRecord> present;
+    ZipCodeRecord record;
+    while (csv.getNextRecord(record)) present.push_back(record);
+    csv.closeFile();
+    std::vector<ZipCodeRecord> absent;
+
+    std::cout << "=== Kill And Recover Test ===\n";
+    std::cout << path << ": " << present.size() << " records, " << BLOCK_SIZE << " byte blocks, "
+              << rounds << " rounds of " << batchSize << " keys\n\n";
+
+    std::remove(WriteAheadLog::pathFor(TEST_FILE).c_str());
+    bool killed = false;
+    if (runUtility({zcd, "convert-blocked", path, TEST_FILE, BLOCK_SIZE, "256", "binary"},
+                   std::chrono::microseconds(-1), killed) != 0)
+    {
+        std::cerr << "convert-blocked failed\n";
+        return 1;
+    }
+
+    std::mt19937 rng(20240611);
+    std::chrono::microseconds lastRun(200000);
+    size_t kills = 0, failures = 0;
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        // Delete on even rounds, add back on odd ones
+        const bool deleting = round % 2 == 0 || absent.empty();
+        std::vector<ZipCodeRecord>& from = deleting ? present : absent;
+        std::vector<ZipCodeRecord>& to = deleting ? absent : present;
+        std::shuffle(from.begin(), from.end(), rng);
+        const size_t count = std::min(batchSize, from.size());
+        std::vector<ZipCodeRecord> batch(from.end() - count, from.end());
+        from.resize(from.size() - count);
+        to.insert(to.end(), batch.begin(), batch.end());
+        if (!writeBatch(batch, deleting))
+        {
+            std::cerr << "Cannot write " << BATCH_FILE << "\n";
+            return 1;
+        }
+        const std::vector<std::string> command = {zcd, deleting ? "del" : "add", TEST_FILE, BATCH_FILE};
+
+        const std::chrono::microseconds delay(std::uniform_int_distribution<long long>(0, lastRun.count())(rng));
+        runUtility(command, delay, killed);
+        if (killed) ++kills;
+        std::cout << "Round " << round << ": " << (deleting ? "del" : "add") << " of " << count << " keys "
+                  << (killed ? "killed" : "finished") << " after " << delay.count() / 1000 << " ms\n";
+
+        // A reader must neither fail nor replay the log behind the next writer
+        if (runUtility({zcd, "range", TEST_FILE, "0", "99999", "10"}, std::chrono::microseconds(-1), killed) != 0)
+        {
+            std::cerr << "  range failed on the crashed file\n";
+            ++failures;
+        }
+
+        // Rewriting the file would drop the blocks its log still holds
+        const bool refuse = unfinished();
+        if ((runUtility({zcd, "reorganize", TEST_FILE}, std::chrono::microseconds(-1), killed) != 0) != refuse)
+        {
+            std::cerr << "  reorganize " << (refuse ? "rewrote an unfinished" : "refused a finished") << " file\n";
+            ++failures;
+        }
+
+        if (round % 4 < 2)
+        {
+            if (runUtility({zcd, "recover", TEST_FILE}, std::chrono::microseconds(-1), killed) != 0 || !verifyFile(nullptr))
+            {
+                std::cerr << "  recover left the file inconsistent\n";
+                ++failures;
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (runUtility(command, std::chrono::microseconds(-1), killed) != 0)
+        {
+            std::cerr << "  " << command[1] << " failed when run again\n";
+            ++failures;
+        }
+        lastRun = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        std::vector<uint32_t> expected;
+        for (const ZipCodeRecord& rec : present) expected.push_back(rec.getZipCode());
+        std::sort(expected.begin(), expected.end());
+        if (!verifyFile(&expected))
+        {
+            std::cerr << "  file inconsistent after " << command[1] << " ran again\n";
+            ++failures;
+        }
+    }
+
+    std::cout << "\n" << kills << " of " << rounds << " runs killed, " << failures << " failures\n";
+    if (failures == 0)
+    {
+        std::remove(TEST_FILE);
+        std::remove(BATCH_FILE);
+        std::remove(WriteAheadLog::pathFor(TEST_FILE).c_str());
+        std::remove(BPlusTreeIndex::pathFor(TEST_FILE).c_str());
+        std::remove(FreeSpaceMap::pathFor(TEST_FILE).c_str());
+        std::cout << "\n=== All Tests Passed! ===\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+#else // !ZCD_HAS_MMAP
+
+int main()
+{
+    std::cerr << "The write-ahead log is not supported on this platform, nothing to test\n";
+    return 1;
+}
+
+#endif // ZCD_HAS_MMAP
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <random>
+#include <filesystem>
+
+#include "../src/ExternalSorter.h"
+#include "../src/ZipCodeRecord.h"
+
+/**
+ * Test program for the external sorter
+ *
+ * Records carry their insertion number in the place name, so both the zip order and
+ * the order of equal zips can be checked. With the smallest budget (256 KiB, four run
+ * buffers) 200k records spill many more runs than one merge takes, so runs are merged
+ * into longer runs over more than one pass before the final merge:
+ *   - every record comes back once, in zip order, equal zips in the order added
+ *   - a sort that fits the budget is returned from memory without run files
+ *   - close() removes every run file
+ */
+
+const std::string RUN_PREFIX = "ExternalSorterTest";
+const size_t MERGE_FAN_IN = ExternalSorter::MIN_MEMORY_BUDGET / ExternalSorter::RUN_BUFFER_BYTES;
+
+static int failures = 0;
+
+static void check(const bool condition, const std::string& what)
+{
+    if (!condition)
+    {
+        std::cerr << "  FAILED: " << what << "\n";
+        ++failures;
+    }
+}
+
+/**
+ * @brief Sort records and check the order they come back in
+ * @param zips [IN] Zip of record i, its place name is "P<i>"
+ * @return Run files written
+ */
+static size_t sortAndCheck(const std::vector<uint32_t>& zips, const size_t budget)
+{
+    ExternalSorter sorter;
+    sorter.open(RUN_PREFIX, budget);
+    for (size_t i = 0; i < zips.size(); ++i)
+    {
+        ZipCodeRecord record(static_cast<int>(zips[i]), 45.0, -93.0, "P" + std::to_string(i), "MN", "Hennepin");
+        if (!sorter.add(record))
+        {
+            check(false, "add: " + sorter.getLastError());
+            return 0;
+        }
+    }
+    check(sorter.finish(), "finish");
+
+    size_t count = 0;
+    uint32_t lastZip = 0;
+    size_t lastIndex = 0;
+    bool ordered = true, intact = true;
+    ZipCodeRecord record;
+    while (sorter.next(record))
+    {
+        const size_t index = std::stoul(record.getLocationName().substr(1));
+        if (index >= zips.size() || zips[index] != record.getZipCode() || record.getCounty() != "Hennepin") intact = false;
+        if (count > 0 && (record.getZipCode() < lastZip || (record.getZipCode() == lastZip && index < lastIndex)))
+            ordered = false;
+        lastZip = record.getZipCode();
+        lastIndex = index;
+        ++count;
+    }
+    check(!sorter.hasError(), "no error while merging: " + sorter.getLastError());
+    check(count == zips.size(), "every record returned once");
+    check(intact, "records returned unchanged");
+    check(ordered, "zip order, equal zips in the order added");
+
+    const size_t runs = sorter.getRunCount();
+    sorter.close();
+    bool leftover = false;
+    for (const auto& entry : std::filesystem::directory_iterator("."))
+    {
+        if (entry.path().filename().string().rfind(RUN_PREFIX + ".run", 0) == 0) leftover = true;
+    }
+    check(!leftover, "close removed the run files");
+    return runs;
+}
+
+int main()
+{
+    std::cout << "=== External Sorter Test Program ===\n\n";
+    std::mt19937 rng(4004);
+
+    // Test 1: many runs, merged in more than one pass
+    std::cout << "--- Test 1: Multi-Pass Merge ---\n";
+    std::vector<uint32_t> zips(200000);
+    std::uniform_int_distribution<uint32_t> zip(1, 5000); // Plenty of equal zips
+    for (uint32_t& z : zips) z = zip(rng);
+    const size_t runs = sortAndCheck(zips, ExternalSorter::MIN_MEMORY_BUDGET);
+    std::cout << zips.size() << " records, " << runs << " runs, " << MERGE_FAN_IN << " merged at a time\n";
+    check(runs > MERGE_FAN_IN * MERGE_FAN_IN, "enough runs for more than one merge pass");
+
+    // Test 2: a smaller budget is raised to the minimum
+    std::cout << "--- Test 2: Budget Below The Minimum ---\n";
+    check(sortAndCheck(zips, 1024) == runs, "same runs as the minimum budget");
+
+    // Test 3: sorted and reversed input
+    std::cout << "--- Test 3: Sorted And Reversed Input ---\n";
+    std::vector<uint32_t> ascending(30000), descending(30000);
+    for (size_t i = 0; i < ascending.size(); ++i)
+    {
+        ascending[i] = static_cast<uint32_t>(i / 3 + 1);
+        descending[i] = static_cast<uint32_t>(ascending.size() - i);
+    }
+    sortAndCheck(ascending, ExternalSorter::MIN_MEMORY_BUDGET);
+    sortAndCheck(descending, ExternalSorter::MIN_MEMORY_BUDGET);
+
+    // Test 4: everything fits, nothing spilled
+    std::cout << "--- Test 4: In Memory ---\n";
+    std::vector<uint32_t> few(1000);
+    for (uint32_t& z : few) z = zip(rng);
+    check(sortAndCheck(few, ExternalSorter::DEFAULT_MEMORY_BUDGET) == 0, "no run written");
+    check(sortAndCheck({}, ExternalSorter::DEFAULT_MEMORY_BUDGET) == 0, "empty sort");
+
+    if (failures > 0)
+    {
+        std::cout << "\n=== " << failures << " Checks Failed ===\n";
+        return 1;
+    }
+    std::cout << "\n=== All Tests Passed! ===\n";
+    return 0;
+}
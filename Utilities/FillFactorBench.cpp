@@ -0,0 +1,171 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+
+#include "../src/CSVBuffer.h"
+#include "../src/HeaderRecord.h"
+#include "../src/BlockBuffer.h"
+#include "../src/BlockIndexFile.h"
+#include "../src/BulkLoader.h"
+#include "../src/RecordBuffer.h"
+
+/**
+ * Benchmark for the bulk load fill factor against later single record inserts
+ *
+ * The CSV's records are shuffled with a fixed seed and the last [inserts] of them held
+ * out. The rest are bulk loaded (BulkLoader) at each fill factor, then the held out
+ * records are added one at a time with BlockBuffer::addRecord, routed through the
+ * flat index kept in step with getIndexChanges, as the add command would. Reported
+ * per 10k inserts:
+ *   - splits : blocks added to the sequence set
+ *   - writes : block images written, shifts into neighbours and splits included; the
+ *              buffer pool is flushed after every insert so each one is counted
+ *
+ * Usage: FillFactorBench [file.csv] [blockSize] [inserts] [reserveBytes]
+ *        (default data/PT2_Randomized.csv 1024 10000 0)
+ */
+
+const double FILL_FACTORS[] = {0.70, 0.85, 1.00};
+const char* BENCH_FILE = "FillFactorBench.zcb";
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Header of a blocked file as convert-blocked writes it
+ */
+static HeaderRecord benchHeader(uint32_t blockSize, double fillFactor, uint16_t reserve)
+{
+    HeaderRecord header;
+    header.setFileStructureType("ZIPC");
+    header.setVersion(3);
+    header.setHeaderSize(0);
+    header.setSizeFormatType(RecordBuffer::BINARY_RECORDS);
+    header.setBlockSize(blockSize);
+    header.setMinBlockSize(256);
+    header.setIndexFileName("");
+    header.setIndexFileSchemaInfo("Primary Key: Zipcode");
+    header.setRecordCount(0);
+    header.setBlockCount(0);
+    header.setFields({{"zipcode", 1}, {"location", 3}, {"state", 4}, {"county", 3}, {"latitude", 2}, {"longitude", 2}});
+    header.setFieldCount(CSVBuffer::EXPECTED_FIELD_COUNT);
+    header.setPrimaryKeyField(0);
+    header.setAvailableListRBN(0);
+    header.setSequenceSetListRBN(1);
+    header.setStaleFlag(0);
+    header.setFillSettings(static_cast<uint8_t>(fillFactor * 100 + 0.5), reserve);
+    return header;
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string path = argc > 1 ? argv[1] : "data/PT2_Randomized.csv";
+    const uint32_t blockSize = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 1024;
+    size_t inserts = argc > 3 ? static_cast<size_t>(std::stoull(argv[3])) : 10000;
+    const uint16_t reserve = argc > 4 ? static_cast<uint16_t>(std::stoul(argv[4])) : 0;
+
+    CSVBuffer csv;
+    if (!csv.openFile(path))
+    {
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    std::vector<ZipCodeRecord> records;
+    ZipCodeRecord record;
+    while (csv.getNextRecord(record)) records.push_back(record);
+    csv.closeFile();
+
+    // One record per zip, addRecord does not expect duplicates
+    std::stable_sort(records.begin(), records.end(),
+                     [](const ZipCodeRecord& a, const ZipCodeRecord& b) { return a.getZipCode() < b.getZipCode(); });
+    records.erase(std::unique(records.begin(), records.end(),
+                              [](const ZipCodeRecord& a, const ZipCodeRecord& b) { return a.getZipCode() == b.getZipCode(); }),
+                  records.end());
+
+    std::mt19937 rng(12345);
+    std::shuffle(records.begin(), records.end(), rng);
+    inserts = std::min(inserts, records.size() / 2);
+    std::vector<ZipCodeRecord> held(records.end() - inserts, records.end());
+    std::vector<ZipCodeRecord> loaded(records.begin(), records.end() - inserts);
+    std::sort(loaded.begin(), loaded.end(),
+              [](const ZipCodeRecord& a, const ZipCodeRecord& b) { return a.getZipCode() < b.getZipCode(); });
+
+    std::cout << "=== Bulk Load Fill Factor Benchmark ===\n";
+    std::cout << path << ": " << loaded.size() << " records loaded, " << inserts << " inserted one at a time, "
+              << blockSize << " byte blocks, reserve " << reserve << " bytes\n\n";
+    std::cout << "fill\tloaded blocks\tfinal blocks\tsplits/10k\twrites/10k\tinsert ms\n";
+
+    const double per10k = 10000.0 / inserts;
+    for (const double fillFactor : FILL_FACTORS)
+    {
+        HeaderRecord header = benchHeader(blockSize, fillFactor, reserve);
+        const std::vector<uint8_t> headerBytes = header.serialize();
+
+        BulkLoader loader;
+        loader.setRecordFormat(RecordBuffer::BINARY_RECORDS);
+        loader.setFillFactor(fillFactor);
+        loader.setBlockReserve(reserve);
+        size_t next = 0;
+        auto nextRecord = [&loaded, &next](ZipCodeRecord& out)
+        {
+            if (next >= loaded.size()) return false;
+            out = loaded[next++];
+            return true;
+        };
+        if (!loader.load(BENCH_FILE, headerBytes, blockSize, nextRecord))
+        {
+            std::cerr << "Load failed: " << loader.getLastError() << "\n";
+            return 1;
+        }
+
+        BlockIndexFile index;
+        for (const IndexEntry& entry : loader.getIndexEntries()) index.addIndexEntry(entry);
+        index.buildSearchLayout();
+
+        BlockBuffer blocks;
+        if (!blocks.openFile(BENCH_FILE, headerBytes.size()))
+        {
+            std::cerr << "Cannot open " << BENCH_FILE << "\n";
+            return 1;
+        }
+        blocks.setRecordFormat(RecordBuffer::BINARY_RECORDS);
+
+        const uint32_t loadedBlocks = loader.getBlockCount();
+        uint32_t blockCount = loadedBlocks;
+        uint32_t availListRBN = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const ZipCodeRecord& rec : held)
+        {
+            uint32_t rbn = index.findRBNForKey(rec.getZipCode());
+            if (rbn == static_cast<uint32_t>(-1)) rbn = index.getTailRBN(); // Above every key
+            if (!blocks.addRecord(rbn, blockSize, availListRBN, rec, headerBytes.size(), blockCount))
+            {
+                std::cerr << "Insert of " << rec.getZipCode() << " failed: " << blocks.getLastError() << "\n";
+                return 1;
+            }
+            // Every block the insert dirtied reaches the file before the next one
+            if (!blocks.flush())
+            {
+                std::cerr << "Flush failed: " << blocks.getLastError() << "\n";
+                return 1;
+            }
+            index.applyChanges(blocks.getIndexChanges());
+            blocks.clearIndexChanges();
+        }
+        const double elapsed = seconds(start);
+        blocks.closeFile();
+
+        std::cout << static_cast<int>(fillFactor * 100 + 0.5) << "%\t" << loadedBlocks << "\t\t" << blockCount << "\t\t"
+                  << (blockCount - loadedBlocks) * per10k << "\t\t" << blocks.getBlockWrites() * per10k << "\t\t"
+                  << elapsed * 1000 << "\n";
+    }
+    std::remove(BENCH_FILE);
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <algorithm>
+
+#include "../src/FreeSpaceMap.h"
+
+/**
+ * Test program for the free space map
+ *
+ * Targeted cases at the 64 bit word boundaries, then random releases, range releases,
+ * allocations and trims compared with a plain vector of free flags:
+ *   - releaseRange within one word, across words and past the end of the map
+ *   - allocate(0) takes the lowest free block, allocate(near) the free block closest to
+ *     near within its word, and never more than a word further than the closest
+ *   - shrinkToFit drops only the free blocks at the end
+ *   - save, load and the clean byte cleared by markDirty
+ */
+
+const char* MAP_FILE = "FreeSpaceMapTest.fsm";
+const uint32_t WORD_BITS = 64;
+
+static int failures = 0;
+
+static void check(const bool condition, const std::string& what)
+{
+    if (!condition)
+    {
+        std::cerr << "  FAILED: " << what << "\n";
+        ++failures;
+    }
+}
+
+/**
+ * @brief Compare the map with the model, free[rbn] for RBNs 1..blockCount
+ */
+static bool matchesModel(const FreeSpaceMap& map, const std::vector<bool>& free)
+{
+    const uint32_t blockCount = static_cast<uint32_t>(free.size()) - 1;
+    if (map.getBlockCount() != blockCount) return false;
+    uint32_t freeCount = 0;
+    for (uint32_t rbn = 1; rbn <= blockCount; ++rbn)
+    {
+        if (map.isFree(rbn) != free[rbn]) return false;
+        if (free[rbn]) ++freeCount;
+    }
+    return map.getFreeCount() == freeCount && !map.isFree(0) && !map.isFree(blockCount + 1);
+}
+
+/**
+ * @brief One more than the distance from near to the closest free block of the model
+ *        among RBNs first..last, 0 if none of them is free
+ */
+static uint32_t closestDistance(const std::vector<bool>& free, const uint32_t nearRBN,
+                                const uint32_t first, const uint32_t last)
+{
+    uint32_t best = 0;
+    for (uint32_t rbn = first; rbn <= last && rbn < free.size(); ++rbn)
+    {
+        if (!free[rbn]) continue;
+        const uint32_t distance = (rbn > nearRBN ? rbn - nearRBN : nearRBN - rbn) + 1;
+        if (best == 0 || distance < best) best = distance;
+    }
+    return best;
+}
+
+int main()
+{
+    std::cout << "=== Free Space Map Test Program ===\n\n";
+
+    // Test 1: ranges at word boundaries
+    std::cout << "--- Test 1: Release Range ---\n";
+    FreeSpaceMap map;
+    map.reset(300);
+    std::vector<bool> free(301, false);
+    const uint32_t ranges[][2] = {{1, 1}, {63, 65}, {64, 64}, {100, 227}, {129, 192}, {256, 400}};
+    for (const auto& range : ranges)
+    {
+        map.releaseRange(range[0], range[1]);
+        for (uint32_t rbn = range[0]; rbn <= std::min<uint32_t>(range[1], 300); ++rbn) free[rbn] = true;
+    }
+    map.releaseRange(0, 10);  // Ignored, RBNs start at 1
+    map.releaseRange(50, 40); // Ignored, empty
+    map.releaseRange(301, 310); // Ignored, past the end
+    check(matchesModel(map, free), "free bits after the range releases");
+    check(map.getFreeCount() == 1 + 3 + 128 + 45, "free count counts overlapping ranges once");
+
+    // Test 2: allocation takes the lowest free block or the one closest to near
+    std::cout << "--- Test 2: Allocate ---\n";
+    check(map.allocate(0) == 1, "lowest free block");
+    free[1] = false;
+    check(map.allocate(0) == 63, "next lowest free block");
+    free[63] = false;
+    check(map.allocate(150) == 150, "a free near block is taken itself");
+    free[150] = false;
+    const uint32_t beside = map.allocate(150);
+    check(beside == 149 || beside == 151, "neighbour of a taken near block");
+    free[beside] = false;
+    check(map.allocate(250) == 256, "closest free block above near in the next word");
+    free[256] = false;
+    check(map.allocate(301) == 64, "near past the end takes the lowest free block");
+    free[64] = false;
+    check(matchesModel(map, free), "free bits after the allocations");
+
+    // Test 3: trimming the end of the file
+    std::cout << "--- Test 3: Shrink To Fit ---\n";
+    check(map.shrinkToFit() == 256, "free tail blocks dropped");
+    free.resize(257);
+    check(matchesModel(map, free), "free bits after the trim");
+    map.grow(260);
+    free.resize(261, false);
+    check(matchesModel(map, free), "grown blocks are in use");
+    check(map.shrinkToFit() == 260, "a tail block in use stops the trim");
+
+    // Test 4: random operations against the model
+    std::cout << "--- Test 4: Random Operations ---\n";
+    std::mt19937 rng(4004);
+    bool matched = true, closeEnough = true, lowest = true;
+    for (int step = 0; step < 20000 && matched; ++step)
+    {
+        const uint32_t blockCount = map.getBlockCount();
+        const uint32_t rbn = std::uniform_int_distribution<uint32_t>(1, blockCount + 8)(rng);
+        switch (std::uniform_int_distribution<int>(0, 9)(rng))
+        {
+        case 0:
+        {
+            const uint32_t last = rbn + std::uniform_int_distribution<uint32_t>(0, 200)(rng);
+            map.releaseRange(rbn, last);
+            for (uint32_t r = rbn; r <= std::min(last, blockCount); ++r) free[r] = true;
+            break;
+        }
+        case 1:
+        case 2:
+        {
+            map.release(rbn);
+            if (rbn <= blockCount) free[rbn] = true;
+            break;
+        }
+        case 3:
+        {
+            const uint32_t expected = static_cast<uint32_t>(std::find(free.begin() + 1, free.end(), true) - free.begin());
+            const uint32_t got = map.allocate(0);
+            if (got != (expected < free.size() ? expected : 0)) lowest = false;
+            if (got != 0) free[got] = false;
+            break;
+        }
+        case 8:
+        {
+            map.shrinkToFit();
+            while (free.size() > 1 && free.back()) free.pop_back();
+            break;
+        }
+        case 9:
+        {
+            map.grow(blockCount + std::uniform_int_distribution<uint32_t>(0, 100)(rng));
+            free.resize(map.getBlockCount() + 1, false);
+            break;
+        }
+        default:
+        {
+            if (blockCount == 0) break;
+            const uint32_t nearRBN = std::min(rbn, blockCount);
+            const uint32_t wordFirst = (nearRBN - 1) / WORD_BITS * WORD_BITS + 1;
+            const uint32_t best = closestDistance(free, nearRBN, 1, blockCount);
+            const uint32_t bestInWord = closestDistance(free, nearRBN, wordFirst, wordFirst + WORD_BITS - 1);
+            const uint32_t got = map.allocate(nearRBN);
+            if (best == 0)
+            {
+                if (got != 0) closeEnough = false;
+                break;
+            }
+            // Exact when the closest free block shares near's word, else at most a word further
+            const uint32_t distance = got == 0 ? 0 : (got > nearRBN ? got - nearRBN : nearRBN - got) + 1;
+            if (got == 0 || !free[got] || distance > best + WORD_BITS || (bestInWord == best && distance != best))
+                closeEnough = false;
+            if (got != 0) free[got] = false;
+            break;
+        }
+        }
+        if (!matchesModel(map, free)) matched = false;
+    }
+    check(matched, "free bits match after every random operation");
+    check(lowest, "allocate(0) always took the lowest free block");
+    check(closeEnough, "allocate(near) stayed within a word of the closest free block");
+
+    // Test 5: save and load, a dirty map is rejected
+    std::cout << "--- Test 5: Save And Load ---\n";
+    check(map.save(MAP_FILE), "save");
+    FreeSpaceMap loaded;
+    check(loaded.load(MAP_FILE) && matchesModel(loaded, free), "load restores every bit");
+    check(loaded.markDirty(MAP_FILE), "mark dirty");
+    FreeSpaceMap dirty;
+    check(!dirty.load(MAP_FILE), "a map not closed cleanly is rejected");
+    check(loaded.save(MAP_FILE) && dirty.load(MAP_FILE), "saving marks it clean again");
+
+    std::remove(MAP_FILE);
+    if (failures > 0)
+    {
+        std::cout << "\n=== " << failures << " Checks Failed ===\n";
+        return 1;
+    }
+    std::cout << "\n=== All Tests Passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <chrono>
+#include <random>
+
+#include "../src/BlockIndexFile.h"
+
+/**
+ * Microbenchmark for BlockIndexFile::findRBNForKey
+ *
+ * Builds a synthetic index with one entry per block and reports ns/lookup for
+ *   - linear : the old front to back scan (small indexes only)
+ *   - binary : lower_bound over the sorted entries (layout stale)
+ *   - eytzinger : breadth first layout (after buildSearchLayout)
+ *
+ * Usage: IndexLookupBench [blockCount ...]   (default 10000 1000000 100000000)
+ */
+
+const size_t LOOKUPS = 1000000;
+const size_t LINEAR_LOOKUPS = 2000;
+const size_t LINEAR_MAX_BLOCKS = 1000000;
+
+static double nsPerLookup(std::chrono::steady_clock::time_point start, size_t lookups)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / lookups;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<size_t> sizes;
+    for(int i = 1; i < argc; ++i)
+    {
+        sizes.push_back(static_cast<size_t>(std::stoull(argv[i])));
+    }
+    if(sizes.empty())
+    {
+        sizes = {10000, 1000000, 100000000};
+    }
+
+    std::cout << "=== BlockIndexFile Lookup Benchmark ===\n\n";
+    std::cout << "blocks\tlinear\tbinary\teytzinger (ns/lookup)\n";
+
+    for(const size_t blocks : sizes)
+    {
+        // Highest key of block i is 3i + 2, so keys are sparse like real zip codes
+        BlockIndexFile index;
+        std::vector<IndexEntry> entries;
+        entries.reserve(blocks <= LINEAR_MAX_BLOCKS ? blocks : 0);
+        for(size_t i = 0; i < blocks; ++i)
+        {
+            IndexEntry entry;
+            entry.key = static_cast<uint32_t>(3 * i + 2);
+            entry.recordRBN = static_cast<uint32_t>(i + 1);
+            index.addIndexEntry(entry);
+            if(blocks <= LINEAR_MAX_BLOCKS) entries.push_back(entry);
+        }
+
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<uint32_t> dist(0, static_cast<uint32_t>(3 * blocks + 2));
+        std::vector<uint32_t> queries(LOOKUPS);
+        for(auto& q : queries) q = dist(rng);
+
+        uint64_t checksum = 0;
+
+        std::string linearResult = "-";
+        if(blocks <= LINEAR_MAX_BLOCKS)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < LINEAR_LOOKUPS; ++i)
+            {
+                for(const auto& e : entries)
+                {
+                    if(queries[i] <= e.key) { checksum += e.recordRBN; break; }
+                }
+            }
+            linearResult = std::to_string(nsPerLookup(start, LINEAR_LOOKUPS));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t binarySum = 0;
+        for(const auto q : queries) binarySum += index.findRBNForKey(q);
+        double binaryNs = nsPerLookup(start, LOOKUPS);
+
+        index.buildSearchLayout();
+
+        start = std::chrono::steady_clock::now();
+        uint64_t eytzingerSum = 0;
+        for(const auto q : queries) eytzingerSum += index.findRBNForKey(q);
+        double eytzingerNs = nsPerLookup(start, LOOKUPS);
+
+        if(binarySum != eytzingerSum)
+        {
+            std::cerr << "Mismatch between binary and Eytzinger results at " << blocks << " blocks\n";
+            return 1;
+        }
+
+        std::cout << blocks << "\t" << linearResult << "\t" << binaryNs << "\t" << eytzingerNs
+                  << "\t(checksum " << (checksum + eytzingerSum) << ")\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "../src/RecordTokenizer.h"
+#include "../src/ZipCodeRecord.h"
+
+/**
+ * Test program for the record tokenizer
+ *
+ * Lines that must parse and lines that must be rejected by parseRecord, then
+ * splitRecord over several records with quoted fields placed around the 16 and 32
+ * byte steps of the vector scan:
+ *   - quoted fields may hold commas and newlines, their outer quotes are dropped
+ *   - one trailing comma does not start a seventh field, two do
+ *   - a zip must be digits in full ("12abc", "-5" are rejected) and a valid zip code,
+ *     the coordinates must be in range
+ */
+
+static int failures = 0;
+
+static void check(const bool condition, const std::string& what)
+{
+    if (!condition)
+    {
+        std::cerr << "  FAILED: " << what << "\n";
+        ++failures;
+    }
+}
+
+/**
+ * @brief Parse a line that must be accepted and compare the text fields
+ */
+static void expectRecord(const std::string& line, const uint32_t zip, const std::string& place,
+                         const std::string& state, const std::string& county)
+{
+    ZipCodeRecord record;
+    if (!RecordTokenizer::parseRecord(line, record))
+    {
+        check(false, "rejected: " + line);
+        return;
+    }
+    check(record.getZipCode() == zip && record.getLocationName() == place && record.getState() == state &&
+          record.getCounty() == county, "fields of: " + line);
+}
+
+static void expectRejected(const std::string& line)
+{
+    ZipCodeRecord record;
+    check(!RecordTokenizer::parseRecord(line, record), "accepted: " + line);
+}
+
+int main()
+{
+    std::cout << "=== Record Tokenizer Test Program ===\n\n";
+
+    // Test 1: lines that parse
+    std::cout << "--- Test 1: Valid Lines ---\n";
+    expectRecord("501,Holtsville,NY,Suffolk,40.8154,-73.0451", 501, "Holtsville", "NY", "Suffolk");
+    expectRecord("501,Holtsville,NY,Suffolk,40.8154,-73.0451\n", 501, "Holtsville", "NY", "Suffolk");
+    expectRecord("501,Holtsville,NY,Suffolk,40.8154,-73.0451,", 501, "Holtsville", "NY", "Suffolk");
+    expectRecord(" 501 , Holtsville ,NY, Suffolk ,40.8154, -73.0451", 501, "Holtsville", "NY", "Suffolk");
+    expectRecord("501,\"Holtsville, East\",NY,\"Suffolk, NY\",40.8154,-73.0451", 501, "Holtsville, East", "NY", "Suffolk, NY");
+    expectRecord("501,\"Holts\nville\",NY,Suffolk,40.8154,-73.0451", 501, "Holts\nville", "NY", "Suffolk");
+    expectRecord("99999,Max,NY,Suffolk,+90,-180", 99999, "Max", "NY", "Suffolk");
+
+    // Test 2: lines that must be rejected
+    std::cout << "--- Test 2: Invalid Lines ---\n";
+    expectRejected("12abc,Holtsville,NY,Suffolk,40.8154,-73.0451");
+    expectRejected("-5,Holtsville,NY,Suffolk,40.8154,-73.0451");
+    expectRejected("4294967296,Holtsville,NY,Suffolk,40.8154,-73.0451");
+    expectRejected("100000,Holtsville,NY,Suffolk,40.8154,-73.0451");
+    expectRejected("0,Holtsville,NY,Suffolk,40.8154,-73.0451");
+    expectRejected("501,Holtsville,NY,Suffolk,90.5,-73.0451");
+    expectRejected(",Holtsville,NY,Suffolk,40.8154,-73.0451");
+    expectRejected("501,Holtsville,NY,Suffolk,40.8154,-73.0451,,");
+    expectRejected("501,Holtsville,NY,Suffolk,40.8154,-73.0451,extra");
+    expectRejected("501,Holtsville,NY,Suffolk,40.8154");
+    expectRejected("501,Holtsville,NYC,Suffolk,40.8154,-73.0451");
+    expectRejected("501,Holtsville,NY,Suffolk,40.8154N,-73.0451");
+    expectRejected("501,Holtsville,NY,Suffolk,40.8154,-73.0451\n502,Next,NY,Suffolk,40.8,-73.0");
+    expectRejected("");
+
+    // Test 3: several records in one text, quotes straddling the vector steps
+    std::cout << "--- Test 3: Split Records ---\n";
+    std::string text;
+    size_t expectedRecords = 0;
+    for (size_t pad = 0; pad < 40; ++pad)
+    {
+        text += std::to_string(1000 + pad) + ",\"" + std::string(pad, 'x') + ", Town\",NY,\"A,B\",1.5,-2.5,\n";
+        ++expectedRecords;
+    }
+    std::string_view fields[RecordTokenizer::FIELD_COUNT];
+    size_t offset = 0, records = 0;
+    bool allValid = true;
+    while (offset < text.size())
+    {
+        size_t fieldCount = 0;
+        const size_t used = RecordTokenizer::splitRecord(std::string_view(text).substr(offset), fields,
+                                                         RecordTokenizer::FIELD_COUNT, fieldCount);
+        ZipCodeRecord record;
+        const size_t pad = records;
+        if (used == 0 || fieldCount != RecordTokenizer::FIELD_COUNT || !RecordTokenizer::fieldsToRecord(fields, record) ||
+            record.getZipCode() != 1000 + pad || record.getLocationName() != std::string(pad, 'x') + ", Town" ||
+            record.getCounty() != "A,B")
+        {
+            allValid = false;
+            break;
+        }
+        offset += used;
+        ++records;
+    }
+    check(allValid && records == expectedRecords, "every record split at its own newline");
+
+    if (failures > 0)
+    {
+        std::cout << "\n=== " << failures << " Checks Failed ===\n";
+        return 1;
+    }
+    std::cout << "\n=== All Tests Passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+
+#include "../src/RecordTokenizer.h"
+#include "../src/ZipCodeRecord.h"
+#include "../src/CSVBuffer.h"
+
+/**
+ * Benchmark for RecordTokenizer against the std::getline / std::stod parsing it replaced
+ *
+ * The CSV file is read into memory once, then every pass parses all of its data rows:
+ *   - legacy : getline per line, stringstream split, trim, stol/stod to validate and again to convert
+ *   - split : RecordTokenizer::splitRecord only (fields as views, no conversion)
+ *   - tokenizer : splitRecord + fieldsToRecord (from_chars, builds each ZipCodeRecord)
+ * and end to end through CSVBuffer, reading the file:
+ *   - getNextRecord : one thread
+ *   - getNextBatch : openFileParallel with one parse thread per core
+ *
+ * Usage: TokenizerBench [file.csv] [passes]   (default data/PT2_Randomized.csv 20)
+ */
+
+const size_t FIELD_COUNT = RecordTokenizer::FIELD_COUNT;
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void trim(std::string& str)
+{
+    str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](unsigned char ch) { return !std::isspace(ch); }));
+    str.erase(std::find_if(str.rbegin(), str.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), str.end());
+}
+
+static bool validUInt32(const std::string& str)
+{
+    if (str.empty()) return false;
+    try
+    {
+        long val = std::stol(str);
+        return val >= 0 && val <= 4294967295;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+static bool validDouble(const std::string& str)
+{
+    if (str.empty()) return false;
+    try
+    {
+        std::stod(str);
+        return true;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+// The per line parse every text reader used before RecordTokenizer
+static bool legacyParse(const std::string& line, ZipCodeRecord& record)
+{
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ','))
+    {
+        trim(field);
+        fields.push_back(field);
+    }
+    if (fields.size() != FIELD_COUNT || !validUInt32(fields[0]) || !validDouble(fields[4]) ||
+        !validDouble(fields[5]) || fields[2].length() != 2)
+        return false;
+
+    record = ZipCodeRecord(static_cast<int>(std::stoul(fields[0])), std::stod(fields[4]), std::stod(fields[5]),
+                           fields[1], fields[2], fields[3]);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string path = argc > 1 ? argv[1] : "data/PT2_Randomized.csv";
+    const size_t passes = argc > 2 ? static_cast<size_t>(std::stoull(argv[2])) : 20;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    std::stringstream whole;
+    whole << file.rdbuf();
+    const std::string text = whole.str();
+
+    // Data rows start with a digit, the quoted header lines do not
+    size_t dataStart = 0;
+    while (dataStart < text.size() && !std::isdigit(static_cast<unsigned char>(text[dataStart])))
+    {
+        const size_t newline = text.find('\n', dataStart);
+        dataStart = newline == std::string::npos ? text.size() : newline + 1;
+    }
+    const std::string_view rows = std::string_view(text).substr(dataStart);
+
+#if defined(__AVX2__)
+    const char* scanner = "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    const char* scanner = "SSE2";
+#else
+    const char* scanner = "scalar";
+#endif
+
+    std::cout << "=== Record Tokenizer Benchmark ===\n";
+    std::cout << path << ", " << passes << " passes, delimiter scan: " << scanner << "\n\n";
+    std::cout << "path\t\trecords/s\tns/record\n";
+
+    auto report = [](const char* name, const size_t records, const double elapsed)
+    {
+        std::cout << name << "\t" << static_cast<uint64_t>(records / elapsed) << "\t"
+                  << (elapsed * 1e9 / records) << "\n";
+    };
+
+    size_t expected = 0;
+    {
+        size_t records = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t pass = 0; pass < passes; ++pass)
+        {
+            std::istringstream in{std::string(rows)};
+            std::string line;
+            ZipCodeRecord record;
+            while (std::getline(in, line))
+            {
+                if (!line.empty() && legacyParse(line, record)) ++records;
+            }
+        }
+        report("legacy\t", records, seconds(start));
+        expected = records;
+    }
+
+    {
+        size_t records = 0;
+        uint64_t checksum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t pass = 0; pass < passes; ++pass)
+        {
+            std::string_view fields[FIELD_COUNT];
+            for (size_t pos = 0; pos < rows.size();)
+            {
+                size_t fieldCount = 0;
+                pos += RecordTokenizer::splitRecord(rows.substr(pos), fields, FIELD_COUNT, fieldCount);
+                if (fieldCount == FIELD_COUNT)
+                {
+                    checksum += fields[2].size();
+                    ++records;
+                }
+            }
+        }
+        report("split\t", records, seconds(start));
+        if (checksum == 0) std::cout << "(no fields)\n";
+    }
+
+    {
+        size_t records = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t pass = 0; pass < passes; ++pass)
+        {
+            std::string_view fields[FIELD_COUNT];
+            ZipCodeRecord record;
+            for (size_t pos = 0; pos < rows.size();)
+            {
+                size_t fieldCount = 0;
+                pos += RecordTokenizer::splitRecord(rows.substr(pos), fields, FIELD_COUNT, fieldCount);
+                if (fieldCount == FIELD_COUNT && RecordTokenizer::fieldsToRecord(fields, record)) ++records;
+            }
+        }
+        report("tokenizer", records, seconds(start));
+        if (records != expected) std::cout << "(tokenizer parsed " << records << " records, legacy " << expected << ")\n";
+    }
+
+    {
+        size_t records = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t pass = 0; pass < passes; ++pass)
+        {
+            CSVBuffer buffer;
+            ZipCodeRecord record;
+            if (!buffer.openFile(path)) break;
+            while (buffer.getNextRecord(record)) ++records;
+        }
+        report("getNextRecord", records, seconds(start));
+    }
+
+    {
+        size_t records = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t pass = 0; pass < passes; ++pass)
+        {
+            CSVBuffer buffer;
+            std::vector<ZipCodeRecord> batch;
+            if (!buffer.openFileParallel(path)) break;
+            while (buffer.getNextBatch(batch)) records += batch.size();
+        }
+        report("getNextBatch", records, seconds(start));
+    }
+    return 0;
+}
@@ -3,15 +3,26 @@
 #include "../src/HeaderBuffer.h"
 #include "../src/CSVBuffer.h"
 #include "../src/ZipCodeRecord.h"
+#include "../src/ZipCodeRecordView.h"
+#include "../src/RecordTokenizer.h"
 #include "../src/PrimaryKeyIndex.h"
 #include "../src/BlockBuffer.h"
 #include "../src/DataManager.h"
 #include "../src/BlockIndexFile.h"
+#include "../src/BPlusTreeIndex.h"
+#include "../src/FreeSpaceMap.h"
+#include "../src/ExternalSorter.h"
+#include "../src/BulkLoader.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <cstring>
+#include <cmath>
 #include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <limits>
 
 void printUsage(const char* programName)
 {
@@ -19,9 +30,20 @@ void printUsage(const char* programName)
               << "  Convert CSV to ZCD:\n"
               << "    " << programName << " convert <input.csv> <output.zcd>\n\n"
               << "  Convert CSV to Blocked Sequence Set:\n"
-              << "    " << programName << " convert-blocked <input.csv> <output.zcb> [blockSize] [minBlockSize]\n"
+              << "    " << programName << " convert-blocked <input.csv> <output.zcb> [blockSize] [minBlockSize] [text|binary|slotted] [sortMemoryMB] [fillFactor] [reserveBytes]\n"
               << "    blockSize: block size in bytes (default: 1024)\n"
-              << "    minBlockSize: minimum block size (default: 256)\n\n"
+              << "    minBlockSize: minimum block size (default: 256)\n"
+              << "    text|binary|slotted: record format inside blocks (default: binary)\n"
+              << "    sortMemoryMB: spill sorted runs to disk past this many MB of records (default: 0, sort in memory)\n"
+              << "    fillFactor: share of each block filled (default: 1.0)\n"
+              << "    reserveBytes: bytes left free at the end of each block (default: 0)\n"
+              << "    Both are stored in the header and reused by reorganize\n\n"
+              << "  Convert the records of a blocked file between formats:\n"
+              << "    " << programName << " convert-format <blocked.zcb> <text|binary|slotted>\n\n"
+              << "  Rewrite a blocked file so physical order matches logical order:\n"
+              << "    " << programName << " reorganize <blocked.zcb> [fillFactor] [reserveBytes]\n"
+              << "    fillFactor, reserveBytes: as for convert-blocked (default: the file's own, else 0.9 and 0),\n"
+              << "    free blocks are dropped\n\n"
               << "  Read ZCD file:\n"
               << "    " << programName << " read <input.zcd> [count]\n"
               << "    count: number of records to display (default: 5)\n\n"
@@ -29,16 +51,33 @@ void printUsage(const char* programName)
               << "    " << programName << " header <input.zcd>\n\n"
               << "  Verify CSV vs ZCD using DataManager (identicality test):\n"
               << "    " << programName << " verify <input.csv> <input.zcd>\n\n"
+              << "  Per-state extremes of a blocked file (parallel scan in physical order):\n"
+              << "    " << programName << " extremes <blocked.zcb> [threads]\n"
+              << "    threads: scan threads (default: one per core)\n\n"
               << "  Search using index (no full scan):\n"
               << "    " << programName << " zcd-search <input.zcd> <zipcode_data.idx> <zip> [<zip> ...]\n\n"
+              << "  Records of a blocked file with keys in lo..hi, in key order (index seek, chain walk):\n"
+              << "    " << programName << " range <blocked.zcb> <lo> <hi> [limit] [offset]\n"
+              << "    limit: most records printed (default: 0, all), offset: records skipped first\n\n"
+              << "  Add records to a blocked file (sorted batch merge):\n"
+              << "    " << programName << " add <blocked.zcb> <records.csv> [fillFactor]\n"
+              << "    fillFactor: share of each block filled when a block splits (default: 0.9)\n\n"
+              << "  Delete keys from a blocked file:\n"
+              << "    " << programName << " del <blocked.zcb> <keys.txt>\n"
+              << "    add and del write through <blocked.zcb>.wal, one fsync per group of operations\n\n"
+              << "  Replay the write-ahead log and rebuild the indexes after an interrupted add or del:\n"
+              << "    " << programName << " recover <blocked.zcb>\n\n"
               << "Examples:\n"
               << "  " << programName << " convert PT2_CSV.csv output.zcd\n"
               << "  " << programName << " convert-blocked PT2_CSV.csv output.zcb\n"
               << "  " << programName << " convert-blocked PT2_CSV.csv output.zcb 2048 512\n"
+              << "  " << programName << " convert-blocked national.csv output.zcb 4096 1024 binary 256\n"
+              << "  " << programName << " convert-blocked PT2_CSV.csv output.zcb 1024 256 binary 0 0.85 64\n"
               << "  " << programName << " read output.zcd 10\n"
               << "  " << programName << " header output.zcd\n"
               << "  " << programName << " verify PT2_CSV.csv output.zcd\n"
-              << "  " << programName << " zcd-search output.zcd zipcode_data.idx 55455 30301\n";
+              << "  " << programName << " zcd-search output.zcd zipcode_data.idx 55455 30301\n"
+              << "  " << programName << " range output.zcb 55000 55999\n";
 
 }
 
@@ -143,66 +182,105 @@ bool convertCSVtoZCD(const std::string& inFile, const std::string& outFile)
     }
     std::cout << "Success: Index file generated: " << header.getIndexFileName() << std::endl;
 
-    // --- Rewrite header at file start with final values (recordCount, headerSize, staleFlag=false) ---
+    // --- Patch the final values into the header (recordCount, staleFlag=false) ---
     header.setRecordCount(count);
     header.setStaleFlag(false);
 
-    // use your HeaderBuffer if you have one; otherwise rewrite manually
-    {
-        std::fstream io(outFile, std::ios::binary | std::ios::in | std::ios::out);
-        if (!io){
-            std::cerr << "Warning: could not reopen ZCD to rewrite header\n";
-        } else {
-            auto finalHeader = header.serialize();
-            header.setHeaderSize(static_cast<uint32_t>(finalHeader.size()));
-            finalHeader = header.serialize(); // re-serialize with updated size again
-            io.seekp(0, std::ios::beg);
-            io.write(reinterpret_cast<const char*>(finalHeader.data()), finalHeader.size());
-            io.flush();
-        }
+    HeaderBuffer headerBuffer;
+    if (!headerBuffer.updateHeader(outFile, header)) {
+        std::cerr << "Warning: could not update ZCD header: " << headerBuffer.getLastError() << "\n";
     }
 
     return true;
 }
 
-bool convertCSVToBlockedSequenceSet(const std::string& csvFile, const std::string& zcbFile, 
-                                    uint32_t blockSize = 1024, uint16_t minBlockSize = 256)
+/**
+ * @brief Rebuild the B+tree index set of a blocked file from its sequence set
+ * @param entries [IN] Highest key and RBN of every sequence set block, sorted by key
+ * @return True if the companion index file was written
+ */
+static bool rebuildIndexSet(const std::string& zcbFile, uint32_t blockSize,
+                            const std::vector<IndexEntry>& entries)
 {
-    CSVBuffer csvBuffer;
-    if(!csvBuffer.openFile(csvFile))
+    BPlusTreeIndex tree;
+    if (!tree.create(BPlusTreeIndex::pathFor(zcbFile), blockSize, entries))
     {
-        std::cerr << "Failed to open CSV file." << std::endl;
+        std::cerr << "Error: " << tree.getLastError() << std::endl;
         return false;
     }
+    tree.close();
+    return true;
+}
 
-    std::vector<ZipCodeRecord> allRecords;
-    ZipCodeRecord record;
-    while(csvBuffer.getNextRecord(record))
-    {
-        allRecords.push_back(record);
-    }
+const uint16_t BLOCKED_TEXT_VERSION = 2; // Blocked file with text records
+const uint16_t BLOCKED_BINARY_VERSION = 3; // Blocked file with binary records
+const uint16_t BLOCKED_SLOTTED_VERSION = 4; // Blocked file with slotted pages of binary records
 
-    std::cout << "Read " << allRecords.size() << " records." << std::endl;
+/**
+ * @brief Header version for a record format
+ */
+static uint16_t versionForFormat(uint8_t format)
+{
+    if (format == RecordBuffer::SLOTTED_RECORDS) return BLOCKED_SLOTTED_VERSION;
+    if (format == RecordBuffer::BINARY_RECORDS) return BLOCKED_BINARY_VERSION;
+    return BLOCKED_TEXT_VERSION;
+}
 
-    std::sort(allRecords.begin(), allRecords.end(),
-                [](const ZipCodeRecord& a, const ZipCodeRecord& b)
-            {
-                return a.getZipCode() < b.getZipCode();
-            });
+/**
+ * @brief Name of a record format as used on the command line
+ */
+static const char* formatName(uint8_t format)
+{
+    if (format == RecordBuffer::SLOTTED_RECORDS) return "slotted";
+    if (format == RecordBuffer::BINARY_RECORDS) return "binary";
+    return "text";
+}
 
-    std:: cout << "Sorted records by ZipCode." << std::endl;
+/**
+ * @brief Parse a record format name
+ * @param name [IN] "text", "binary" or "slotted"
+ * @param format [OUT] RecordBuffer::TEXT_RECORDS, BINARY_RECORDS or SLOTTED_RECORDS
+ * @return True if the name was recognised
+ */
+static bool parseRecordFormat(const std::string& name, uint8_t& format)
+{
+    if (name == "text") { format = RecordBuffer::TEXT_RECORDS; return true; }
+    if (name == "binary") { format = RecordBuffer::BINARY_RECORDS; return true; }
+    if (name == "slotted") { format = RecordBuffer::SLOTTED_RECORDS; return true; }
+    return false;
+}
+
+/**
+ * @brief Write a new blocked sequence set file from records sorted by zip code
+ * @details Writes the header, the blocks, the flat index and the B+tree index set.
+ *          Blocks are filled in order up to fillFactor of blockSize, less blockReserve
+ *          if that leaves more room, and linked at RBN 1, 2, ... so physical order is
+ *          logical order. Both settings are stored in the header for later reorganizations.
+ *          Any existing file is replaced.
+ *          Records are pulled one at a time, only the block being packed is held.
+ * @param nextRecord [IN] Returns the next record in zip code order, false after the last
+ * @param blockReserve [IN] Bytes left free at the end of each block
+ * @return True if the file and its indexes were written
+ */
+static bool writeBlockedFile(const std::function<bool(ZipCodeRecord&)>& nextRecord, const std::string& zcbFile,
+                             uint32_t blockSize, uint16_t minBlockSize, uint8_t recordFormat,
+                             double fillFactor = 1.0, uint16_t blockReserve = 0)
+{
+    // Stored as a whole percent, the loader packs to the stored value
+    const uint8_t fillPercent = static_cast<uint8_t>(std::max(1L, std::min(100L, std::lround(fillFactor * 100))));
+    fillFactor = fillPercent / 100.0;
 
     HeaderRecord header;
 
     header.setFileStructureType("ZIPC");
-    header.setVersion(2);
+    header.setVersion(versionForFormat(recordFormat));
     header.setHeaderSize(0); // Set In Serialization Process
-    header.setSizeFormatType(0);
+    header.setSizeFormatType(recordFormat);
     header.setBlockSize(blockSize);
     header.setMinBlockSize(minBlockSize);
     header.setIndexFileName("data/zipcode_data.idx"); // Placeholder
     header.setIndexFileSchemaInfo("Primary Key: Zipcode"); // Placeholder
-    header.setRecordCount(allRecords.size()); // This will need to be tracked and updated after if sorting changes
+    header.setRecordCount(0); // Update After Conversion
     header.setBlockCount(0); // Update After Conversion
     
     std::vector<FieldDef> fields;
@@ -214,116 +292,365 @@ bool convertCSVToBlockedSequenceSet(const std::string& csvFile, const std::strin
     fields.push_back({"longitude", 2});
     
     header.setFields(fields);
-    header.setFieldCount(csvBuffer.EXPECTED_FIELD_COUNT);
+    header.setFieldCount(CSVBuffer::EXPECTED_FIELD_COUNT);
     header.setPrimaryKeyField(0);
     header.setAvailableListRBN(0); 
     header.setSequenceSetListRBN(1); 
-    header.setStaleFlag(0);
+    header.setStaleFlag(1); // Cleared once the index has been written
+    header.setFillSettings(fillPercent, blockReserve);
 
-    std::ofstream out(zcbFile, std::ios::binary);
-    if (!out.is_open()) 
-    {
-        std::cerr << "Error: Cannot create output file: " << zcbFile << std::endl;
-        return false;
-    }
-    
     auto headerData = header.serialize();
     header.setHeaderSize(headerData.size());
-    
-    out.write(reinterpret_cast<char*>(headerData.data()), headerData.size());
-    
-    size_t blockCountOffset = 4 + 2 + 4 + 1 + 4 + 2 + 2 + 
-                         header.getIndexFileName().length() + 
-                         2 + header.getIndexFileSchemaInfo().length() + 
-                         sizeof(uint32_t);
-    
-    std::cout << "Converting " << csvFile << " to " << zcbFile << "..." << std::endl;
 
-    RecordBuffer recordBuffer;
-    BlockBuffer blockBuffer;
+    // A log left by an older file of the same name must not be replayed into this one
+    std::remove(WriteAheadLog::pathFor(zcbFile).c_str());
 
-    if(!blockBuffer.openFile(zcbFile, header.getHeaderSize()))
+    BulkLoader loader;
+    loader.setRecordFormat(recordFormat);
+    loader.setFillFactor(fillFactor);
+    loader.setBlockReserve(blockReserve);
+    if (!loader.load(zcbFile, headerData, blockSize, nextRecord))
     {
-        std::cerr << "Failed to open block buffer." << std::endl;    
+        std::cerr << "Error: " << loader.getLastError() << std::endl;
+        return false;
     }
+    const uint32_t blockCount = loader.getBlockCount();
+    std::cout << "Wrote " << blockCount << " blocks in " << loader.getWriteCount() << " writes." << std::endl;
 
-    uint32_t currentRBN = 1;
-    uint32_t blockCount = 0;
-    std::vector<ZipCodeRecord> currentBlockRecords;
-    size_t currentSize = 10;  // metadata
+    HeaderBuffer headerBuffer;
+    header.setRecordCount(loader.getRecordCount());
+    header.setBlockCount(blockCount);
+    if (!headerBuffer.updateHeader(zcbFile, header))
+    {
+        std::cerr << "Error: " << headerBuffer.getLastError() << std::endl;
+        return false;
+    }
+
+    // Every block is in use, replace any map left by an older file of the same name
+    FreeSpaceMap freeSpace;
+    freeSpace.reset(blockCount);
+    if (!freeSpace.save(FreeSpaceMap::pathFor(zcbFile)))
+    {
+        std::cerr << "Error: " << freeSpace.getLastError() << std::endl;
+        return false;
+    }
 
-    for(const auto& rec : allRecords)
+    // The loader kept the highest key of every block it wrote, no need to read them back
+    BlockIndexFile index;
+    for (const IndexEntry& entry : loader.getIndexEntries())
+    {
+        index.addIndexEntry(entry);
+    }
+    index.buildSearchLayout();
+    std::cout << "Index Succesfully Created. Now Writing Index." << std::endl;
+    if(index.write(header.getIndexFileName()))
     {
-        // Check if adding this record would overflow
-        if (currentSize + rec.getRecordSize() + 4 > blockSize)
+        std::cout << "Index Successfully Written" << std::endl;
+        header.setStaleFlag(0);
+        if (!headerBuffer.updateHeader(zcbFile, header))
         {
-            // Write current block
-            ActiveBlock block;
-            block.precedingRBN = (currentRBN == 1) ? 0 : currentRBN - 1;
-            block.succeedingRBN = currentRBN + 1;  // Temp - will fix last block later
-            block.recordCount = static_cast<uint16_t>(currentBlockRecords.size());
-            
-            recordBuffer.packBlock(currentBlockRecords, block.data, blockSize);
-            blockBuffer.writeActiveBlockAtRBN(currentRBN, blockSize, header.getHeaderSize(), block);
-            
-            ++blockCount;
-            ++currentRBN;
-            currentBlockRecords.clear();
-            currentSize = 10;  // Reset to metadata size
+            std::cerr << "Error: " << headerBuffer.getLastError() << std::endl;
         }
-      
-        // Add record to current block
-        currentBlockRecords.push_back(rec);
-        currentSize += rec.getRecordSize() + 4;
+    }
+    else
+    {
+        std::cerr << "Error: Failed to write index file" << std::endl;
+        return false;
     }
 
-    // Write final block
-    if (!currentBlockRecords.empty())
+    BPlusTreeIndex tree;
+    if (tree.create(BPlusTreeIndex::pathFor(zcbFile), blockSize, index.getEntries()))
     {
-        ActiveBlock block;
-        block.precedingRBN = (currentRBN == 1) ? 0 : currentRBN - 1;
-        block.succeedingRBN = 0;  // Last block
-        block.recordCount = static_cast<uint16_t>(currentBlockRecords.size());
-        
-        recordBuffer.packBlock(currentBlockRecords, block.data, blockSize);
-        blockBuffer.writeActiveBlockAtRBN(currentRBN, blockSize, header.getHeaderSize(), block);
-        
-        ++blockCount;
+        std::cout << "Index Set Written To " << BPlusTreeIndex::pathFor(zcbFile)
+                  << " (height " << tree.getHeight() << ")" << std::endl;
+    }
+    else
+    {
+        std::cerr << "Error: " << tree.getLastError() << std::endl;
+        return false;
     }
 
-    out.seekp(blockCountOffset);
-    out.write(reinterpret_cast<char*>(&blockCount), sizeof(uint32_t));
+    return true;
+}
 
-    csvBuffer.closeFile();
-    blockBuffer.closeFile();
-    out.close();
+/**
+ * @brief Write a new blocked sequence set file from a vector sorted by zip code
+ */
+static bool writeBlockedFile(const std::vector<ZipCodeRecord>& allRecords, const std::string& zcbFile,
+                             uint32_t blockSize, uint16_t minBlockSize, uint8_t recordFormat,
+                             double fillFactor = 1.0, uint16_t blockReserve = 0)
+{
+    size_t next = 0;
+    auto nextRecord = [&allRecords, &next](ZipCodeRecord& record)
+    {
+        if (next >= allRecords.size()) return false;
+        record = allRecords[next++];
+        return true;
+    };
+    return writeBlockedFile(nextRecord, zcbFile, blockSize, minBlockSize, recordFormat, fillFactor, blockReserve);
+}
 
-    // Once index are setup creating the index and setting the stale flag will go here.
+/**
+ * @brief Fill factor stored in a blocked file's header
+ * @param fallback [IN] Returned if the header predates stored fill settings
+ */
+static double storedFillFactor(const HeaderRecord& header, double fallback)
+{
+    return header.getFillPercent() != 0 ? header.getFillPercent() / 100.0 : fallback;
+}
 
-    BlockIndexFile index;
-    if(index.createIndexFromBlockedFile(zcbFile, blockSize, header.getHeaderSize(), 
-                                        header.getSequenceSetListRBN()))
+/**
+ * @brief Convert a CSV file to a blocked sequence set file
+ * @details Runs as a pipeline: parse workers split the CSV (CSVBuffer::openFileParallel)
+ *          while this thread feeds their records to an ExternalSorter, and the sorted
+ *          records then stream through the BulkLoader pack and write stages. With a
+ *          sortMemory budget the sorter spills sorted runs next to zcbFile, otherwise
+ *          every record is sorted in memory (in its compact binary form).
+ * @param sortMemory [IN] Bytes of records held before a run is spilled, 0 for no limit
+ * @param fillFactor [IN] Share of each block filled
+ * @param blockReserve [IN] Bytes left free at the end of each block
+ * @return True if the file and its indexes were written
+ */
+bool convertCSVToBlockedSequenceSet(const std::string& csvFile, const std::string& zcbFile, 
+                                    uint32_t blockSize = 1024, uint16_t minBlockSize = 256,
+                                    uint8_t recordFormat = RecordBuffer::BINARY_RECORDS,
+                                    size_t sortMemory = 0, double fillFactor = 1.0, uint16_t blockReserve = 0)
+{
+    CSVBuffer csvBuffer;
+    if(!csvBuffer.openFileParallel(csvFile))
     {
-        std::cout << "Index Succesfully Created. Now Writing Index." << std::endl;
-        if(index.write(header.getIndexFileName()))
+        std::cerr << "Failed to open CSV file." << std::endl;
+        return false;
+    }
+
+    ExternalSorter sorter;
+    sorter.open(zcbFile + ".sort", sortMemory > 0 ? sortMemory : std::numeric_limits<size_t>::max());
+
+    // Chunks are parsed on worker threads and arrive in file order
+    std::vector<ZipCodeRecord> batch;
+    while(csvBuffer.getNextBatch(batch))
+    {
+        for (const ZipCodeRecord& rec : batch)
         {
-            std::cout << "Index Successfully Written" << std::endl;
-            std::fstream outFile(zcbFile, std::ios::binary | std::ios::in | std::ios::out);
-            uint8_t staleFlag = 0;
-            size_t flagOffset = header.getHeaderSize() - 1;
-            
-            outFile.seekp(flagOffset);
-            outFile.write(reinterpret_cast<char*>(&staleFlag), sizeof(uint8_t));
-            
-            outFile.close();
+            if (!sorter.add(rec))
+            {
+                std::cerr << "Error: " << sorter.getLastError() << std::endl;
+                return false;
+            }
         }
-        else
+    }
+    if(csvBuffer.hasError())
+    {
+        std::cerr << "Stopped reading " << csvFile << ": " << csvBuffer.getLastError() << std::endl;
+    }
+    csvBuffer.closeFile();
+
+    // Equal zips keep their CSV order
+    if (!sorter.finish())
+    {
+        std::cerr << "Error: " << sorter.getLastError() << std::endl;
+        return false;
+    }
+    std::cout << "Read " << sorter.getRecordCount() << " records." << std::endl;
+    if (sorter.getRunCount() > 0)
+    {
+        std::cout << "Sorted into " << sorter.getRunCount() << " runs (" << sorter.getBytesSpilled()
+                  << " bytes spilled, budget " << sortMemory << " bytes)." << std::endl;
+    }
+    else
+    {
+        std::cout << "Sorted records by ZipCode." << std::endl;
+    }
+
+    std::cout << "Converting " << csvFile << " to " << zcbFile << "..." << std::endl;
+    auto nextRecord = [&sorter](ZipCodeRecord& record) { return sorter.next(record); };
+    if (!writeBlockedFile(nextRecord, zcbFile, blockSize, minBlockSize, recordFormat, fillFactor, blockReserve))
+    {
+        return false;
+    }
+    if (sorter.hasError())
+    {
+        std::cerr << "Error: " << sorter.getLastError() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Read every record of a blocked file in sequence set order
+ * @return True if the whole chain was read
+ */
+static bool readSequenceSet(const std::string& zcbFile, const HeaderRecord& header,
+                            std::vector<ZipCodeRecord>& allRecords)
+{
+    BlockBuffer blockBuffer;
+    if (!blockBuffer.openFile(zcbFile, header.getHeaderSize()))
+    {
+        std::cerr << "Error: cannot open " << zcbFile << std::endl;
+        return false;
+    }
+    blockBuffer.startReadahead(header.getSequenceSetListRBN(), header.getBlockSize(), header.getHeaderSize());
+
+    RecordBuffer recordBuffer;
+    std::vector<ZipCodeRecord> records;
+    uint32_t rbn = header.getSequenceSetListRBN();
+    uint32_t visited = 0;
+    while (rbn != 0 && visited++ <= header.getBlockCount())
+    {
+        ActiveBlock block = blockBuffer.loadActiveBlockAtRBN(rbn, header.getBlockSize(), header.getHeaderSize());
+        if (block.recordCount > 0)
         {
-            std::cerr << "Error: Failed to write index file" << std::endl;
-            return false;
+            if (!recordBuffer.unpackBlock(block.data, records))
+            {
+                std::cerr << "Error: block " << rbn << ": " << recordBuffer.getLastError() << std::endl;
+                return false;
+            }
+            allRecords.insert(allRecords.end(), records.begin(), records.end());
         }
+        rbn = block.succeedingRBN;
     }
+    blockBuffer.closeFile();
+    return true;
+}
 
+/**
+ * @brief Check that no add or del left work a rewrite of the file would lose
+ * @details A set stale flag means an add or del is running or was interrupted, and a
+ *          write-ahead log that is not empty holds committed blocks the file lacks. A
+ *          rewrite would read the chain without them, and the old log would later be
+ *          replayed over the new layout.
+ * @return True if the file can be rewritten
+ */
+static bool readyForRewrite(const std::string& zcbFile, const HeaderRecord& header)
+{
+    std::error_code ec;
+    const uintmax_t logSize = std::filesystem::file_size(WriteAheadLog::pathFor(zcbFile), ec);
+    if (header.getStaleFlag() || (!ec && logSize > 0))
+    {
+        std::cerr << "Error: " << zcbFile << " has an unfinished add or del, run recover first" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Replace a blocked file, its index set and free space map with a rewritten copy
+ * @details rename() swaps each file atomically, readers that already have the old
+ *          file open keep reading the old copy until they reopen it. The write-ahead
+ *          log of the old file is removed first, its images belong to the old layout.
+ * @return True if both files were replaced
+ */
+static bool replaceBlockedFile(const std::string& tempFile, const std::string& zcbFile)
+{
+    std::remove(WriteAheadLog::pathFor(zcbFile).c_str());
+    if (std::rename(tempFile.c_str(), zcbFile.c_str()) != 0 ||
+        std::rename(BPlusTreeIndex::pathFor(tempFile).c_str(), BPlusTreeIndex::pathFor(zcbFile).c_str()) != 0 ||
+        std::rename(FreeSpaceMap::pathFor(tempFile).c_str(), FreeSpaceMap::pathFor(zcbFile).c_str()) != 0)
+    {
+        std::cerr << "Error: could not replace " << zcbFile << " with " << tempFile << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Rewrite a blocked file with its records in another format
+ * @details Records are read in sequence set order and written to a temporary file that
+ *          replaces the original (and its index set) only once it is complete. The file's
+ *          fill settings are kept.
+ * @return True if the file was converted
+ */
+bool convertBlockedFormat(const std::string& zcbFile, uint8_t recordFormat)
+{
+    HeaderRecord header;
+    HeaderBuffer headerBuffer;
+    if (!headerBuffer.readHeader(zcbFile, header))
+    {
+        std::cerr << "Error: Failed to read header from " << zcbFile << std::endl;
+        return false;
+    }
+    if (!readyForRewrite(zcbFile, header)) return false;
+
+    std::vector<ZipCodeRecord> allRecords;
+    if (!readSequenceSet(zcbFile, header, allRecords)) return false;
+
+    std::cout << "Read " << allRecords.size() << " records from " << zcbFile << "." << std::endl;
+
+    const std::string tempFile = zcbFile + ".tmp";
+    if (!writeBlockedFile(allRecords, tempFile, header.getBlockSize(), header.getMinBlockSize(), recordFormat,
+                          storedFillFactor(header, 1.0), header.getBlockReserve()))
+    {
+        std::remove(tempFile.c_str());
+        std::remove(BPlusTreeIndex::pathFor(tempFile).c_str());
+        std::remove(FreeSpaceMap::pathFor(tempFile).c_str());
+        return false;
+    }
+    if (!replaceBlockedFile(tempFile, zcbFile)) return false;
+
+    std::cout << "Converted " << zcbFile << " to " << formatName(recordFormat)
+              << " records." << std::endl;
+    return true;
+}
+
+/**
+ * @brief Rewrite a blocked file so its physical order is its logical order
+ * @details Records are read in sequence set order and repacked at fillFactor into RBN
+ *          1, 2, ... of a temporary file, which then replaces the original like
+ *          convertBlockedFormat. The avail list is dropped, so the file shrinks to the
+ *          active blocks, and both indexes are rebuilt.
+ * @param fillFactor [IN] Share of each block filled, below 0 for the one stored in the header
+ * @param blockReserve [IN] Bytes left free at the end of each block, below 0 for the stored reserve
+ * @return True if the file was reorganized
+ */
+bool reorganizeBlockedFile(const std::string& zcbFile, double fillFactor, long blockReserve)
+{
+    HeaderRecord header;
+    HeaderBuffer headerBuffer;
+    if (!headerBuffer.readHeader(zcbFile, header))
+    {
+        std::cerr << "Error: Failed to read header from " << zcbFile << std::endl;
+        return false;
+    }
+    if (!readyForRewrite(zcbFile, header)) return false;
+
+    if (fillFactor < 0.0) fillFactor = storedFillFactor(header, BlockBuffer::DEFAULT_FILL_FACTOR);
+    if (blockReserve < 0) blockReserve = header.getBlockReserve();
+    if (blockReserve >= static_cast<long>(header.getBlockSize()) ||
+        blockReserve > std::numeric_limits<uint16_t>::max())
+    {
+        std::cerr << "Error: reserveBytes must be less than the block size " << header.getBlockSize() << std::endl;
+        return false;
+    }
+
+    std::vector<ZipCodeRecord> allRecords;
+    if (!readSequenceSet(zcbFile, header, allRecords)) return false;
+
+    std::ifstream before(zcbFile, std::ios::binary | std::ios::ate);
+    const std::streamoff sizeBefore = before.tellg();
+    before.close();
+
+    // Same block size and record format, only the layout changes
+    const std::string tempFile = zcbFile + ".tmp";
+    if (!writeBlockedFile(allRecords, tempFile, header.getBlockSize(), header.getMinBlockSize(),
+                          header.getSizeFormatType(), fillFactor, static_cast<uint16_t>(blockReserve)))
+    {
+        std::remove(tempFile.c_str());
+        std::remove(BPlusTreeIndex::pathFor(tempFile).c_str());
+        std::remove(FreeSpaceMap::pathFor(tempFile).c_str());
+        return false;
+    }
+    if (!replaceBlockedFile(tempFile, zcbFile)) return false;
+
+    std::ifstream after(zcbFile, std::ios::binary | std::ios::ate);
+    const std::streamoff sizeAfter = after.tellg();
+    after.close();
+
+    const std::streamoff blockSize = header.getBlockSize();
+    std::cout << "REORGANIZE: records=" << allRecords.size()
+              << " blocks=" << (sizeBefore - static_cast<std::streamoff>(header.getHeaderSize())) / blockSize
+              << "->" << (sizeAfter - static_cast<std::streamoff>(header.getHeaderSize())) / blockSize
+              << " bytes=" << sizeBefore << "->" << sizeAfter
+              << " fillFactor=" << fillFactor << " reserve=" << blockReserve << std::endl;
     return true;
 }
 
@@ -385,9 +712,14 @@ bool displayHeader(const std::string& inFile)
     std::cout << "File Structure Type: " << std::string(header.getFileStructureType(), 4) << "\n";
     std::cout << "Version: " << header.getVersion() << "\n";
     std::cout << "Header Size: " << header.getHeaderSize() << " bytes\n";
-    std::cout << "Size Format Type: " << (int)header.getSizeFormatType() << " (0=ASCII, 1=Binary)\n";
+    std::cout << "Size Format Type: " << (int)header.getSizeFormatType() << " (0=Text records, 1=Binary records, 2=Slotted pages)\n";
     std::cout << "Index File: " << header.getIndexFileName() << "\n";
-    std::cout << "Has Valid Index: " << (header.getStaleFlag() ? "Yes" : "No") << "\n";
+    std::cout << "Has Valid Index: " << (header.getStaleFlag() ? "No" : "Yes") << "\n";
+    if (header.getFillPercent() != 0)
+    {
+        std::cout << "Fill Factor: " << (int)header.getFillPercent() << "%\n";
+        std::cout << "Block Reserve: " << header.getBlockReserve() << " bytes\n";
+    }
     std::cout << "Record Count: " << header.getRecordCount() << "\n";
     std::cout << "Field Count: " << header.getFieldCount() << "\n";
     std::cout << "Primary Key Field: " << (int)header.getPrimaryKeyField() << "\n";
@@ -402,13 +734,12 @@ bool displayHeader(const std::string& inFile)
     
     return true;
 }
-static bool readLengthIndicatedRecordAt(const std::string& zcdPath,
+// read the length-indicated record at an offset of an already open .zcd
+static bool readLengthIndicatedRecordAt(std::istream& in,
                                         uint64_t absOffset,
                                         std::string& out)
 {
-    std::ifstream in(zcdPath, std::ios::binary);
-    if (!in) return false;
-
+    in.clear();
     in.seekg(static_cast<std::streamoff>(absOffset), std::ios::beg);
 
     uint32_t len = 0;
@@ -418,29 +749,6 @@ static bool readLengthIndicatedRecordAt(const std::string& zcdPath,
     return static_cast<bool>(in.read(out.data(), len));
 }
 
-// quick CSV parser for a single line "zip,location,state,county,lat,lon"
-static bool parseOneCSVLine(const std::string& line, ZipCodeRecord& rec) {
-    std::stringstream ss(line);
-    std::string zip, location, state, county, lat, lon;
-
-    if (!std::getline(ss, zip, ',')) return false;
-    if (!std::getline(ss, location, ',')) return false;
-    if (!std::getline(ss, state, ',')) return false;
-    if (!std::getline(ss, county, ',')) return false;
-    if (!std::getline(ss, lat, ',')) return false;
-    if (!std::getline(ss, lon, ',')) return false;
-
-    try {
-        rec.setZipCode(static_cast<uint32_t>(std::stoul(zip)));
-        rec.setLocationName(location);
-        rec.setState(state.c_str());
-        rec.setCounty(county);
-        rec.setLatitude(std::stod(lat));
-        rec.setLongitude(std::stod(lon));
-        return true;
-    } catch (...) { return false; }
-}
-
 // get highest zip in a block (assumes block.data holds sorted records)
 static uint32_t highestZipInBlock(BlockBuffer& bb,
                                   uint32_t rbn,
@@ -460,31 +768,172 @@ static uint32_t findTargetBlockRBN(BlockBuffer& bb,
                                    uint32_t seqHead,
                                    uint32_t zip,
                                    uint32_t blockSize,
-                                   size_t headerSize,
-                                   RecordBuffer& rb)
+                                   size_t headerSize)
 {
     uint32_t curr = seqHead;
+    uint32_t last = 0;
     while (curr != 0) {
         auto blk = bb.loadActiveBlockAtRBN(curr, blockSize, headerSize);
-        std::vector<ZipCodeRecord> recs; rb.unpackBlock(blk.data, recs);
-        if (!recs.empty()) {
-            uint32_t highest = recs.back().getZipCode();
+        BlockRecordIterator it(blk.data.data(), blk.data.size());
+        ZipCodeRecordView view;
+        bool any = false;
+        while (it.next(view)) any = true;
+        if (any) {
+            uint32_t highest = view.getZipCode();
             if (zip <= highest) return curr;  // fits here
         }
-        curr = blk.succeedingRBN;
-    }
-    // larger than all -> insert in rightmost block (the last in chain)
-    // find rightmost:
-    curr = seqHead;
-    uint32_t last = 0;
-    while (curr != 0) {
-        auto blk = bb.loadActiveBlockAtRBN(curr, blockSize, headerSize);
         last = curr;
         curr = blk.succeedingRBN;
     }
+    // larger than all -> insert in rightmost block (the last in chain)
     return last;
 }
 
+// indexes kept in step with the sequence set while add/del mutate it
+struct MutationIndexes
+{
+    BPlusTreeIndex tree;   // B+tree index set (companion .bpt file)
+    bool treeStale;        // tree missing or out of step, rebuilt at the end
+    BlockIndexFile index;  // flat index named in the header
+    bool indexStale;       // index missing or out of step, header flagged stale at the end
+};
+
+// rebuild: a crash may have left either index out of step with the chain, rebuild both from it
+// before the batch routes through them (the flat index is written by closeMutationIndexes)
+static void openMutationIndexes(const std::string& zcb, const HeaderRecord& hdr, bool rebuild, MutationIndexes& ix)
+{
+    if (!rebuild) {
+        ix.treeStale = !ix.tree.open(BPlusTreeIndex::pathFor(zcb));
+        ix.indexStale = !ix.index.read(hdr.getIndexFileName());
+        return;
+    }
+    ix.treeStale = true;
+    ix.indexStale = !ix.index.createIndexFromBlockedFile(zcb, hdr.getBlockSize(), hdr.getHeaderSize(),
+                                                         hdr.getSequenceSetListRBN());
+    if (!ix.indexStale && rebuildIndexSet(zcb, hdr.getBlockSize(), ix.index.getEntries())) {
+        ix.treeStale = !ix.tree.open(BPlusTreeIndex::pathFor(zcb));
+    }
+}
+
+// apply and clear the highest key changes of the last BlockBuffer operation
+static void applyIndexChanges(BlockBuffer& bb, MutationIndexes& ix)
+{
+    if (!ix.treeStale && !ix.tree.applyChanges(bb.getIndexChanges())) {
+        std::cerr << "Index set update failed (" << ix.tree.getLastError() << "), rebuilding after the batch\n";
+        ix.tree.close();
+        ix.treeStale = true;
+    }
+    if (!ix.indexStale && !ix.index.applyChanges(bb.getIndexChanges())) {
+        std::cerr << "Index update failed, marking it stale\n";
+        ix.indexStale = true;
+    }
+    bb.clearIndexChanges();
+}
+
+// target block for a zip: index lookup, keys above every block go to the tail block
+static uint32_t routeToBlock(MutationIndexes& ix, BlockBuffer& bb, uint32_t seqHead, uint32_t zip,
+                             const HeaderRecord& hdr)
+{
+    const uint32_t notFound = static_cast<uint32_t>(-1);
+    uint32_t rbn = notFound;
+    if (!ix.treeStale) {
+        rbn = ix.tree.findRBNForKey(zip);
+        if (rbn == notFound) rbn = ix.tree.getTailRBN();
+    }
+    else if (!ix.indexStale) {
+        rbn = ix.index.findRBNForKey(zip);
+        if (rbn == notFound) rbn = ix.index.getTailRBN();
+    }
+    if (rbn == 0 || rbn == notFound) {
+        // no usable index, walk the chain
+        rbn = findTargetBlockRBN(bb, seqHead, zip, hdr.getBlockSize(), hdr.getHeaderSize());
+    }
+    return rbn;
+}
+
+// persist the stale flag before the first block write, replays included. It stays set until
+// closeMutationIndexes has both indexes in step again, so a crash anywhere in between makes the next
+// add, del or recover rebuild them even when the log it left was already emptied.
+// interrupted: the flag was already set, the indexes cannot be trusted
+static bool beginMutation(const std::string& zcb, HeaderBuffer& hb, HeaderRecord& hdr, bool& interrupted)
+{
+    interrupted = hdr.getStaleFlag() != 0;
+    hdr.setStaleFlag(1);
+    if (!hb.updateHeader(zcb, hdr)) {
+        std::cerr << "Error: " << hb.getLastError() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// route block writes through the write-ahead log, opening it replays whatever a crash left in it.
+// false if another process is writing the file (its log exists but could not be opened)
+static bool openMutationLog(const std::string& zcb, BlockBuffer& bb, const HeaderRecord& hdr, uint32_t& replayed)
+{
+    replayed = 0;
+    if (!bb.openWriteAheadLog(hdr.getBlockSize(), hdr.getHeaderSize())) {
+        if (std::filesystem::exists(WriteAheadLog::pathFor(zcb))) {
+            std::cerr << "Error: " << bb.getLastError() << "\n";
+            return false;
+        }
+        std::cerr << "Write-ahead log unavailable (" << bb.getLastError() << "), writing blocks directly\n";
+        return true;
+    }
+    replayed = bb.getBlocksRecovered();
+    if (replayed > 0) {
+        std::cout << "RECOVER: replayed " << replayed << " blocks from the write-ahead log\n";
+    }
+    return true;
+}
+
+// drop the free blocks closeFreeSpaceMap trimmed off the end of the file
+static void truncateToBlocks(const std::string& zcb, const HeaderRecord& hdr, uint32_t blocks)
+{
+    const uintmax_t size = hdr.getHeaderSize() + static_cast<uintmax_t>(blocks) * hdr.getBlockSize();
+    std::error_code ec;
+    if (std::filesystem::file_size(zcb, ec) > size && !ec) {
+        std::filesystem::resize_file(zcb, size, ec);
+        if (ec) std::cerr << "Could not truncate " << zcb << ": " << ec.message() << "\n";
+    }
+}
+
+// check closeFile: a failed write-back or checkpoint may have left committed blocks out of the file,
+// the caller then keeps the stale flag set so recover or the next add or del rebuilds the indexes
+static bool closedCleanly(const std::string& zcb, const BlockBuffer& bb)
+{
+    if (!bb.hasError()) return true;
+    std::cerr << "Error: " << bb.getLastError() << "\n"
+              << zcb << " left marked stale, run recover\n";
+    return false;
+}
+
+// persist both indexes, rebuilding stale ones from the chain, and clear the stale flag once both match it
+static void closeMutationIndexes(const std::string& zcb, HeaderRecord& hdr, MutationIndexes& ix)
+{
+    ix.tree.close();
+    if (ix.treeStale || ix.indexStale) {
+        BlockIndexFile chain;
+        if (!chain.createIndexFromBlockedFile(zcb, hdr.getBlockSize(), hdr.getHeaderSize(),
+                                              hdr.getSequenceSetListRBN())) {
+            std::cerr << "Error: cannot read the sequence set of " << zcb << "\n";
+        }
+        else {
+            if (ix.treeStale) {
+                ix.treeStale = !rebuildIndexSet(zcb, hdr.getBlockSize(), chain.getEntries());
+                if (ix.treeStale) std::cerr << "Error: failed to rebuild index set for " << zcb << "\n";
+            }
+            if (ix.indexStale) {
+                ix.index = chain;
+                ix.indexStale = false;
+            }
+        }
+    }
+    if (!ix.indexStale && !ix.index.write(hdr.getIndexFileName())) {
+        ix.indexStale = true;
+    }
+    hdr.setStaleFlag(ix.treeStale || ix.indexStale ? 1 : 0);
+}
+
 int main(int argc, char* argv[]) 
 {
     if (argc < 2) {
@@ -512,7 +961,55 @@ int main(int argc, char* argv[])
         }
         uint32_t blockSize = (argc >= 5) ? std::atoi(argv[4]) : 1024;
         uint16_t minBlockSize = (argc >= 6) ? std::atoi(argv[5]) : 256;
-        return convertCSVToBlockedSequenceSet(argv[2], argv[3], blockSize, minBlockSize) ? 0 : 1;
+        uint8_t recordFormat = RecordBuffer::BINARY_RECORDS;
+        if (argc >= 7 && !parseRecordFormat(argv[6], recordFormat)) {
+            std::cerr << "Error: record format must be text, binary or slotted\n";
+            return 1;
+        }
+        const size_t sortMemory = (argc >= 8) ? static_cast<size_t>(std::atoi(argv[7])) << 20 : 0;
+        const double fillFactor = (argc >= 9) ? std::stod(argv[8]) : 1.0;
+        if (fillFactor <= 0.0 || fillFactor > 1.0) {
+            std::cerr << "Error: fillFactor must be in (0, 1]\n";
+            return 1;
+        }
+        const long blockReserve = (argc >= 10) ? std::atol(argv[9]) : 0;
+        if (blockReserve < 0 || blockReserve >= static_cast<long>(blockSize) ||
+            blockReserve > std::numeric_limits<uint16_t>::max()) {
+            std::cerr << "Error: reserveBytes must be at least 0 and less than blockSize (at most 65535)\n";
+            return 1;
+        }
+        return convertCSVToBlockedSequenceSet(argv[2], argv[3], blockSize, minBlockSize, recordFormat,
+                                              sortMemory, fillFactor, static_cast<uint16_t>(blockReserve)) ? 0 : 1;
+    }
+    else if (command == "convert-format")
+    {
+        uint8_t recordFormat = RecordBuffer::BINARY_RECORDS;
+        if (argc != 4 || !parseRecordFormat(argv[3], recordFormat)) {
+            std::cerr << "Error: convert-format requires a blocked file and a format (text, binary or slotted)\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        return convertBlockedFormat(argv[2], recordFormat) ? 0 : 1;
+    }
+    else if (command == "reorganize")
+    {
+        if (argc < 3 || argc > 5) {
+            std::cerr << "Error: reorganize requires a blocked file\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        // Settings not given come from the header
+        const double fillFactor = (argc >= 4) ? std::stod(argv[3]) : -1.0;
+        if (argc >= 4 && (fillFactor <= 0.0 || fillFactor > 1.0)) {
+            std::cerr << "Error: fillFactor must be in (0, 1]\n";
+            return 1;
+        }
+        const long blockReserve = (argc >= 5) ? std::atol(argv[4]) : -1;
+        if (argc >= 5 && blockReserve < 0) {
+            std::cerr << "Error: reserveBytes must be at least 0\n";
+            return 1;
+        }
+        return reorganizeBlockedFile(argv[2], fillFactor, blockReserve) ? 0 : 1;
     }
     else if (command == "read") 
     {
@@ -549,6 +1046,24 @@ int main(int argc, char* argv[])
     std::cout << (ok ? "IDENTICAL\n" : "DIFFER\n");
     return ok ? 0 : 2;
     }
+    else if (command == "extremes")
+    {
+        if (argc < 3 || argc > 4) {
+            std::cerr << "Error: extremes requires a blocked file\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        unsigned threads = (argc == 4) ? static_cast<unsigned>(std::atoi(argv[3])) : 0;
+        try {
+            DataManager mgr;
+            mgr.processFromBlockedParallel(argv[2], threads);
+            mgr.printTable(std::cout);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
     else if (command == "zcd-search") {
     if (argc < 5) { printUsage(argv[0]); return 1; }
 
@@ -569,28 +1084,99 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    // Handle one or more ZIPs on the command line
+    // Resolve every ZIP first, then read the records in file order through one stream
+    struct Lookup { size_t request; size_t offset; std::string record; bool ok; };
+    std::vector<uint32_t> zips;
+    std::vector<Lookup> lookups;
     for (int i = 4; i < argc; ++i) {
-        uint32_t zip = static_cast<uint32_t>(std::stoul(argv[i]));
-        auto offsets = idx.find(zip);
+        const uint32_t zip = static_cast<uint32_t>(std::stoul(argv[i]));
+        for (size_t off : idx.find(zip)) {
+            lookups.push_back(Lookup{zips.size(), off, std::string(), false});
+        }
+        zips.push_back(zip);
+    }
+    std::sort(lookups.begin(), lookups.end(),
+              [](const Lookup& a, const Lookup& b) { return a.offset < b.offset; });
 
-        if (offsets.empty()) {
-            std::cout << zip << ": NOT FOUND\n";
+    std::ifstream in(zcdPath, std::ios::binary);
+    for (Lookup& lookup : lookups) {
+        lookup.ok = in.is_open() &&
+                    readLengthIndicatedRecordAt(in, static_cast<uint64_t>(lookup.offset), lookup.record);
+    }
+
+    // Back to request order, offsets of one ZIP stay ascending
+    std::stable_sort(lookups.begin(), lookups.end(),
+                     [](const Lookup& a, const Lookup& b) { return a.request < b.request; });
+    size_t next = 0;
+    for (size_t r = 0; r < zips.size(); ++r) {
+        if (next == lookups.size() || lookups[next].request != r) {
+            std::cout << zips[r] << ": NOT FOUND\n";
             continue;
         }
-
-        for (size_t off : offsets) {
-            std::string rec;
-            if (!readLengthIndicatedRecordAt(zcdPath, static_cast<uint64_t>(off), rec)) {
-                std::cout << zip << ": BAD OFFSET " << off << "\n";
+        for (; next < lookups.size() && lookups[next].request == r; ++next) {
+            if (!lookups[next].ok) {
+                std::cout << zips[r] << ": BAD OFFSET " << lookups[next].offset << "\n";
                 continue;
             }
-            // rec is "zip,location,state,county,lat,lon"
-            std::cout << zip << ": " << rec << "\n";
+            // record is "zip,location,state,county,lat,lon"
+            std::cout << zips[r] << ": " << lookups[next].record << "\n";
         }
     }
     return 0;
     }
+    else if (command == "range")
+{
+    if (argc < 5 || argc > 7) {
+        std::cerr << "Usage: " << argv[0] << " range <blocked.zcb> <lo> <hi> [limit] [offset]\n";
+        return 1;
+    }
+    const std::string zcb = argv[2];
+    uint32_t lo = 0, hi = 0;
+    size_t limit = 0, offset = 0;
+    try {
+        lo = static_cast<uint32_t>(std::stoul(argv[3]));
+        hi = static_cast<uint32_t>(std::stoul(argv[4]));
+        if (argc > 5) limit = static_cast<size_t>(std::stoull(argv[5]));
+        if (argc > 6) offset = static_cast<size_t>(std::stoull(argv[6]));
+    } catch (...) {
+        std::cerr << "Error: lo, hi, limit and offset must be numbers\n";
+        return 1;
+    }
+
+    HeaderRecord hdr; HeaderBuffer hb;
+    if (!hb.readHeader(zcb, hdr)) {
+        std::cerr << "Error: bad or missing header in " << zcb << "\n";
+        return 1;
+    }
+
+    BlockBuffer bb;
+    if (!bb.openMappedFile(zcb, hdr.getHeaderSize()) && !bb.openFile(zcb, hdr.getHeaderSize())) {
+        std::cerr << "Error: cannot open " << zcb << "\n";
+        return 1;
+    }
+    bb.setRecordFormat(hdr.getSizeFormatType());
+
+    // seek to the block of lo through the index, then stream along the chain;
+    // with the stale flag set neither index is trusted and the chain is walked instead
+    MutationIndexes ix;
+    if (hdr.getStaleFlag()) {
+        ix.treeStale = true;
+        ix.indexStale = true;
+    }
+    else {
+        openMutationIndexes(zcb, hdr, false, ix);
+    }
+    const uint32_t start = routeToBlock(ix, bb, hdr.getSequenceSetListRBN(), lo, hdr);
+
+    const size_t printed = bb.scanRange(start, lo, hi, hdr.getBlockSize(), hdr.getHeaderSize(), offset, limit,
+                                        [](const ZipCodeRecordView& view) {
+        std::cout << view.getZipCode() << "," << view.getLocationName() << "," << view.getState() << ","
+                  << view.getCounty() << "," << view.getLatitude() << "," << view.getLongitude() << "\n";
+        return true;
+    });
+    std::cout << "RANGE: " << printed << " records\n";
+    return 0;
+}
     else if (command == "dump-physical")
 {
     if (argc != 3) {
@@ -650,12 +1236,17 @@ else if (command == "dump-logical")
 }
 else if (command == "add")
 {
-    if (argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " add <blocked.zcb> <records.csv>\n";
+    if (argc != 4 && argc != 5) {
+        std::cerr << "Usage: " << argv[0] << " add <blocked.zcb> <records.csv> [fillFactor]\n";
         return 1;
     }
     const std::string zcb = argv[2];
     const std::string recFile = argv[3];
+    const double fillFactor = (argc == 5) ? std::stod(argv[4]) : BlockBuffer::DEFAULT_FILL_FACTOR;
+    if (fillFactor <= 0.0 || fillFactor > 1.0) {
+        std::cerr << "Error: fillFactor must be in (0, 1]\n";
+        return 1;
+    }
 
     HeaderRecord hdr; HeaderBuffer hb;
     if (!hb.readHeader(zcb, hdr)) {
@@ -668,51 +1259,97 @@ else if (command == "add")
         std::cerr << "Error: cannot open " << zcb << "\n";
         return 1;
     }
-
+    bb.setRecordFormat(hdr.getSizeFormatType()); // keep the file's record format
     std::ifstream in(recFile);
     if (!in) { std::cerr << "Error: cannot open " << recFile << "\n"; return 1; }
 
-    RecordBuffer rb;
+    bool interrupted = false;
+    if (!beginMutation(zcb, hb, hdr, interrupted)) return 1;
+    uint32_t replayed = 0;
+    if (!openMutationLog(zcb, bb, hdr, replayed)) return 1;
+
     uint32_t avail = static_cast<uint32_t>(hdr.getAvailableListRBN());
     uint32_t blocks = hdr.getBlockCount();
     uint32_t seqHead = hdr.getSequenceSetListRBN();
     if (seqHead == 0) { std::cerr << "Error: empty sequence set.\n"; return 1; }
+    if (!bb.openFreeSpaceMap(avail, blocks, hdr.getBlockSize(), hdr.getHeaderSize())) {
+        std::cerr << "Free space map unavailable (" << bb.getLastError() << "), using the avail list\n";
+    }
+
+    // Keep the index set and the flat index in step with every split and borrow, and route through them
+    MutationIndexes ix;
+    openMutationIndexes(zcb, hdr, interrupted || replayed > 0, ix);
 
-    size_t added = 0;
+    // Read the whole feed and sort it so every target block is merged exactly once
+    std::vector<ZipCodeRecord> feed;
     std::string line;
     while (std::getline(in, line)) {
         if (line.empty()) continue;
         ZipCodeRecord rec;
-        if (!parseOneCSVLine(line, rec)) {
+        if (!RecordTokenizer::parseRecord(line, rec)) {
             std::cerr << "Skip bad line: " << line << "\n"; continue;
         }
-        uint32_t target = findTargetBlockRBN(bb, seqHead, rec.getZipCode(),
-                                             hdr.getBlockSize(), hdr.getHeaderSize(), rb);
-
-        uint32_t blocksBefore = blocks;
-        uint32_t availBefore  = avail;
-
-        if (!bb.addRecord(target, hdr.getBlockSize(), avail, rec, hdr.getHeaderSize(), blocks)) {
-            std::cerr << "ADD failed for zip " << rec.getZipCode() << "\n";
-            continue;
+        feed.push_back(rec);
+    }
+    std::stable_sort(feed.begin(), feed.end(),
+        [](const ZipCodeRecord& a, const ZipCodeRecord& b)
+        {
+            return a.getZipCode() < b.getZipCode();
+        });
+
+    // One forward pass: each run of keys routed to the same block is one addSortedRecords call
+    BatchStats stats = {};
+    size_t first = 0;
+    while (first < feed.size()) {
+        const uint32_t target = routeToBlock(ix, bb, seqHead, feed[first].getZipCode(), hdr);
+        size_t last = first + 1;
+        while (last < feed.size() &&
+               routeToBlock(ix, bb, seqHead, feed[last].getZipCode(), hdr) == target) {
+            ++last;
         }
-        ++added;
 
-        // Log split if block count changed or avail head consumed
-        if (blocks != blocksBefore || avail != availBefore) {
-            std::cout << "SPLIT: added zip " << rec.getZipCode()
-                      << " (blocks " << blocksBefore << "→" << blocks
-                      << ", availHead " << availBefore << "→" << avail << ")\n";
+        std::vector<ZipCodeRecord> run(feed.begin() + first, feed.begin() + last);
+        const uint32_t blocksBefore = stats.blocksAllocated;
+        const bool ok = bb.addSortedRecords(target, hdr.getBlockSize(), avail, run,
+                                            hdr.getHeaderSize(), blocks, fillFactor, stats);
+        applyIndexChanges(bb, ix);
+        if (!ok) {
+            std::cerr << "ADD failed for block " << target << ": " << bb.getLastError() << "\n";
         }
+        else if (stats.blocksAllocated != blocksBefore) {
+            std::cout << "SPLIT: block " << target << " took " << run.size() << " records into "
+                      << (stats.blocksAllocated - blocksBefore + 1) << " blocks\n";
+        }
+        first = last;
+    }
+    const size_t added = stats.recordsAdded;
+
+    // write back buffered blocks before the header is touched
+    const bool trimmed = bb.closeFreeSpaceMap(blocks);
+    bb.closeFile();
+    const bool written = closedCleanly(zcb, bb);
+    if (trimmed) {
+        truncateToBlocks(zcb, hdr, blocks);
+        std::cout << "FREE: " << bb.getFreeSpaceMap().getFreeCount() << " of " << blocks << " blocks free\n";
     }
+    std::cout << "CACHE: hits=" << bb.getCacheHits() << " misses=" << bb.getCacheMisses()
+              << " blockWrites=" << bb.getBlockWrites() << "\n";
+    std::cout << "WAL: commits=" << bb.getWriteAheadLog().getCommits()
+              << " blocksLogged=" << bb.getWriteAheadLog().getBlocksLogged()
+              << " checkpoints=" << bb.getWriteAheadLog().getCheckpoints() << "\n";
+
+    if (written) closeMutationIndexes(zcb, hdr, ix);
 
     // persist header
     hdr.setAvailableListRBN(static_cast<int32_t>(avail));
     hdr.setBlockCount(blocks);
-    hb.writeHeader(zcb, hdr);
+    if (!hb.updateHeader(zcb, hdr)) std::cerr << "Error: " << hb.getLastError() << "\n";
 
+    std::cout << "BATCH: blocksRead=" << stats.blocksRead << " blocksWritten=" << stats.blocksWritten
+              << " blocksAllocated=" << stats.blocksAllocated
+              << " duplicatesSkipped=" << stats.duplicatesSkipped << "\n";
     std::cout << "ADD: inserted " << added << " records.\n";
-    return 0;
+    return written ? 0 : 1;
 }
 else if (command == "del")
 {
@@ -734,53 +1371,138 @@ else if (command == "del")
         std::cerr << "Error: cannot open " << zcb << "\n";
         return 1;
     }
-
+    bb.setRecordFormat(hdr.getSizeFormatType()); // keep the file's record format
     std::ifstream in(keyFile);
     if (!in) { std::cerr << "Error: cannot open " << keyFile << "\n"; return 1; }
 
-    RecordBuffer rb;
+    bool interrupted = false;
+    if (!beginMutation(zcb, hb, hdr, interrupted)) return 1;
+    uint32_t replayed = 0;
+    if (!openMutationLog(zcb, bb, hdr, replayed)) return 1;
+
     uint32_t avail = static_cast<uint32_t>(hdr.getAvailableListRBN());
     uint32_t blocks = hdr.getBlockCount();
     uint32_t seqHead = hdr.getSequenceSetListRBN();
     if (seqHead == 0) { std::cerr << "Error: empty sequence set.\n"; return 1; }
+    if (!bb.openFreeSpaceMap(avail, blocks, hdr.getBlockSize(), hdr.getHeaderSize())) {
+        std::cerr << "Free space map unavailable (" << bb.getLastError() << "), using the avail list\n";
+    }
+
+    // Keep the index set and the flat index in step with every merge and borrow, and route through them
+    MutationIndexes ix;
+    openMutationIndexes(zcb, hdr, interrupted || replayed > 0, ix);
 
-    size_t removed = 0;
+    // Read every key first so all keys of a block are removed in one pass
+    std::vector<uint32_t> keys;
     std::string s;
     while (std::getline(in, s)) {
         if (s.empty()) continue;
-        uint32_t zip = 0;
-        try { zip = static_cast<uint32_t>(std::stoul(s)); } catch (...) { continue; }
-
-        // find candidate block by walking until highest >= zip
-        uint32_t target = findTargetBlockRBN(bb, seqHead, zip,
-                                             hdr.getBlockSize(), hdr.getHeaderSize(), rb);
-        uint32_t availBefore  = avail;
-        uint32_t blocksBefore = blocks;
-
-        bool ok = bb.removeRecordAtRBN(target,
-                                       static_cast<uint16_t>(hdr.getMinBlockSize()),
-                                       avail, zip, hdr.getBlockSize(), hdr.getHeaderSize());
-        if (!ok) {
-            std::cout << "DELETE: zip " << zip << " not found (or unchanged)\n";
-            continue;
+        try { keys.push_back(static_cast<uint32_t>(std::stoul(s))); } catch (...) { continue; }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    // Group keys by the block they route to; nothing moves until the batch runs,
+    // so the index is consistent for every lookup (chain walk only if no index is usable)
+    std::vector<BlockKeyGroup> groups;
+    for (const uint32_t zip : keys) {
+        const uint32_t target = routeToBlock(ix, bb, seqHead, zip, hdr);
+        if (groups.empty() || groups.back().rbn != target) {
+            groups.push_back(BlockKeyGroup{target, {}});
         }
-        ++removed;
+        groups.back().zipCodes.push_back(zip);
+    }
 
-        // Log merge/redistribution heuristic (we don’t have explicit flags; rely on counters)
-        if (blocks != blocksBefore || avail != availBefore) {
-            std::cout << "MERGE/REDIST: removed zip " << zip
-                      << " (blocks " << blocksBefore << "→" << blocks
-                      << ", availHead " << availBefore << "→" << avail << ")\n";
-        }
+    BatchStats stats = {};
+    const bool ok = bb.removeSortedKeys(groups, static_cast<uint16_t>(hdr.getMinBlockSize()),
+                                        avail, hdr.getBlockSize(), hdr.getHeaderSize(), stats);
+    applyIndexChanges(bb, ix);
+    if (!ok) {
+        std::cerr << "DELETE failed: " << bb.getLastError() << "\n";
     }
+    if (stats.keysMissing > 0) {
+        std::cout << "DELETE: " << stats.keysMissing << " keys not found\n";
+    }
+    const size_t removed = stats.recordsRemoved;
+
+    // write back buffered blocks before the header is touched
+    const bool trimmed = bb.closeFreeSpaceMap(blocks);
+    bb.closeFile();
+    const bool written = closedCleanly(zcb, bb);
+    if (trimmed) {
+        truncateToBlocks(zcb, hdr, blocks);
+        std::cout << "FREE: " << bb.getFreeSpaceMap().getFreeCount() << " of " << blocks << " blocks free\n";
+    }
+    std::cout << "CACHE: hits=" << bb.getCacheHits() << " misses=" << bb.getCacheMisses()
+              << " blockWrites=" << bb.getBlockWrites() << "\n";
+    std::cout << "WAL: commits=" << bb.getWriteAheadLog().getCommits()
+              << " blocksLogged=" << bb.getWriteAheadLog().getBlocksLogged()
+              << " checkpoints=" << bb.getWriteAheadLog().getCheckpoints() << "\n";
+
+    if (written) closeMutationIndexes(zcb, hdr, ix);
 
     // persist header
     hdr.setAvailableListRBN(static_cast<int32_t>(avail));
     hdr.setBlockCount(blocks);
-    hb.writeHeader(zcb, hdr);
+    if (!hb.updateHeader(zcb, hdr)) std::cerr << "Error: " << hb.getLastError() << "\n";
 
+    std::cout << "BATCH: blocksRead=" << stats.blocksRead << " blocksWritten=" << stats.blocksWritten
+              << " blocksFreed=" << stats.blocksFreed << "\n";
     std::cout << "DEL: removed " << removed << " keys.\n";
-    return 0;
+    return written ? 0 : 1;
+}
+else if (command == "recover")
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " recover <blocked.zcb>\n";
+        return 1;
+    }
+    const std::string zcb = argv[2];
+
+    HeaderRecord hdr; HeaderBuffer hb;
+    if (!hb.readHeader(zcb, hdr)) {
+        std::cerr << "Error: bad header in " << zcb << "\n";
+        return 1;
+    }
+
+    BlockBuffer bb;
+    if (!bb.openFile(zcb, hdr.getHeaderSize())) {
+        std::cerr << "Error: cannot open " << zcb << ": " << bb.getLastError() << "\n";
+        return 1;
+    }
+    bool interrupted = false;
+    if (!beginMutation(zcb, hb, hdr, interrupted)) return 1;
+    // opening the log replays it, it cannot be opened while a running writer holds it
+    if (!bb.openWriteAheadLog(hdr.getBlockSize(), hdr.getHeaderSize()) &&
+        std::filesystem::exists(WriteAheadLog::pathFor(zcb))) {
+        std::cerr << "Error: " << bb.getLastError() << "\n";
+        return 1;
+    }
+    const uint32_t replayed = bb.getBlocksRecovered();
+
+    // replayed blocks may have grown the file or freed blocks, bring the header back in step
+    uint32_t avail = static_cast<uint32_t>(hdr.getAvailableListRBN());
+    uint32_t blocks = hdr.getBlockCount();
+    if (!bb.openFreeSpaceMap(avail, blocks, hdr.getBlockSize(), hdr.getHeaderSize())) {
+        std::cerr << "Free space map unavailable (" << bb.getLastError() << ")\n";
+    }
+    const bool trimmed = bb.closeFreeSpaceMap(blocks);
+    bb.closeFile();
+    const bool written = closedCleanly(zcb, bb);
+    if (trimmed) truncateToBlocks(zcb, hdr, blocks);
+
+    // an interrupted add or del may have left either index behind the chain, even with nothing to replay
+    if (written) {
+        MutationIndexes ix;
+        openMutationIndexes(zcb, hdr, interrupted || replayed > 0, ix);
+        closeMutationIndexes(zcb, hdr, ix);
+    }
+    hdr.setAvailableListRBN(static_cast<int32_t>(avail));
+    hdr.setBlockCount(blocks);
+    if (!hb.updateHeader(zcb, hdr)) std::cerr << "Error: " << hb.getLastError() << "\n";
+
+    std::cout << "RECOVER: replayed " << replayed << " blocks, " << blocks << " blocks in the file\n";
+    return written ? 0 : 1;
 }
 else if (command == "dump-block" && argc == 4) {
     const std::string zcb = argv[2];
@@ -800,11 +1522,10 @@ else if (command == "dump-block" && argc == 4) {
         auto ab = bb.loadAvailBlockAtRBN(rbn, hdr.getBlockSize(), hdr.getHeaderSize());
         std::cout << "  *available*  nextAvail=" << ab.succeedingRBN << "\n";
     } else {
-        std::vector<ZipCodeRecord> recs;
-        RecordBuffer rb;
-        rb.unpackBlock(blk.data, recs);
+        BlockRecordIterator it(blk.data.data(), blk.data.size());
+        ZipCodeRecordView view;
         std::cout << "  zips: ";
-        for (auto &r : recs) std::cout << r.getZipCode() << " ";
+        while (it.next(view)) std::cout << view.getZipCode() << " ";
         std::cout << "\n";
     }
     return 0;
@@ -0,0 +1,334 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <algorithm>
+
+#include "ZipSearchApp.h"
+
+#if ZCD_HAS_UNIX_SOCKETS
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/**
+ * Client and load generator for the query server (search <file.zcb> --serve <socket>)
+ *
+ * Interactive: every stdin line is sent as a request and its reply printed.
+ * Load: each connection sends requests back to back (one outstanding request per
+ * connection) with zips drawn at random from a list, then reports QPS and the
+ * p50 / p99 / max request latency.
+ *   get   : GET <zip>
+ *   batch : BATCH with <size> zips
+ *   range : RANGE <zip> <zip + size>
+ *
+ * Usage: ZipQueryClient <socket>
+ *        ZipQueryClient <socket> --load <zips> [requests] [connections] [get|batch|range] [size]
+ * <zips> is a file whose lines start with a zip code, e.g. one of the CSV data files.
+ */
+
+const size_t DEFAULT_REQUESTS = 100000;
+const size_t DEFAULT_CONNECTIONS = 4;
+const uint32_t DEFAULT_SIZE = 16;
+
+#if ZCD_HAS_UNIX_SOCKETS
+
+/**
+ * @class QueryConnection
+ * @brief One client connection reading replies line by line
+ */
+class QueryConnection
+{
+public:
+    QueryConnection() : fd(-1), buffered(), start(0) {}
+
+    ~QueryConnection()
+    {
+        if (fd >= 0) ::close(fd);
+    }
+
+    /**
+     * @brief Connect to a server socket
+     * @param socketPath [IN] Path of the socket
+     * @return True if connected
+     */
+    bool connectTo(const std::string& socketPath)
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) return false;
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        return fd >= 0 && ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    /**
+     * @brief Send one request line
+     */
+    bool send(const std::string& request)
+    {
+        const std::string line = request + "\n";
+        size_t written = 0;
+        while (written < line.size())
+        {
+            const ssize_t n = ::write(fd, line.data() + written, line.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Read the next reply line without its newline
+     * @return False if the server closed the connection
+     */
+    bool readLine(std::string& line)
+    {
+        for (;;)
+        {
+            const size_t newline = buffered.find('\n', start);
+            if (newline != std::string::npos)
+            {
+                line.assign(buffered, start, newline - start);
+                start = newline + 1;
+                return true;
+            }
+            buffered.erase(0, start);
+            start = 0;
+
+            char chunk[65536];
+            const ssize_t got = ::read(fd, chunk, sizeof(chunk));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            buffered.append(chunk, static_cast<size_t>(got));
+        }
+    }
+
+    /**
+     * @brief Read the whole reply to a request
+     * @details RANGE and BATCH replies end with an END line, everything else is one line
+     * @param request [IN] The request that was sent
+     * @param lines [OUT] Reply lines
+     * @return False if the connection closed before the reply was complete
+     */
+    bool readReply(const std::string& request, std::vector<std::string>& lines)
+    {
+        lines.clear();
+        const bool multiLine = request.compare(0, 5, "RANGE") == 0 || request.compare(0, 5, "BATCH") == 0;
+        std::string line;
+        while (readLine(line))
+        {
+            lines.push_back(line);
+            if (!multiLine || line.compare(0, 3, "END") == 0 || line.compare(0, 3, "ERR") == 0) return true;
+        }
+        return false;
+    }
+
+private:
+    int fd; // Socket
+    std::string buffered; // Bytes read but not yet returned
+    size_t start; // First unreturned byte in buffered
+};
+
+/**
+ * @brief Results of one load connection
+ */
+struct LoadResult
+{
+    std::vector<double> latencies; // Microseconds per request
+    size_t errors = 0; // Requests answered with ERR or not answered
+    size_t records = 0; // OK lines received
+};
+
+/**
+ * @brief Send requests back to back on one connection
+ */
+static void runConnection(const std::string& socketPath, const std::vector<uint32_t>& zips,
+                          const size_t requests, const std::string& op, const uint32_t size,
+                          const unsigned seed, LoadResult& result)
+{
+    QueryConnection connection;
+    if (!connection.connectTo(socketPath))
+    {
+        result.errors = requests;
+        return;
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, zips.size() - 1);
+    std::vector<std::string> lines;
+    result.latencies.reserve(requests);
+
+    for (size_t i = 0; i < requests; ++i)
+    {
+        std::string request;
+        if (op == "batch")
+        {
+            request = "BATCH";
+            for (uint32_t k = 0; k < size; ++k) request += " " + std::to_string(zips[pick(rng)]);
+        }
+        else if (op == "range")
+        {
+            const uint32_t lo = zips[pick(rng)];
+            request = "RANGE " + std::to_string(lo) + " " + std::to_string(lo + size);
+        }
+        else
+        {
+            request = "GET " + std::to_string(zips[pick(rng)]);
+        }
+
+        const auto begin = std::chrono::steady_clock::now();
+        if (!connection.send(request) || !connection.readReply(request, lines))
+        {
+            result.errors += requests - i;
+            return;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - begin;
+        result.latencies.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+
+        for (const std::string& line : lines)
+        {
+            if (line.compare(0, 3, "ERR") == 0) ++result.errors;
+            else if (line.compare(0, 2, "OK") == 0) ++result.records;
+        }
+    }
+    connection.send("QUIT");
+}
+
+/**
+ * @brief Read the leading zip of every line, lines without one (CSV headers) are skipped
+ */
+static std::vector<uint32_t> readZips(const std::string& filename)
+{
+    std::vector<uint32_t> zips;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t digits = 0;
+        while (digits < line.size() && digits < 9 && line[digits] >= '0' && line[digits] <= '9') ++digits;
+        if (digits > 0) zips.push_back(static_cast<uint32_t>(std::stoul(line.substr(0, digits))));
+    }
+    return zips;
+}
+
+static double percentile(const std::vector<double>& sorted, const double fraction)
+{
+    if (sorted.empty()) return 0;
+    const size_t rank = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+static int runLoad(const std::string& socketPath, int argc, char* argv[])
+{
+    const std::vector<uint32_t> zips = readZips(argv[3]);
+    const size_t requests = argc > 4 ? static_cast<size_t>(std::stoull(argv[4])) : DEFAULT_REQUESTS;
+    const size_t connections = std::max<size_t>(1, argc > 5 ? static_cast<size_t>(std::stoull(argv[5])) : DEFAULT_CONNECTIONS);
+    const std::string op = argc > 6 ? argv[6] : "get";
+    const uint32_t size = std::max<uint32_t>(1, argc > 7 ? static_cast<uint32_t>(std::stoul(argv[7])) : DEFAULT_SIZE);
+
+    if (zips.empty())
+    {
+        std::cerr << "No zip codes in " << argv[3] << "\n";
+        return 1;
+    }
+    if (op != "get" && op != "batch" && op != "range")
+    {
+        std::cerr << "Unknown operation: " << op << "\n";
+        return 1;
+    }
+
+    std::vector<LoadResult> results(connections);
+    std::vector<std::thread> workers;
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < connections; ++c)
+    {
+        const size_t share = requests / connections + (c < requests % connections ? 1 : 0);
+        workers.emplace_back(runConnection, std::cref(socketPath), std::cref(zips), share,
+                             std::cref(op), size, static_cast<unsigned>(c + 1), std::ref(results[c]));
+    }
+    for (std::thread& worker : workers) worker.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::vector<double> latencies;
+    size_t errors = 0, records = 0;
+    for (const LoadResult& result : results)
+    {
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        errors += result.errors;
+        records += result.records;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "=== Query Server Load ===\n";
+    std::cout << "operation: " << op;
+    if (op != "get") std::cout << " (size " << size << ")";
+    std::cout << "\nconnections: " << connections << "\n";
+    std::cout << "requests: " << latencies.size() << "  errors: " << errors << "  records: " << records << "\n";
+    std::cout << "seconds: " << seconds << "\n";
+    std::cout << "QPS: " << (seconds > 0 ? latencies.size() / seconds : 0) << "\n";
+    std::cout << "latency (us) p50: " << percentile(latencies, 0.50)
+              << "  p99: " << percentile(latencies, 0.99)
+              << "  max: " << (latencies.empty() ? 0 : latencies.back()) << "\n";
+    return errors == 0 ? 0 : 1;
+}
+
+static int runInteractive(const std::string& socketPath)
+{
+    QueryConnection connection;
+    if (!connection.connectTo(socketPath))
+    {
+        std::cerr << "Cannot connect to " << socketPath << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    std::string request;
+    std::vector<std::string> lines;
+    while (std::getline(std::cin, request))
+    {
+        if (request.empty()) continue;
+        if (!connection.send(request) || !connection.readReply(request, lines))
+        {
+            std::cerr << "Connection closed by server\n";
+            return 1;
+        }
+        for (const std::string& line : lines) std::cout << line << "\n";
+        std::cout.flush();
+        if (request == "QUIT" || request == "SHUTDOWN") break;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || (argc > 2 && (std::string(argv[2]) != "--load" || argc < 4)))
+    {
+        std::cout << "Usage: " << argv[0] << " <socket>\n";
+        std::cout << "       " << argv[0] << " <socket> --load <zips> [requests] [connections] [get|batch|range] [size]\n";
+        std::cout << "Example: " << argv[0] << " /tmp/zcd.sock --load data/PT2_Randomized.csv 100000 4 get\n";
+        return 1;
+    }
+
+    if (argc > 2) return runLoad(argv[1], argc, argv);
+    return runInteractive(argv[1]);
+}
+
+#else // !ZCD_HAS_UNIX_SOCKETS
+
+int main()
+{
+    std::cerr << "Unix domain sockets are not supported on this platform\n";
+    return 1;
+}
+
+#endif // ZCD_HAS_UNIX_SOCKETS
@@ -3,6 +3,7 @@
 #include "../src/ZipCodeRecord.h"
 #include "../src/HeaderRecord.h"
 #include "../src/HeaderBuffer.h"
+#include "../src/ZipCodeRecordView.h"
 #include "ZipSearchApp.h"
 #include <iostream>
 #include <sstream>
@@ -12,17 +13,28 @@
 #include <cstring>
 #include <vector>
 
+#if ZCD_HAS_UNIX_SOCKETS
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#endif
+
 const std::string ADD_ARG = "-A";
 const std::string REMOVE_ARG = "-R";
 const std::string SEARCH_ARG = "-S";
 const std::string ZIP_ARG = "-Z";
 
+const size_t MAX_REQUEST_BYTES = 1 << 20; // Longest request line a socket client may send
+
 
-ZipSearchApp::ZipSearchApp(){
+ZipSearchApp::ZipSearchApp() : queryFileOpen(false){
 
 }
 
-ZipSearchApp::ZipSearchApp(const std::string& file){
+ZipSearchApp::ZipSearchApp(const std::string& file) : queryFileOpen(false){
     fileName = file;
 }
 
@@ -43,37 +55,26 @@ bool ZipSearchApp::search(int argc, char* argv[])
         return false;
     }
 
-    // Read header
-    HeaderRecord header;
-    HeaderBuffer headerBuffer;
-    if (!headerBuffer.readHeader(fileName, header)) {
-        std::cerr << "Failed to read header from " << fileName << std::endl;
-        return false;
-    }
-    
-    if(!indexHandler(header)){ 
+    // Header, index and file are opened once for every lookup
+    if (!openForQueries()) {
         return false;
     }
 
-    //search for zip codes
-    const uint32_t headerSize = header.getHeaderSize();
-    const uint32_t blockSize = header.getBlockSize();
-
-    for (const auto& zip : zips) {
-        uint32_t rbn = blockIndexFile.findRBNForKey(zip);
-        if (rbn == static_cast<uint32_t>(-1)) {
-            std::cout << "Zip code " << zip << " not found." << std::endl;
-            continue;
-        }
+    // Each block is read once however many of the zips it holds
+    std::vector<uint32_t> rbns;
+    std::vector<ZipCodeRecord> records;
+    std::vector<bool> found;
+    lookupBatch(zips, rbns, records, found);
 
-        BlockBuffer blockBuffer;
-        ZipCodeRecord record;
-        if (blockBuffer.openFile(fileName, headerSize) && 
-            blockBuffer.readRecordAtRBN(rbn, zip, blockSize, headerSize, record)) {
+    for (size_t i = 0; i < zips.size(); ++i) {
+        if (rbns[i] == static_cast<uint32_t>(-1)) {
+            std::cout << "Zip code " << zips[i] << " not found." << std::endl;
+        } else if (found[i]) {
+            const ZipCodeRecord& record = records[i];
             std::cout << "Found: " << record.getLocationName() << ", " 
                       << record.getState() << " (" << record.getZipCode() << ")" << std::endl;
         } else {
-            std::cout << "Zip code " << zip << " not found in block." << std::endl;
+            std::cout << "Zip code " << zips[i] << " not found in block." << std::endl;
         }
     }
 
@@ -175,6 +176,12 @@ bool ZipSearchApp::indexHandler(const HeaderRecord& header){
     const std::string indexFileName = header.getIndexFileName();
     const uint32_t sequenceSetListRBN = header.getSequenceSetListRBN();
     const bool staleFlag = header.getStaleFlag();
+
+    // The B+tree index set is kept current by add/del, no rebuild needed unless one of them
+    // is running or was interrupted, which leaves the stale flag set
+    if(!staleFlag && indexSet.open(BPlusTreeIndex::pathFor(fileName))){
+        return true;
+    }
     
     if(staleFlag){
         if(!blockIndexFile.createIndexFromBlockedFile(fileName, blockSize, headerSize, sequenceSetListRBN)){
@@ -190,4 +197,315 @@ bool ZipSearchApp::indexHandler(const HeaderRecord& header){
         }
     }
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Append one record as an OK reply line
+ */
+static void appendRecordLine(std::string& reply, const uint32_t zip, const std::string_view place,
+                             const std::string_view state, const std::string_view county,
+                             const double latitude, const double longitude)
+{
+    reply += "OK ";
+    reply += std::to_string(zip);
+    reply += ',';
+    reply += place;
+    reply += ',';
+    reply += state;
+    reply += ',';
+    reply += county;
+    reply += ',';
+    reply += std::to_string(latitude);
+    reply += ',';
+    reply += std::to_string(longitude);
+    reply += '\n';
+}
+
+/**
+ * @brief Parse a zip or count argument of a request
+ * @return False if the token is not a number
+ */
+static bool parseNumber(const std::string& token, uint32_t& value)
+{
+    if (token.empty() || token.find_first_not_of("0123456789") != std::string::npos || token.size() > 9)
+        return false;
+    value = static_cast<uint32_t>(std::stoul(token));
+    return true;
+}
+
+bool ZipSearchApp::openForQueries()
+{
+    if (queryFileOpen) {
+        queryBuffer.closeFile();
+        queryFileOpen = false;
+    }
+    indexSet.close();
+
+    HeaderBuffer headerBuffer;
+    if (!headerBuffer.readHeader(fileName, queryHeader)) {
+        std::cerr << "Failed to read header from " << fileName << std::endl;
+        return false;
+    }
+    if (!indexHandler(queryHeader)) {
+        return false;
+    }
+
+    const uint32_t headerSize = queryHeader.getHeaderSize();
+    queryFileOpen = queryBuffer.openMappedFile(fileName, headerSize) ||
+                    queryBuffer.openFile(fileName, headerSize);
+    if (!queryFileOpen) {
+        std::cerr << "Failed to open " << fileName << std::endl;
+        return false;
+    }
+    queryBuffer.setRecordFormat(queryHeader.getSizeFormatType());
+    return true;
+}
+
+uint32_t ZipSearchApp::lookupRBN(const uint32_t zip)
+{
+    return indexSet.isOpen() ? indexSet.findRBNForKey(zip)
+                             : blockIndexFile.findRBNForKey(zip);
+}
+
+size_t ZipSearchApp::lookupBatch(const std::vector<uint32_t>& zips, std::vector<uint32_t>& rbns,
+                                 std::vector<ZipCodeRecord>& records, std::vector<bool>& found)
+{
+    rbns.resize(zips.size());
+    for (size_t i = 0; i < zips.size(); ++i) {
+        rbns[i] = lookupRBN(zips[i]);
+    }
+    return queryBuffer.readRecordsAtRBNs(zips, rbns, queryHeader.getBlockSize(), queryHeader.getHeaderSize(),
+                                         records, found);
+}
+
+void ZipSearchApp::appendLookup(const uint32_t zip, const ZipCodeRecord* record, std::string& reply)
+{
+    if (record == nullptr) {
+        reply += "NOTFOUND " + std::to_string(zip) + "\n";
+        return;
+    }
+    appendRecordLine(reply, record->getZipCode(), record->getLocationName(), record->getState(),
+                     record->getCounty(), record->getLatitude(), record->getLongitude());
+}
+
+uint32_t ZipSearchApp::appendRange(const uint32_t lo, const uint32_t hi, const size_t limit,
+                                   const size_t offset, std::string& reply)
+{
+    const size_t count = queryBuffer.scanRange(lookupRBN(lo), lo, hi, queryHeader.getBlockSize(),
+                                               queryHeader.getHeaderSize(), offset, limit,
+                                               [&reply](const ZipCodeRecordView& view) {
+        appendRecordLine(reply, view.getZipCode(), view.getLocationName(), view.getState(),
+                         view.getCounty(), view.getLatitude(), view.getLongitude());
+        return true;
+    });
+    return static_cast<uint32_t>(count);
+}
+
+ZipSearchApp::SessionState ZipSearchApp::handleQuery(const std::string& line, std::string& reply)
+{
+    std::istringstream request(line);
+    std::string command;
+    request >> command;
+    std::vector<std::string> args;
+    for (std::string token; request >> token;) args.push_back(token);
+
+    uint32_t lo = 0, hi = 0;
+    if (command == "GET") {
+        if (args.size() != 1 || !parseNumber(args[0], lo)) {
+            reply += "ERR usage: GET <zip>\n";
+            return SESSION_OPEN;
+        }
+        const uint32_t rbn = lookupRBN(lo);
+        ZipCodeRecord record;
+        const bool found = rbn != static_cast<uint32_t>(-1) &&
+            queryBuffer.readRecordAtRBN(rbn, lo, queryHeader.getBlockSize(), queryHeader.getHeaderSize(), record);
+        appendLookup(lo, found ? &record : nullptr, reply);
+    }
+    else if (command == "RANGE") {
+        uint32_t limit = 0, offset = 0;
+        if (args.size() < 2 || args.size() > 4 || !parseNumber(args[0], lo) || !parseNumber(args[1], hi) ||
+            (args.size() > 2 && !parseNumber(args[2], limit)) || (args.size() > 3 && !parseNumber(args[3], offset))) {
+            reply += "ERR usage: RANGE <lo> <hi> [limit [offset]]\n";
+            return SESSION_OPEN;
+        }
+        const uint32_t count = appendRange(lo, hi, limit, offset, reply);
+        reply += "END " + std::to_string(count) + "\n";
+    }
+    else if (command == "BATCH") {
+        std::vector<uint32_t> zips(args.size());
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (!parseNumber(args[i], zips[i])) {
+                reply += "ERR invalid zip: " + args[i] + "\n";
+                return SESSION_OPEN;
+            }
+        }
+        std::vector<uint32_t> rbns;
+        std::vector<ZipCodeRecord> records;
+        std::vector<bool> found;
+        const size_t foundCount = lookupBatch(zips, rbns, records, found);
+        for (size_t i = 0; i < zips.size(); ++i) {
+            appendLookup(zips[i], found[i] ? &records[i] : nullptr, reply);
+        }
+        reply += "END " + std::to_string(foundCount) + "\n";
+    }
+    else if (command == "RELOAD") {
+        reply += openForQueries() ? "OK\n" : "ERR reload failed\n";
+    }
+    else if (command == "PING") {
+        reply += "PONG\n";
+    }
+    else if (command == "QUIT" || command == "SHUTDOWN") {
+        reply += "BYE\n";
+        return command == "QUIT" ? SESSION_CLOSED : SERVER_STOPPED;
+    }
+    else if (!command.empty()) {
+        reply += "ERR unknown command: " + command + "\n";
+    }
+    return SESSION_OPEN;
+}
+
+bool ZipSearchApp::serve(std::istream& in, std::ostream& out)
+{
+    if (!openForQueries()) {
+        return false;
+    }
+
+    std::string line;
+    std::string reply;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        reply.clear();
+        const SessionState state = handleQuery(line, reply);
+        out << reply << std::flush;
+        if (state != SESSION_OPEN) break;
+    }
+    return true;
+}
+
+#if ZCD_HAS_UNIX_SOCKETS
+
+/**
+ * @brief Write a whole reply to a socket
+ */
+static bool writeAll(const int fd, const std::string& data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool ZipSearchApp::serveSocket(const std::string& socketPath)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Invalid socket path: " << socketPath << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    if (!openForQueries()) {
+        return false;
+    }
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(socketPath.c_str());
+    if (listener < 0 ||
+        ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "Cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0) ::close(listener);
+        return false;
+    }
+    std::signal(SIGPIPE, SIG_IGN); // A client that went away only ends its own session
+
+    std::cout << "Serving " << fileName << " on " << socketPath << std::endl;
+
+    // Slot 0 is the listener, every other slot a client with its unfinished request line
+    std::vector<pollfd> fds(1);
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+    std::vector<std::string> pending(1);
+
+    char chunk[4096];
+    std::string reply;
+    bool running = true;
+    while (running) {
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            const int client = ::accept(listener, nullptr, nullptr);
+            if (client >= 0) {
+                pollfd slot;
+                slot.fd = client;
+                slot.events = POLLIN;
+                slot.revents = 0;
+                fds.push_back(slot);
+                pending.emplace_back();
+            }
+        }
+
+        for (size_t i = fds.size() - 1; i >= 1; --i) {
+            if (fds[i].revents == 0) continue;
+
+            bool closeClient = false;
+            const ssize_t got = ::read(fds[i].fd, chunk, sizeof(chunk));
+            if (got <= 0) {
+                closeClient = !(got < 0 && errno == EINTR);
+            }
+            else {
+                // Answer every complete line, all replies go out in one write
+                std::string& buffered = pending[i];
+                buffered.append(chunk, static_cast<size_t>(got));
+                reply.clear();
+                size_t start = 0;
+                size_t newline;
+                while (!closeClient && (newline = buffered.find('\n', start)) != std::string::npos) {
+                    size_t end = newline;
+                    if (end > start && buffered[end - 1] == '\r') --end;
+                    const SessionState state = handleQuery(buffered.substr(start, end - start), reply);
+                    start = newline + 1;
+                    if (state == SERVER_STOPPED) running = false;
+                    if (state != SESSION_OPEN) closeClient = true;
+                }
+                buffered.erase(0, start);
+                if (buffered.size() > MAX_REQUEST_BYTES) {
+                    reply += "ERR request too long\n";
+                    closeClient = true;
+                }
+                if (!writeAll(fds[i].fd, reply)) closeClient = true;
+            }
+
+            if (closeClient) {
+                ::close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                pending.erase(pending.begin() + i);
+            }
+        }
+    }
+
+    for (size_t i = 1; i < fds.size(); ++i) ::close(fds[i].fd);
+    ::close(listener);
+    ::unlink(socketPath.c_str());
+    return true;
+}
+
+#else // !ZCD_HAS_UNIX_SOCKETS
+
+bool ZipSearchApp::serveSocket(const std::string& socketPath)
+{
+    std::cerr << "Unix domain sockets are not supported on this platform: " << socketPath << std::endl;
+    return false;
+}
+
+#endif // ZCD_HAS_UNIX_SOCKETS
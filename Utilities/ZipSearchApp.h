@@ -2,6 +2,8 @@
 #define ZIP_SEARCH_APP
 
 #include "../src/BlockIndexFile.h"
+#include "../src/BPlusTreeIndex.h"
+#include "../src/HeaderRecord.h"
 
 #include "../src/CSVBuffer.h"
 #include "../src/ZipCodeRecord.h"
@@ -13,6 +15,13 @@
 #include <cstring>
 #include <vector>
 
+// Unix domain sockets for serveSocket and ZipQueryClient, independent of ZCD_HAS_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define ZCD_HAS_UNIX_SOCKETS 1
+#else
+#define ZCD_HAS_UNIX_SOCKETS 0
+#endif
+
 class ZipSearchApp {
 public:
     
@@ -46,13 +55,99 @@ public:
      * @return true if args are successfully parsed and removed
      */
     bool remove(int argc, char* argv[]);
+
+    /**
+     * @brief Answer query lines read from a stream until QUIT or end of input
+     * @details The header, index and blocked file are opened once and kept open between
+     *          requests. One request per line, replies are written as lines:
+     *            GET <zip>               OK <record> | NOTFOUND <zip>
+     *            RANGE <lo> <hi> [limit [offset]]
+     *                                    OK <record> per zip in lo..hi in key order, skipping the
+     *                                    first offset and stopping after limit (0 for all), then END <count>
+     *            BATCH <zip> [<zip> ...] one GET reply per zip in request order, then END <found>
+     *            RELOAD                  reopens the file and index after it was modified, OK
+     *            PING                    PONG
+     *            QUIT                    BYE, ends the session
+     *            SHUTDOWN                BYE, also stops a socket server
+     *          A record is written as zip,place,state,county,latitude,longitude. Anything
+     *          else is answered with ERR <message>.
+     * @param in [IN] Request lines
+     * @param out [OUT] Reply lines, flushed after every request
+     * @return False if the file or index could not be opened
+     */
+    bool serve(std::istream& in, std::ostream& out);
+
+    /**
+     * @brief Answer query lines from clients of a Unix domain socket
+     * @details Same protocol as serve(std::istream&, std::ostream&). Clients are served by a
+     *          single thread polling every connection, so requests never wait on a lock.
+     *          Runs until a client sends SHUTDOWN.
+     * @param socketPath [IN] Path of the socket, replaced if it exists
+     * @return False if the file, index or socket could not be opened
+     */
+    bool serveSocket(const std::string& socketPath);
     
 private:
+    /**
+     * @brief What a session does after a request
+     */
+    enum SessionState { SESSION_OPEN, SESSION_CLOSED, SERVER_STOPPED };
+
     std::string fileName;
     BlockIndexFile blockIndexFile;
+    BPlusTreeIndex indexSet; // On-disk index set, preferred over blockIndexFile when present
+
+    HeaderRecord queryHeader; // Header of the file being served
+    BlockBuffer queryBuffer; // Blocked file kept open while serving
+    bool queryFileOpen; // queryBuffer holds the file
 
     bool argsParser(int argc, char* argv[], std::string commandArg, std::vector<uint32_t>& zips);
 
     bool indexHandler(const HeaderRecord& header);
+
+    /**
+     * @brief Open the header, index and blocked file for serve()
+     * @return True if queries can be answered
+     */
+    bool openForQueries();
+
+    /**
+     * @brief RBN of the block that may hold a zip, -1 if it is above every block
+     */
+    uint32_t lookupRBN(const uint32_t zip);
+
+    /**
+     * @brief Answer one request line
+     * @param line [IN] Request without its newline
+     * @param reply [OUT] Reply lines are appended, each ending in a newline
+     * @return What the session does next
+     */
+    SessionState handleQuery(const std::string& line, std::string& reply);
+
+    /**
+     * @brief Look up many zips, reading each block once in ascending RBN order
+     * @param zips [IN] Zips in request order
+     * @param rbns [OUT] Block each zip routes to, -1 if it is above every block
+     * @param records [OUT] Record of each zip in request order
+     * @param found [OUT] True for each zip that was found
+     * @return Number of zips found
+     */
+    size_t lookupBatch(const std::vector<uint32_t>& zips, std::vector<uint32_t>& rbns,
+                       std::vector<ZipCodeRecord>& records, std::vector<bool>& found);
+
+    /**
+     * @brief Append the GET reply for a zip
+     * @param record [IN] The zip's record, nullptr if it was not found
+     */
+    void appendLookup(const uint32_t zip, const ZipCodeRecord* record, std::string& reply);
+
+    /**
+     * @brief Append an OK line per record with a zip in lo..hi, see BlockBuffer::scanRange
+     * @param limit [IN] Most records appended, 0 for no limit
+     * @param offset [IN] Records in range skipped first
+     * @return Number of records appended
+     */
+    uint32_t appendRange(const uint32_t lo, const uint32_t hi, const size_t limit, const size_t offset,
+                         std::string& reply);
 };
 #endif
\ No newline at end of file
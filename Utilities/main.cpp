@@ -1,18 +1,33 @@
 #include "ZipSearchApp.h"
 #include <iostream>
+#include <string>
 
 int main(int argc, char* argv[]) 
 {
     if (argc < 3) 
     {
         std::cout << "Usage: " << argv[0] << " <datafile.zcd> -Z<zipcode> [-Z<zipcode> ...]\n";
+        std::cout << "       " << argv[0] << " <datafile.zcb> --serve [socketPath]\n";
         std::cout << "Example: " << argv[0] << " NotRandomCSV.zcd -Z96737 -Z97134\n";
+        std::cout << "Serve mode keeps the file and index open and answers GET, RANGE and BATCH\n";
+        std::cout << "request lines from stdin, or from clients of the Unix domain socket if given.\n";
         return 1;
     }
     
     std::string dataFile = argv[1];
     
     ZipSearchApp app(dataFile);
+
+    if (std::string(argv[2]) == "--serve")
+    {
+        const bool served = argc > 3 ? app.serveSocket(argv[3]) : app.serve(std::cin, std::cout);
+        if (!served)
+        {
+            std::cerr << "Serve failed.\n";
+            return 1;
+        }
+        return 0;
+    }
     
     if (!app.search(argc, argv)) {
         std::cerr << "Search failed.\n";
@@ -0,0 +1,633 @@
+#include "BPlusTreeIndex.h"
+#include <algorithm>
+#include <cstring>
+
+BPlusTreeIndex::BPlusTreeIndex()
+    : nodeCache(), lastError(), nodeSize(0), height(0), rootNode(0), nodeCount(0),
+      freeNodeHead(0), entryCount(0), headerDirty(false)
+{
+    nodeCache.setWriteBack([this](const CacheFrame& frame)
+    {
+        return writeNodeToFile(frame);
+    });
+}
+
+BPlusTreeIndex::~BPlusTreeIndex()
+{
+    close();
+}
+
+std::string BPlusTreeIndex::pathFor(const std::string& zcbFilePath)
+{
+    return zcbFilePath + ".bpt";
+}
+
+bool BPlusTreeIndex::create(const std::string& filename, const uint32_t nodeSize,
+                            const std::vector<IndexEntry>& entries)
+{
+    close();
+    if (nodeSize < 32)
+    {
+        setError("Node size too small for a B+tree");
+        return false;
+    }
+
+    treeFile.open(filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!treeFile.is_open())
+    {
+        setError("Cannot create index file: " + filename);
+        return false;
+    }
+
+    this->nodeSize = nodeSize;
+    height = 0;
+    rootNode = 0;
+    nodeCount = 0;
+    freeNodeHead = 0;
+    entryCount = static_cast<uint32_t>(entries.size());
+    headerDirty = true;
+
+    // Current level as (highest key, child) pairs, starting with the sequence set blocks
+    std::vector<uint32_t> levelKeys;
+    std::vector<uint32_t> levelChildren;
+    for (const auto& entry : entries)
+    {
+        levelKeys.push_back(entry.key);
+        levelChildren.push_back(entry.recordRBN);
+    }
+
+    bool leafLevel = true;
+    while (!levelKeys.empty())
+    {
+        // Spread the entries evenly so the last node of a level is not nearly empty
+        const size_t count = levelKeys.size();
+        const size_t nodesNeeded = (count + capacity() - 1) / capacity();
+        std::vector<uint32_t> nextKeys;
+        std::vector<uint32_t> nextChildren;
+
+        size_t next = 0;
+        for (size_t n = 0; n < nodesNeeded; ++n)
+        {
+            const size_t take = count / nodesNeeded + ((n < count % nodesNeeded) ? 1 : 0);
+            BPlusNode node;
+            node.isLeaf = leafLevel;
+            node.nextFree = 0;
+            node.keys.assign(levelKeys.begin() + next, levelKeys.begin() + next + take);
+            node.children.assign(levelChildren.begin() + next, levelChildren.begin() + next + take);
+            next += take;
+
+            const uint32_t nodeNumber = allocateNode();
+            if (!storeNode(nodeNumber, node))
+                return false;
+            nextKeys.push_back(node.keys.back());
+            nextChildren.push_back(nodeNumber);
+        }
+
+        ++height;
+        leafLevel = false;
+        if (nodesNeeded == 1)
+        {
+            rootNode = nextChildren.front();
+            break;
+        }
+        levelKeys.swap(nextKeys);
+        levelChildren.swap(nextChildren);
+    }
+
+    return flush();
+}
+
+bool BPlusTreeIndex::open(const std::string& filename)
+{
+    close();
+    treeFile.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+    if (!treeFile.is_open())
+    {
+        setError("Cannot open index file: " + filename);
+        return false;
+    }
+    if (!readHeader())
+    {
+        treeFile.close();
+        return false;
+    }
+    return true;
+}
+
+void BPlusTreeIndex::close()
+{
+    if (!treeFile.is_open())
+        return;
+    if (!flush())
+        setError("Failed to write back index nodes");
+    nodeCache.clear();
+    treeFile.close();
+}
+
+bool BPlusTreeIndex::isOpen() const
+{
+    return treeFile.is_open();
+}
+
+bool BPlusTreeIndex::flush()
+{
+    if (!treeFile.is_open())
+        return false;
+    bool ok = nodeCache.flush();
+    if (headerDirty)
+        ok = writeHeader() && ok;
+    treeFile.flush();
+    return ok && treeFile.good();
+}
+
+uint32_t BPlusTreeIndex::findRBNForKey(const uint32_t zipCode)
+{
+    uint32_t node = rootNode;
+    BPlusNode current;
+    while (node != 0)
+    {
+        if (!loadNode(node, current))
+            return static_cast<uint32_t>(-1);
+
+        // First child whose highest key is >= zipCode
+        auto it = std::lower_bound(current.keys.begin(), current.keys.end(), zipCode);
+        if (it == current.keys.end())
+            return static_cast<uint32_t>(-1);
+
+        const uint32_t child = current.children[it - current.keys.begin()];
+        if (current.isLeaf)
+            return child;
+        node = child;
+    }
+    return static_cast<uint32_t>(-1);
+}
+
+uint32_t BPlusTreeIndex::getTailRBN()
+{
+    uint32_t node = rootNode;
+    BPlusNode current;
+    while (node != 0)
+    {
+        if (!loadNode(node, current) || current.children.empty())
+            return 0;
+        if (current.isLeaf)
+            return current.children.back();
+        node = current.children.back();
+    }
+    return 0;
+}
+
+bool BPlusTreeIndex::insertEntry(const uint32_t key, const uint32_t rbn)
+{
+    if (rootNode == 0)
+    {
+        BPlusNode leaf;
+        leaf.isLeaf = true;
+        leaf.nextFree = 0;
+        leaf.keys.push_back(key);
+        leaf.children.push_back(rbn);
+        rootNode = allocateNode();
+        height = 1;
+        entryCount = 1;
+        headerDirty = true;
+        return storeNode(rootNode, leaf);
+    }
+
+    std::vector<uint32_t> path;
+    std::vector<size_t> slots;
+    if (!descend(key, path, slots, false))
+        return false;
+
+    BPlusNode node;
+    if (!loadNode(path.back(), node))
+        return false;
+
+    auto pos = std::lower_bound(node.keys.begin(), node.keys.end(), key);
+    if (pos != node.keys.end() && *pos == key)
+    {
+        setError("Duplicate index key " + std::to_string(key));
+        return false;
+    }
+    const size_t idx = pos - node.keys.begin();
+    node.keys.insert(pos, key);
+    node.children.insert(node.children.begin() + idx, rbn);
+    ++entryCount;
+    headerDirty = true;
+
+    // Split upwards while a node overflows
+    size_t level = path.size() - 1;
+    while (node.keys.size() > capacity())
+    {
+        const size_t half = node.keys.size() / 2;
+        BPlusNode right;
+        right.isLeaf = node.isLeaf;
+        right.nextFree = 0;
+        right.keys.assign(node.keys.begin() + half, node.keys.end());
+        right.children.assign(node.children.begin() + half, node.children.end());
+        node.keys.resize(half);
+        node.children.resize(half);
+
+        const uint32_t rightNode = allocateNode();
+        if (!storeNode(path[level], node) || !storeNode(rightNode, right))
+            return false;
+
+        if (level == 0)
+        {
+            // Root split, the tree grows by one level
+            BPlusNode root;
+            root.isLeaf = false;
+            root.nextFree = 0;
+            root.keys = {node.keys.back(), right.keys.back()};
+            root.children = {path[0], rightNode};
+            rootNode = allocateNode();
+            ++height;
+            return storeNode(rootNode, root);
+        }
+
+        BPlusNode parent;
+        if (!loadNode(path[level - 1], parent))
+            return false;
+        const size_t slot = slots[level - 1];
+        parent.keys[slot] = node.keys.back();
+        parent.keys.insert(parent.keys.begin() + slot + 1, right.keys.back());
+        parent.children.insert(parent.children.begin() + slot + 1, rightNode);
+        node = parent;
+        --level;
+    }
+
+    return storeNode(path[level], node) &&
+           propagateHighKey(path, slots, level, node.keys.back());
+}
+
+bool BPlusTreeIndex::removeEntry(const uint32_t key, const uint32_t rbn)
+{
+    std::vector<uint32_t> path;
+    std::vector<size_t> slots;
+    BPlusNode node;
+    if (!descend(key, path, slots, true) || !loadNode(path.back(), node))
+        return false;
+
+    const size_t idx = slots.back();
+    if (node.keys[idx] != key || node.children[idx] != rbn)
+    {
+        setError("No index entry for key " + std::to_string(key) + " at RBN " + std::to_string(rbn));
+        return false;
+    }
+    node.keys.erase(node.keys.begin() + idx);
+    node.children.erase(node.children.begin() + idx);
+    --entryCount;
+    headerDirty = true;
+
+    // Empty nodes are released and their entry removed from the parent
+    size_t level = path.size() - 1;
+    while (node.keys.empty())
+    {
+        if (!freeNode(path[level]))
+            return false;
+        if (level == 0)
+        {
+            rootNode = 0;
+            height = 0;
+            return true;
+        }
+        if (!loadNode(path[level - 1], node))
+            return false;
+        const size_t slot = slots[level - 1];
+        node.keys.erase(node.keys.begin() + slot);
+        node.children.erase(node.children.begin() + slot);
+        --level;
+    }
+
+    if (!storeNode(path[level], node) ||
+        !propagateHighKey(path, slots, level, node.keys.back()))
+        return false;
+
+    // A root with a single child is replaced by that child
+    BPlusNode root;
+    while (height > 1 && loadNode(rootNode, root) && root.children.size() == 1)
+    {
+        const uint32_t oldRoot = rootNode;
+        rootNode = root.children.front();
+        --height;
+        if (!freeNode(oldRoot))
+            return false;
+    }
+    return true;
+}
+
+bool BPlusTreeIndex::updateEntry(const uint32_t oldKey, const uint32_t newKey, const uint32_t rbn)
+{
+    std::vector<uint32_t> path;
+    std::vector<size_t> slots;
+    BPlusNode node;
+    if (!descend(oldKey, path, slots, true) || !loadNode(path.back(), node))
+        return false;
+
+    const size_t idx = slots.back();
+    if (node.keys[idx] != oldKey || node.children[idx] != rbn)
+    {
+        setError("No index entry for key " + std::to_string(oldKey) + " at RBN " + std::to_string(rbn));
+        return false;
+    }
+
+    // The sequence set keeps blocks ordered, so the key normally stays in place.
+    // If it would not, fall back to a remove and insert.
+    const bool inOrder = (idx == 0 || node.keys[idx - 1] < newKey) &&
+                         (idx + 1 == node.keys.size() || newKey < node.keys[idx + 1]);
+    if (!inOrder)
+        return removeEntry(oldKey, rbn) && insertEntry(newKey, rbn);
+
+    node.keys[idx] = newKey;
+    if (!storeNode(path.back(), node))
+        return false;
+    if (idx + 1 == node.keys.size())
+        return propagateHighKey(path, slots, path.size() - 1, newKey);
+    return true;
+}
+
+bool BPlusTreeIndex::applyChanges(const std::vector<IndexChange>& changes)
+{
+    for (const auto& change : changes)
+    {
+        bool ok;
+        if (change.oldHighKey == 0)
+            ok = insertEntry(change.newHighKey, change.rbn);
+        else if (change.newHighKey == 0)
+            ok = removeEntry(change.oldHighKey, change.rbn);
+        else
+            ok = updateEntry(change.oldHighKey, change.newHighKey, change.rbn);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+uint16_t BPlusTreeIndex::getHeight() const
+{
+    return height;
+}
+
+uint32_t BPlusTreeIndex::getEntryCount() const
+{
+    return entryCount;
+}
+
+uint64_t BPlusTreeIndex::getNodeReads() const
+{
+    return nodeCache.getMisses();
+}
+
+const std::string& BPlusTreeIndex::getLastError() const
+{
+    return lastError;
+}
+
+size_t BPlusTreeIndex::capacity() const
+{
+    return (nodeSize - 8) / (2 * sizeof(uint32_t));
+}
+
+uint64_t BPlusTreeIndex::nodeOffset(const uint32_t node) const
+{
+    return HEADER_SIZE + static_cast<uint64_t>(node - 1) * nodeSize;
+}
+
+bool BPlusTreeIndex::loadNode(const uint32_t node, BPlusNode& out)
+{
+    if (node == 0 || node > nodeCount)
+    {
+        setError("Index node " + std::to_string(node) + " out of range");
+        return false;
+    }
+
+    CacheFrame* frame = nodeCache.lookup(node);
+    if (!frame)
+    {
+        bool isNew = false;
+        frame = nodeCache.claim(node, nodeOffset(node), nodeSize, isNew);
+        if (!frame)
+        {
+            setError("No free buffer pool frame for index node");
+            return false;
+        }
+        treeFile.clear();
+        treeFile.seekg(static_cast<std::streamoff>(frame->fileOffset));
+        if (!treeFile.read(frame->bytes.data(), nodeSize))
+        {
+            treeFile.clear();
+            nodeCache.discard(node);
+            setError("Failed to read index node " + std::to_string(node));
+            return false;
+        }
+    }
+
+    const char* raw = frame->bytes.data();
+    uint16_t keyCount = 0;
+    out.isLeaf = raw[0] != 0;
+    memcpy(&keyCount, raw + 2, sizeof(uint16_t));
+    memcpy(&out.nextFree, raw + 4, sizeof(uint32_t));
+    if (keyCount > capacity())
+    {
+        setError("Corrupt index node " + std::to_string(node));
+        return false;
+    }
+
+    out.keys.resize(keyCount);
+    out.children.resize(keyCount);
+    size_t offset = 8;
+    for (uint16_t i = 0; i < keyCount; ++i)
+    {
+        memcpy(&out.keys[i], raw + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        memcpy(&out.children[i], raw + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+    }
+    return true;
+}
+
+bool BPlusTreeIndex::storeNode(const uint32_t node, const BPlusNode& in)
+{
+    if (in.keys.size() > capacity())
+    {
+        setError("Index node overflow");
+        return false;
+    }
+
+    bool isNew = false;
+    CacheFrame* frame = nodeCache.claim(node, nodeOffset(node), nodeSize, isNew);
+    if (!frame)
+    {
+        setError("No free buffer pool frame for index node");
+        return false;
+    }
+
+    char* raw = frame->bytes.data();
+    std::fill(raw, raw + nodeSize, '\0');
+    const uint16_t keyCount = static_cast<uint16_t>(in.keys.size());
+    raw[0] = in.isLeaf ? 1 : 0;
+    memcpy(raw + 2, &keyCount, sizeof(uint16_t));
+    memcpy(raw + 4, &in.nextFree, sizeof(uint32_t));
+    size_t offset = 8;
+    for (uint16_t i = 0; i < keyCount; ++i)
+    {
+        memcpy(raw + offset, &in.keys[i], sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        memcpy(raw + offset, &in.children[i], sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+    }
+    frame->dirty = true;
+    return true;
+}
+
+uint32_t BPlusTreeIndex::allocateNode()
+{
+    headerDirty = true;
+    if (freeNodeHead != 0)
+    {
+        BPlusNode freed;
+        const uint32_t node = freeNodeHead;
+        if (loadNode(node, freed))
+        {
+            freeNodeHead = freed.nextFree;
+            return node;
+        }
+        freeNodeHead = 0; // Free list is unreadable, stop using it
+    }
+    return ++nodeCount;
+}
+
+bool BPlusTreeIndex::freeNode(const uint32_t node)
+{
+    BPlusNode freed;
+    freed.isLeaf = false;
+    freed.nextFree = freeNodeHead;
+    freeNodeHead = node;
+    headerDirty = true;
+    return storeNode(node, freed);
+}
+
+bool BPlusTreeIndex::descend(const uint32_t key, std::vector<uint32_t>& path,
+                             std::vector<size_t>& slots, const bool exact)
+{
+    path.clear();
+    slots.clear();
+    uint32_t node = rootNode;
+    BPlusNode current;
+    while (node != 0)
+    {
+        if (!loadNode(node, current) || current.keys.empty())
+            return false;
+
+        size_t slot = std::lower_bound(current.keys.begin(), current.keys.end(), key) - current.keys.begin();
+        if (slot == current.keys.size())
+        {
+            if (exact)
+            {
+                setError("Index key " + std::to_string(key) + " not found");
+                return false;
+            }
+            slot = current.keys.size() - 1; // New highest key goes in the last child
+        }
+        path.push_back(node);
+        slots.push_back(slot);
+        if (current.isLeaf)
+            return true;
+        node = current.children[slot];
+    }
+    setError("Index is empty");
+    return false;
+}
+
+bool BPlusTreeIndex::propagateHighKey(const std::vector<uint32_t>& path, const std::vector<size_t>& slots,
+                                      size_t level, uint32_t newHighKey)
+{
+    // Walk up while the changed child is the last one, its key is the parent's highest key
+    BPlusNode parent;
+    while (level > 0)
+    {
+        if (!loadNode(path[level - 1], parent))
+            return false;
+        const size_t slot = slots[level - 1];
+        if (parent.keys[slot] == newHighKey)
+            return true;
+        parent.keys[slot] = newHighKey;
+        if (!storeNode(path[level - 1], parent))
+            return false;
+        if (slot + 1 != parent.keys.size())
+            return true;
+        --level;
+    }
+    return true;
+}
+
+bool BPlusTreeIndex::writeHeader()
+{
+    char raw[HEADER_SIZE];
+    std::fill(raw, raw + HEADER_SIZE, '\0');
+    const uint16_t version = VERSION;
+    memcpy(raw, "BPTI", 4);
+    memcpy(raw + 4, &version, sizeof(uint16_t));
+    memcpy(raw + 6, &height, sizeof(uint16_t));
+    memcpy(raw + 8, &nodeSize, sizeof(uint32_t));
+    memcpy(raw + 12, &rootNode, sizeof(uint32_t));
+    memcpy(raw + 16, &nodeCount, sizeof(uint32_t));
+    memcpy(raw + 20, &freeNodeHead, sizeof(uint32_t));
+    memcpy(raw + 24, &entryCount, sizeof(uint32_t));
+
+    treeFile.clear();
+    treeFile.seekp(0);
+    treeFile.write(raw, HEADER_SIZE);
+    if (!treeFile.good())
+    {
+        setError("Failed to write index header");
+        return false;
+    }
+    headerDirty = false;
+    return true;
+}
+
+bool BPlusTreeIndex::readHeader()
+{
+    char raw[HEADER_SIZE];
+    treeFile.seekg(0);
+    if (!treeFile.read(raw, HEADER_SIZE) || memcmp(raw, "BPTI", 4) != 0)
+    {
+        setError("Not a B+tree index file");
+        return false;
+    }
+
+    uint16_t version = 0;
+    memcpy(&version, raw + 4, sizeof(uint16_t));
+    if (version != VERSION)
+    {
+        setError("Unsupported B+tree index version " + std::to_string(version));
+        return false;
+    }
+    memcpy(&height, raw + 6, sizeof(uint16_t));
+    memcpy(&nodeSize, raw + 8, sizeof(uint32_t));
+    memcpy(&rootNode, raw + 12, sizeof(uint32_t));
+    memcpy(&nodeCount, raw + 16, sizeof(uint32_t));
+    memcpy(&freeNodeHead, raw + 20, sizeof(uint32_t));
+    memcpy(&entryCount, raw + 24, sizeof(uint32_t));
+    headerDirty = false;
+
+    if (nodeSize < 32)
+    {
+        setError("Corrupt B+tree index header");
+        return false;
+    }
+    return true;
+}
+
+bool BPlusTreeIndex::writeNodeToFile(const CacheFrame& frame)
+{
+    treeFile.clear();
+    treeFile.seekp(static_cast<std::streamoff>(frame.fileOffset));
+    treeFile.write(frame.bytes.data(), static_cast<std::streamsize>(frame.bytes.size()));
+    return treeFile.good();
+}
+
+void BPlusTreeIndex::setError(const std::string& message)
+{
+    lastError = message;
+}
@@ -0,0 +1,233 @@
+#ifndef BPLUS_TREE_INDEX_H
+#define BPLUS_TREE_INDEX_H
+
+#include "stdint.h"
+#include "Block.h"
+#include "BlockCache.h"
+#include "BlockIndexFile.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @file BPlusTreeIndex.h
+ * @author Group 2
+ * @brief BPlusTreeIndex class for the on-disk index set over the sequence set
+ * @version 0.1
+ * @date 2025-11-06
+ */
+
+/**
+ * @struct BPlusNode
+ * @brief Decoded index set node
+ * @details Entry i pairs the highest key below child i with that child. In a leaf
+ *          the child is a sequence set RBN, otherwise it is another node.
+ */
+struct BPlusNode
+{
+    bool isLeaf; // Children are sequence set blocks
+    uint32_t nextFree; // Next node on the free list (free nodes only)
+    std::vector<uint32_t> keys; // Highest key of each child, ascending
+    std::vector<uint32_t> children; // Child node numbers or sequence set RBNs
+};
+
+/**
+ * @class BPlusTreeIndex
+ * @brief B+tree index set stored in a companion file next to the blocked file
+ * @details The sequence set blocks are the bottom level of the B+tree; this class
+ *          stores the index set above them. Nodes are fixed size and numbered from
+ *          1 like RBNs, node n starts at HEADER_SIZE + (n - 1) * nodeSize.
+ *
+ *          File header (32 bytes):
+ *            magic "BPTI" | version (2) | height (2) | nodeSize (4) | rootNode (4)
+ *            nodeCount (4) | freeNodeHead (4) | entryCount (4) | reserved (4)
+ *          Node:
+ *            isLeaf (1) | reserved (1) | keyCount (2) | nextFree (4) | keyCount x (key (4), child (4))
+ *
+ *          Lookups read one node per level through a BlockCache. Splits propagate
+ *          up to the root. Removals drop empty nodes and collapse a single child
+ *          root but never merge underfull nodes, the sequence set already keeps
+ *          the data blocks balanced.
+ */
+class BPlusTreeIndex
+{
+public:
+    static const uint32_t HEADER_SIZE = 32;
+    static const uint16_t VERSION = 1;
+
+    /**
+     * @brief Default constructor
+     */
+    BPlusTreeIndex();
+
+    /**
+     * @brief Destructor
+     * @details Writes back dirty nodes and the header if a file is open
+     */
+    ~BPlusTreeIndex();
+
+    /**
+     * @brief Companion file name used for a blocked file
+     * @param zcbFilePath [IN] Path to the blocked sequence set file
+     * @return zcbFilePath with ".bpt" appended
+     */
+    static std::string pathFor(const std::string& zcbFilePath);
+
+    /**
+     * @brief Bulk load a new tree file from sorted index entries
+     * @details Nodes are filled to capacity bottom up, an existing file is replaced
+     * @param filename [IN] Path of the tree file to create
+     * @param nodeSize [IN] Bytes per node (at least 24)
+     * @param entries [IN] One entry per sequence set block, sorted by key
+     * @return True if the file was written and left open
+     */
+    bool create(const std::string& filename, const uint32_t nodeSize,
+                const std::vector<IndexEntry>& entries);
+
+    /**
+     * @brief Open an existing tree file
+     * @param filename [IN] Path of the tree file
+     * @return True if the header was valid
+     */
+    bool open(const std::string& filename);
+
+    /**
+     * @brief Write back dirty nodes and the header, then close the file
+     */
+    void close();
+
+    /**
+     * @brief Check if a tree file is open
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Write back dirty nodes and the header
+     * @return True if everything reached the file
+     */
+    bool flush();
+
+    /**
+     * @brief Find RBN for block containing the given zip code
+     * @param zipCode [IN] Zip code to search for
+     * @return RBN of block that should contain this zip (or -1 if it is above every key)
+     */
+    uint32_t findRBNForKey(const uint32_t zipCode);
+
+    /**
+     * @brief RBN of the sequence set block with the highest key
+     * @return Tail RBN or 0 if the tree is empty
+     */
+    uint32_t getTailRBN();
+
+    /**
+     * @brief Add the entry for a block that joined the sequence set
+     * @return True if the entry was inserted
+     */
+    bool insertEntry(const uint32_t key, const uint32_t rbn);
+
+    /**
+     * @brief Remove the entry for a block that left the sequence set
+     * @return True if the entry was found and removed
+     */
+    bool removeEntry(const uint32_t key, const uint32_t rbn);
+
+    /**
+     * @brief Change the highest key of a block
+     * @return True if the entry was found and updated
+     */
+    bool updateEntry(const uint32_t oldKey, const uint32_t newKey, const uint32_t rbn);
+
+    /**
+     * @brief Apply a BlockBuffer change log in order
+     * @param changes [IN] Highest key changes
+     * @return True if every change applied, false means the tree should be rebuilt
+     */
+    bool applyChanges(const std::vector<IndexChange>& changes);
+
+    /**
+     * @brief Number of levels in the index set (0 when empty)
+     */
+    uint16_t getHeight() const;
+
+    /**
+     * @brief Number of sequence set blocks indexed
+     */
+    uint32_t getEntryCount() const;
+
+    /**
+     * @brief Number of node reads that went to the file
+     */
+    uint64_t getNodeReads() const;
+
+    /**
+     * @brief Get description of last error
+     */
+    const std::string& getLastError() const;
+
+private:
+    std::fstream treeFile; // Companion file stream
+    BlockCache nodeCache; // Buffer pool for nodes
+    std::string lastError; // Last error message
+    uint32_t nodeSize; // Bytes per node
+    uint16_t height; // Levels in the index set
+    uint32_t rootNode; // Root node number, 0 if empty
+    uint32_t nodeCount; // Nodes allocated in the file
+    uint32_t freeNodeHead; // First node on the free list
+    uint32_t entryCount; // Sequence set blocks indexed
+    bool headerDirty; // Header fields changed since last written
+
+    /**
+     * @brief Largest number of entries a node can hold
+     */
+    size_t capacity() const;
+
+    /**
+     * @brief Byte offset of a node in the file
+     */
+    uint64_t nodeOffset(const uint32_t node) const;
+
+    /**
+     * @brief Read and decode a node
+     */
+    bool loadNode(const uint32_t node, BPlusNode& out);
+
+    /**
+     * @brief Encode a node into its buffer pool frame
+     */
+    bool storeNode(const uint32_t node, const BPlusNode& in);
+
+    /**
+     * @brief Take a node from the free list or the end of the file
+     */
+    uint32_t allocateNode();
+
+    /**
+     * @brief Put a node on the free list
+     */
+    bool freeNode(const uint32_t node);
+
+    /**
+     * @brief Descend from the root towards a key
+     * @param key [IN] Key to route
+     * @param path [OUT] Node numbers from root to leaf
+     * @param slots [OUT] Entry index taken in each node
+     * @param exact [IN] Fail instead of taking the last entry when key is above a node
+     * @return True if a leaf was reached
+     */
+    bool descend(const uint32_t key, std::vector<uint32_t>& path,
+                 std::vector<size_t>& slots, const bool exact);
+
+    /**
+     * @brief Fix the separator keys above a node whose highest key changed
+     */
+    bool propagateHighKey(const std::vector<uint32_t>& path, const std::vector<size_t>& slots,
+                          size_t level, uint32_t newHighKey);
+
+    bool writeHeader();
+    bool readHeader();
+    bool writeNodeToFile(const CacheFrame& frame);
+    void setError(const std::string& message);
+};
+
+#endif // BPLUS_TREE_INDEX_H
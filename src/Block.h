@@ -2,8 +2,48 @@
 #define BLOCK_H
 
 #include "stdint.h"
+#include <cstddef>
+#include <cstring>
 #include <vector>
 
+/**
+ * @struct SlottedPage
+ * @brief Layout of a slotted block's data region
+ * @details header | slotCount slots sorted by key | free space | record heap (grows down from the end)
+ *          Header: mark (4) | slotCount (2) | heapStart (2) | liveBytes (2)
+ *          Slot: key (4) | offset of the record in the data region (2) | record length (2)
+ *          Records are ZipCodeRecord::serialize() images. The mark can not start a text or
+ *          binary record (its length prefix would exceed any block), so blocks identify themselves.
+ */
+struct SlottedPage
+{
+    static const uint32_t MARK = 0xFFFF5107u; // First four bytes of a slotted data region
+    static const size_t HEADER_SIZE = 10; // Bytes before the first slot
+    static const size_t SLOT_SIZE = 8; // Bytes per slot
+
+    /**
+     * @brief Check if a data region holds a slotted page
+     */
+    static bool isSlotted(const char* data, const size_t size)
+    {
+        if (data == nullptr || size < HEADER_SIZE) return false;
+        uint32_t mark;
+        std::memcpy(&mark, data, sizeof(mark));
+        return mark == MARK;
+    }
+
+    /**
+     * @brief Bytes in use: header, slots and live records (holes left by removals excluded)
+     */
+    static size_t usedSize(const char* data)
+    {
+        uint16_t slotCount, liveBytes;
+        std::memcpy(&slotCount, data + 4, sizeof(slotCount));
+        std::memcpy(&liveBytes, data + 8, sizeof(liveBytes));
+        return HEADER_SIZE + slotCount * SLOT_SIZE + liveBytes;
+    }
+};
+
 struct ActiveBlock
 {
     uint16_t recordCount; // Records held by this block (techncially redundant could be fetched from records vector)
@@ -12,6 +52,10 @@ struct ActiveBlock
     std::vector<char> data; // Raw Block Data
     size_t getTotalSize() const 
     {
+    // Slotted pages keep their used size in the page header
+    if (SlottedPage::isSlotted(data.data(), data.size()))
+        return 10 + SlottedPage::usedSize(data.data());
+
     // Find first padding byte (0xFF)
     size_t actualDataSize = data.size();
         for(size_t i = data.size(); i > 0; --i) 
@@ -26,6 +70,22 @@ struct ActiveBlock
     }
 };
 
+struct ActiveBlockView
+{
+    uint16_t recordCount; // Records held by this block
+    uint32_t precedingRBN; // Pointer to prior active block
+    uint32_t succeedingRBN; // Pointer to succeeding active block
+    const char* data; // Raw Block Data, points into the file mapping or a buffer pool frame (not owned)
+    size_t dataSize; // Bytes available at data (block size minus metadata)
+};
+
+struct IndexChange
+{
+    uint32_t rbn; // Sequence set block whose highest key changed
+    uint32_t oldHighKey; // Highest key before the change, 0 if the block just joined the sequence set
+    uint32_t newHighKey; // Highest key after the change, 0 if the block left the sequence set
+};
+
 struct AvailBlock
 {
     uint16_t recordCount; // Records held by this block
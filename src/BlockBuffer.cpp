@@ -1,13 +1,14 @@
 #include "BlockBuffer.h"
 #include "RecordBuffer.h"
 #include "ZipCodeRecord.h"
+#include "ZipCodeRecordView.h"
 #include <cstring>
 #include "HeaderBuffer.h"
 #include <unordered_set>
 
 static inline void persistHeader(const std::string& dataPath, HeaderRecord& header) {
     HeaderBuffer hb;
-    hb.writeHeader(dataPath, header);
+    hb.updateHeader(dataPath, header);
 }
 static inline std::streampos rbn_offset(size_t headerSize, uint32_t rbn, uint32_t blockSize) {
     return static_cast<std::streampos>(headerSize)
@@ -17,28 +18,66 @@ static inline std::streampos rbn_offset(size_t headerSize, uint32_t rbn, uint32_
 // Simple constructor / destructor to initialize state
 BlockBuffer::BlockBuffer()
     : recordsProcessed(0), blocksProcessed(0), lastError(), errorState(false),
-      mergeOccurred(false), splitOccurred(false), recordBuffer()
+      mergeOccurred(false), splitOccurred(false), recordBuffer(), blockCache(),
+      blockWrites(0), mappedFile(), useMapping(false), indexChanges(), fileName(), prefetcher(),
+      freeSpace(), useFreeSpaceMap(false), wal(), useWriteAheadLog(false), blocksRecovered(0)
 {
+    blockCache.setWriteBack([this](const CacheFrame& frame) { return writeFrameToFile(frame); });
 }
 
 BlockBuffer::~BlockBuffer()
 {
-    if (blockFile.is_open()) blockFile.close();
+    if (blockFile.is_open() || useMapping) closeFile();
 }
 
 bool BlockBuffer::openFile(const std::string& filename, const size_t headerSize){
+    if (blockFile.is_open() || useMapping) closeFile();
+    blocksRecovered = 0;
     blockFile.open(filename, std::ios::binary | std::ios::in | std::ios::out);
     if (!blockFile) { //if file couldn't open set error
         setError("Error opening file!");
         return false;
     }
     errorState = false;
+    fileName = filename;
     blockFile.seekg(headerSize); //skip header
 
     return true;
 }
 
+bool BlockBuffer::openMappedFile(const std::string& filename, const size_t headerSize)
+{
+    if (blockFile.is_open() || useMapping) closeFile();
+    blocksRecovered = 0;
+    if (!mappedFile.open(filename))
+    {
+        setError(mappedFile.getLastError());
+        return false;
+    }
+    if (mappedFile.size() < headerSize)
+    {
+        mappedFile.close();
+        setError("File too small to contain its header");
+        return false;
+    }
+    useMapping = true;
+    errorState = false;
+    fileName = filename;
+    return true;
+}
+
+bool BlockBuffer::isMapped() const
+{
+    return useMapping;
+}
+
+void BlockBuffer::setRecordFormat(const uint8_t format)
+{
+    recordBuffer.setRecordFormat(format);
+}
+
 bool BlockBuffer::hasMoreData() const{
+    if (useMapping) return !errorState;
     return blockFile.is_open() && !blockFile.eof() && !errorState;
 }
 
@@ -49,39 +88,166 @@ bool BlockBuffer::hasError() const{
 bool BlockBuffer::readRecordAtRBN(const uint32_t rbn, const uint32_t zipCode, const uint32_t blockSize, const size_t headerSize, ZipCodeRecord& outRecord)
 {
     
-   ActiveBlock block = loadActiveBlockAtRBN(rbn, blockSize, headerSize); //load block at rbn
+   ActiveBlockView block = viewActiveBlockAtRBN(rbn, blockSize, headerSize); //view block at rbn
 
-   std::vector<ZipCodeRecord> records;
-   recordBuffer.unpackBlock(block.data, records); //unpack block data into records
+   // Slotted blocks binary search their slots and decode one record, others are unpacked and scanned
+   return recordBuffer.findRecord(block.data, block.dataSize, zipCode, outRecord);
+}
 
-   auto it = std::find_if(records.begin(), records.end(), 
-                          [zipCode](const ZipCodeRecord& rec) { return rec.getZipCode() == zipCode; });
+size_t BlockBuffer::readRecordsAtRBNs(const std::vector<uint32_t>& zipCodes, const std::vector<uint32_t>& rbns,
+                                      const uint32_t blockSize, const size_t headerSize,
+                                      std::vector<ZipCodeRecord>& outRecords, std::vector<bool>& found)
+{
+    const size_t count = zipCodes.size() < rbns.size() ? zipCodes.size() : rbns.size();
+    outRecords.assign(zipCodes.size(), ZipCodeRecord());
+    found.assign(zipCodes.size(), false);
+
+    // Request positions ordered by block, then key
+    std::vector<size_t> order;
+    order.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (rbns[i] != 0 && rbns[i] != static_cast<uint32_t>(-1)) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b)
+    {
+        return rbns[a] != rbns[b] ? rbns[a] < rbns[b] : zipCodes[a] < zipCodes[b];
+    });
 
-    if (it != records.end()) 
+    size_t foundCount = 0;
+    size_t first = 0;
+    while (first < order.size())
     {
-        outRecord = *it; // Record found
-        return true;
-    } 
-    return false;
+        const uint32_t rbn = rbns[order[first]];
+        size_t last = first + 1;
+        while (last < order.size() && rbns[order[last]] == rbn) ++last;
+
+        const ActiveBlockView block = viewActiveBlockAtRBN(rbn, blockSize, headerSize);
+        if (block.data == nullptr)
+        {
+            first = last;
+            continue;
+        }
+
+        if (last - first == 1 || SlottedPage::isSlotted(block.data, block.dataSize))
+        {
+            for (size_t k = first; k < last; ++k)
+            {
+                const size_t i = order[k];
+                if (recordBuffer.findRecord(block.data, block.dataSize, zipCodes[i], outRecords[i]))
+                {
+                    found[i] = true;
+                    ++foundCount;
+                }
+            }
+        }
+        else
+        {
+            // Records and keys are both ascending, one pass matches them up
+            BlockRecordIterator it(block.data, block.dataSize);
+            ZipCodeRecordView view;
+            size_t k = first;
+            while (k < last && it.next(view))
+            {
+                const uint32_t zip = view.getZipCode();
+                while (k < last && zipCodes[order[k]] < zip) ++k;
+                while (k < last && zipCodes[order[k]] == zip)
+                {
+                    outRecords[order[k]] = view.toRecord();
+                    found[order[k]] = true;
+                    ++foundCount;
+                    ++k;
+                }
+            }
+        }
+        first = last;
+    }
+    return foundCount;
+}
+
+size_t BlockBuffer::scanRange(const uint32_t startRBN, const uint32_t lo, const uint32_t hi,
+                              const uint32_t blockSize, const size_t headerSize,
+                              const size_t offset, const size_t limit,
+                              const std::function<bool(const ZipCodeRecordView&)>& visit)
+{
+    size_t skipped = 0;
+    size_t delivered = 0;
+    bool readingAhead = false;
+    std::unordered_set<uint32_t> seen;
+
+    uint32_t curr = lo <= hi ? startRBN : 0;
+    bool done = false;
+    while (!done && curr != 0 && curr != static_cast<uint32_t>(-1) && seen.insert(curr).second)
+    {
+        const ActiveBlockView block = viewActiveBlockAtRBN(curr, blockSize, headerSize);
+        if (block.data == nullptr || block.recordCount == 0) break;
+        const uint32_t next = block.succeedingRBN;
+
+        BlockRecordIterator it(block.data, block.dataSize);
+        ZipCodeRecordView view;
+        while (!done && it.next(view))
+        {
+            const uint32_t zip = view.getZipCode();
+            if (zip < lo) continue;
+            if (zip > hi) done = true;
+            else if (skipped < offset) ++skipped;
+            else
+            {
+                ++delivered;
+                done = !visit(view) || delivered == limit;
+            }
+        }
+
+        // Short ranges stay on the caller's thread, longer ones read the chain ahead
+        if (!done && !readingAhead && seen.size() == READAHEAD_AFTER_BLOCKS && next != 0 && !prefetcher.isOpen())
+            readingAhead = startReadahead(next, blockSize, headerSize);
+        curr = next;
+    }
+
+    if (readingAhead) stopReadahead();
+    return delivered;
 }
 
 bool BlockBuffer::removeRecordAtRBN(const uint32_t rbn, const uint16_t minBlockSize, uint32_t& availListRBN, const uint32_t zipCode, const uint32_t blockSize, const size_t headerSize)
 {
+    OperationScope operation(*this);
     ActiveBlock block = loadActiveBlockAtRBN(rbn, blockSize, headerSize); // Load block at rbn
 
     std::vector<ZipCodeRecord> records;
-    recordBuffer.unpackBlock(block.data, records); // Unpack block data into records
+    uint32_t highKey = 0;
+    if(SlottedPage::isSlotted(block.data.data(), block.data.size()))
+    {
+        // Only the slots after the key move, nothing is decoded unless the block needs rebalancing
+        const uint32_t oldHighKey = RecordBuffer::slottedHighKey(block.data);
+        if(!recordBuffer.removeSlottedRecord(block.data, zipCode))
+            return false; // Record not found
+
+        highKey = RecordBuffer::slottedHighKey(block.data);
+        recordIndexChange(rbn, oldHighKey, highKey);
+        block.recordCount = RecordBuffer::slottedCount(block.data);
+        if(block.getTotalSize() >= minBlockSize)
+            return writeActiveBlockAtRBN(rbn, blockSize, headerSize, block);
+
+        recordBuffer.unpackBlock(block.data, records);
+    }
+    else
+    {
+        recordBuffer.unpackBlock(block.data, records); // Unpack block data into records
+        const uint32_t oldHighKey = highKeyOf(records);
 
-    auto it = std::find_if(records.begin(), records.end(),
-                             [zipCode](const ZipCodeRecord& rec) { return rec.getZipCode() == zipCode; });
-    if(it == records.end())
-        return false; // Record not found
+        auto it = std::find_if(records.begin(), records.end(),
+                                 [zipCode](const ZipCodeRecord& rec) { return rec.getZipCode() == zipCode; });
+        if(it == records.end())
+            return false; // Record not found
 
-    records.erase(it); // Remove the record
+        records.erase(it); // Remove the record
+        highKey = highKeyOf(records);
+        recordIndexChange(rbn, oldHighKey, highKey);
 
-    // Repack to get accurate size
-    recordBuffer.packBlock(records, block.data, blockSize);
-    block.recordCount = static_cast<uint16_t>(records.size());
+        // Repack to get accurate size
+        recordBuffer.packBlock(records, block.data, blockSize);
+        block.recordCount = static_cast<uint16_t>(records.size());
+    }
 
     if(block.getTotalSize() < minBlockSize)
     {
@@ -91,17 +257,18 @@ bool BlockBuffer::removeRecordAtRBN(const uint32_t rbn, const uint16_t minBlockS
             ActiveBlock precedingBlock = loadActiveBlockAtRBN(block.precedingRBN, blockSize, headerSize);
             std::vector<ZipCodeRecord> precedingRecords;
             recordBuffer.unpackBlock(precedingBlock.data, precedingRecords);
+            const uint32_t precedingHighKey = highKeyOf(precedingRecords);
 
             // Check if we can merge all records into preceding block
-            size_t totalSize = 10; // metadata
+            size_t totalSize = 10 + recordBuffer.blockOverhead(); // metadata
             for(const auto& rec : precedingRecords) 
             {
-                totalSize += rec.getRecordSize() + 4;
+                totalSize += recordBuffer.packedSize(rec) + 4;
             }
             for(const auto& rec : records) 
             
             {
-                totalSize += rec.getRecordSize() + 4;
+                totalSize += recordBuffer.packedSize(rec) + 4;
             }
 
             if(totalSize <= blockSize) {
@@ -125,6 +292,10 @@ bool BlockBuffer::removeRecordAtRBN(const uint32_t rbn, const uint16_t minBlockS
                     writeActiveBlockAtRBN(block.succeedingRBN, blockSize, headerSize, succeedingBlock);
                 }
 
+                // Drop the freed block before its highest key moves to the preceding block
+                recordIndexChange(rbn, highKey, 0);
+                recordIndexChange(block.precedingRBN, precedingHighKey, highKeyOf(precedingRecords));
+
                 writeActiveBlockAtRBN(block.precedingRBN, blockSize, headerSize, precedingBlock);
                 freeBlock(rbn, availListRBN, blockSize, headerSize);
                 mergeOccurred = true;
@@ -142,19 +313,21 @@ bool BlockBuffer::removeRecordAtRBN(const uint32_t rbn, const uint16_t minBlockS
         // Try merging/borrowing with succeeding block
         if (block.succeedingRBN != 0)
         {
-            ActiveBlock succeedingBlock = loadActiveBlockAtRBN(block.succeedingRBN, blockSize, headerSize);
+            const uint32_t succeedingRBN = block.succeedingRBN;
+            ActiveBlock succeedingBlock = loadActiveBlockAtRBN(succeedingRBN, blockSize, headerSize);
             std::vector<ZipCodeRecord> succeedingRecords;
             recordBuffer.unpackBlock(succeedingBlock.data, succeedingRecords);
+            const uint32_t succeedingHighKey = highKeyOf(succeedingRecords);
 
             // Check if we can merge all records into current block
-            size_t totalSize = 10; // metadata
+            size_t totalSize = 10 + recordBuffer.blockOverhead(); // metadata
             for(const auto& rec : records) 
             {
-                totalSize += rec.getRecordSize() + 4;
+                totalSize += recordBuffer.packedSize(rec) + 4;
             }
             for(const auto& rec : succeedingRecords) 
             {
-                totalSize += rec.getRecordSize() + 4;
+                totalSize += recordBuffer.packedSize(rec) + 4;
             }
 
             if(totalSize <= blockSize) {
@@ -178,8 +351,12 @@ bool BlockBuffer::removeRecordAtRBN(const uint32_t rbn, const uint16_t minBlockS
                     writeActiveBlockAtRBN(succeedingBlock.succeedingRBN, blockSize, headerSize, nextBlock);
                 }
 
+                // Drop the freed block before its highest key moves to this block
+                recordIndexChange(succeedingRBN, succeedingHighKey, 0);
+                recordIndexChange(rbn, highKey, highKeyOf(records));
+
                 writeActiveBlockAtRBN(rbn, blockSize, headerSize, block);
-                freeBlock(block.succeedingRBN, availListRBN, blockSize, headerSize);
+                freeBlock(succeedingRBN, availListRBN, blockSize, headerSize);
                 mergeOccurred = true;
                 return true;
             }
@@ -204,50 +381,64 @@ bool BlockBuffer::removeRecordAtRBN(const uint32_t rbn, const uint16_t minBlockS
 bool BlockBuffer::addRecord(const uint32_t rbn, const uint32_t blockSize, uint32_t& availListRBN, 
                             const ZipCodeRecord& record, const size_t headerSize, uint32_t& blockCount)
 {
+    OperationScope operation(*this);
     ActiveBlock block = loadActiveBlockAtRBN(rbn, blockSize, headerSize); //load block at rbn
 
+    // A slotted block with room takes the record by moving only the slots above its key
+    if(SlottedPage::isSlotted(block.data.data(), block.data.size()))
+    {
+        const uint32_t slottedOldHighKey = RecordBuffer::slottedHighKey(block.data);
+        if(recordBuffer.insertSlottedRecord(block.data, record))
+        {
+            block.recordCount = RecordBuffer::slottedCount(block.data);
+            recordIndexChange(rbn, slottedOldHighKey, RecordBuffer::slottedHighKey(block.data));
+            return writeActiveBlockAtRBN(rbn, blockSize, headerSize, block);
+        }
+    }
+
     std::vector<ZipCodeRecord> records;
     recordBuffer.unpackBlock(block.data, records); //unpack block data into records
+    const uint32_t oldHighKey = highKeyOf(records);
+    const size_t oldTotalSize = block.getTotalSize();
+
+    // Work on the block's records with the new one in key order
+    records.push_back(record);
+    std::sort(records.begin(), records.end(), 
+        [](const ZipCodeRecord& a, const ZipCodeRecord& b) 
+        {
+            return a.getZipCode() < b.getZipCode();
+        });
     
-    if(block.getTotalSize() + record.getRecordSize() <= blockSize) 
+    if(oldTotalSize + recordBuffer.packedSize(record) <= blockSize) 
     {
-        records.push_back(record); // Add the new record
-
-        std::sort(records.begin(), records.end(), 
-            [](const ZipCodeRecord& a, const ZipCodeRecord& b) 
-            {
-                return a.getZipCode() < b.getZipCode();
-            });
-
         recordBuffer.packBlock(records, block.data, blockSize); // Repack the block data
         block.recordCount = static_cast<uint16_t>(records.size()); // Update record count
+        recordIndexChange(rbn, oldHighKey, highKeyOf(records));
         return writeActiveBlockAtRBN(rbn, blockSize, headerSize, block); // Write back to file
     } 
     
     
     if(block.precedingRBN != 0)
     {
+        // The smallest key (possibly the new record) moves to the end of the preceding block
         ActiveBlock preceedingBlock = loadActiveBlockAtRBN(block.precedingRBN, blockSize, headerSize);
-        if((preceedingBlock.getTotalSize() + records[0].getRecordSize() + 4 <= blockSize) &&
-            (block.getTotalSize() + record.getRecordSize() - records[0].getRecordSize() <= blockSize))
+        if((preceedingBlock.getTotalSize() + recordBuffer.packedSize(records[0]) + 4 <= blockSize) &&
+            (oldTotalSize + recordBuffer.packedSize(record) - recordBuffer.packedSize(records[0]) <= blockSize))
         {
             std::vector<ZipCodeRecord> preceedingRecords;
             recordBuffer.unpackBlock(preceedingBlock.data, preceedingRecords);
-            ZipCodeRecord temp = records[0];
-            preceedingRecords.push_back(temp);
+            const uint32_t preceedingHighKey = highKeyOf(preceedingRecords);
+            preceedingRecords.push_back(records[0]);
             records.erase(records.begin());
-            records.push_back(record);
-            std::sort(records.begin(), records.end(), 
-                [](const ZipCodeRecord& a, const ZipCodeRecord& b) 
-                {
-                    return a.getZipCode() < b.getZipCode();
-                });
             recordBuffer.packBlock(records, block.data, blockSize);
             recordBuffer.packBlock(preceedingRecords, preceedingBlock.data, blockSize);
 
             // Original block does not need record change since one was removed and one was added
             preceedingBlock.recordCount = static_cast<uint16_t>(preceedingRecords.size()); // Update record count
 
+            recordIndexChange(block.precedingRBN, preceedingHighKey, highKeyOf(preceedingRecords));
+            recordIndexChange(rbn, oldHighKey, highKeyOf(records));
+
             return (writeActiveBlockAtRBN(rbn, blockSize, headerSize, block) && 
             writeActiveBlockAtRBN(block.precedingRBN, blockSize, headerSize, preceedingBlock));
         }
@@ -255,41 +446,32 @@ bool BlockBuffer::addRecord(const uint32_t rbn, const uint32_t blockSize, uint32
 
     if(block.succeedingRBN != 0)
     {
+        // The largest key (possibly the new record) moves to the front of the succeeding block
         ActiveBlock succeedingBlock = loadActiveBlockAtRBN(block.succeedingRBN, blockSize, headerSize);
-        if((succeedingBlock.getTotalSize() + records[records.size() - 1].getRecordSize() + 4 <= blockSize) &&
-            (block.getTotalSize() + record.getRecordSize() - records.back().getRecordSize() <= blockSize))
+        if((succeedingBlock.getTotalSize() + recordBuffer.packedSize(records.back()) + 4 <= blockSize) &&
+            (oldTotalSize + recordBuffer.packedSize(record) - recordBuffer.packedSize(records.back()) <= blockSize))
         {
             std::vector<ZipCodeRecord> succeedingRecords;
             recordBuffer.unpackBlock(succeedingBlock.data, succeedingRecords);
-            ZipCodeRecord temp = records.back();
-            succeedingRecords.insert(succeedingRecords.begin(), temp);
+            const uint32_t succeedingHighKey = highKeyOf(succeedingRecords);
+            succeedingRecords.insert(succeedingRecords.begin(), records.back());
             records.pop_back();
-            records.push_back(record);
-            std::sort(records.begin(), records.end(), 
-                [](const ZipCodeRecord& a, const ZipCodeRecord& b) 
-                {
-                    return a.getZipCode() < b.getZipCode();
-                });
             recordBuffer.packBlock(records, block.data, blockSize);
             recordBuffer.packBlock(succeedingRecords, succeedingBlock.data, blockSize);
 
             // Original block does not need record change since one was removed and one was added
             succeedingBlock.recordCount = static_cast<uint16_t>(succeedingRecords.size()); // Update record count
 
+            recordIndexChange(rbn, oldHighKey, highKeyOf(records));
+            recordIndexChange(block.succeedingRBN, succeedingHighKey, highKeyOf(succeedingRecords));
+
             return (writeActiveBlockAtRBN(rbn, blockSize, headerSize, block) && 
             writeActiveBlockAtRBN(block.succeedingRBN, blockSize, headerSize, succeedingBlock));
         }
     }
     
     // Gotta split now no other choice
-    uint32_t newRBN = allocateBlock(availListRBN, blockCount, blockSize, headerSize);
-
-    records.push_back(record);
-    std::sort(records.begin(), records.end(), 
-             [](const ZipCodeRecord& a, const ZipCodeRecord& b) 
-             {
-                return a.getZipCode() < b.getZipCode();
-            });
+    uint32_t newRBN = allocateBlock(availListRBN, blockCount, blockSize, headerSize, rbn);
         
     uint32_t remainder = records.size() / 2; // Truncate for shitty rounding
 
@@ -315,78 +497,378 @@ bool BlockBuffer::addRecord(const uint32_t rbn, const uint32_t blockSize, uint32
         nextBlock.precedingRBN = newRBN;
         writeActiveBlockAtRBN(splitBlock.succeedingRBN, blockSize, headerSize, nextBlock);
     }
+
+    recordIndexChange(rbn, oldHighKey, highKeyOf(records));
+    recordIndexChange(newRBN, 0, highKeyOf(splitRecords));
         
     splitOccurred = true;
     return (writeActiveBlockAtRBN(rbn, blockSize, headerSize, block) && 
             writeActiveBlockAtRBN(newRBN, blockSize, headerSize, splitBlock));
 }
 
-bool BlockBuffer::getMergeOccurred() const{
-    return mergeOccurred;
+bool BlockBuffer::addSortedRecords(const uint32_t rbn, const uint32_t blockSize, uint32_t& availListRBN,
+                                   const std::vector<ZipCodeRecord>& records, const size_t headerSize,
+                                   uint32_t& blockCount, const double fillFactor, BatchStats& stats)
+{
+    OperationScope operation(*this);
+    ActiveBlock block = loadActiveBlockAtRBN(rbn, blockSize, headerSize);
+    ++stats.blocksRead;
+
+    std::vector<ZipCodeRecord> existing;
+    recordBuffer.unpackBlock(block.data, existing);
+    const uint32_t oldHighKey = highKeyOf(existing);
+
+    // Merge the two sorted runs, keys already in the block (or earlier in the run) are skipped
+    std::vector<ZipCodeRecord> merged;
+    merged.reserve(existing.size() + records.size());
+    size_t next = 0, added = 0, duplicates = 0;
+    for (const auto& rec : records)
+    {
+        while (next < existing.size() && existing[next].getZipCode() < rec.getZipCode())
+            merged.push_back(existing[next++]);
+
+        if ((next < existing.size() && existing[next].getZipCode() == rec.getZipCode()) ||
+            (!merged.empty() && merged.back().getZipCode() == rec.getZipCode()))
+        {
+            ++duplicates;
+            continue;
+        }
+        merged.push_back(rec);
+        ++added;
+    }
+    merged.insert(merged.end(), existing.begin() + next, existing.end());
+
+    std::vector<std::vector<ZipCodeRecord>> groups;
+    if (packedSizeOf(merged) <= blockSize)
+        groups.push_back(merged);
+    else
+        groups = partitionRecords(merged, blockSize, fillFactor);
+
+    // Pack every group before anything is allocated or written, a group that does not fit leaves the chain as it was
+    std::vector<ActiveBlock> outs(groups.size());
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        if (!recordBuffer.packBlock(groups[g], outs[g].data, blockSize))
+        {
+            setError("Batch group does not fit in a block: " + recordBuffer.getLastError());
+            return false;
+        }
+        outs[g].recordCount = static_cast<uint16_t>(groups[g].size());
+    }
+    stats.recordsAdded += added;
+    stats.duplicatesSkipped += duplicates;
+
+    // Allocate the new blocks next so every link is known before anything is written
+    std::vector<uint32_t> rbns(1, rbn);
+    for (size_t g = 1; g < groups.size(); ++g)
+    {
+        rbns.push_back(allocateBlock(availListRBN, blockCount, blockSize, headerSize, rbns.back()));
+        ++stats.blocksAllocated;
+    }
+
+    const uint32_t succeedingRBN = block.succeedingRBN;
+    bool ok = true;
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        outs[g].precedingRBN = (g == 0) ? block.precedingRBN : rbns[g - 1];
+        outs[g].succeedingRBN = (g + 1 < groups.size()) ? rbns[g + 1] : succeedingRBN;
+        ok = writeActiveBlockAtRBN(rbns[g], blockSize, headerSize, outs[g]) && ok;
+        ++stats.blocksWritten;
+    }
+
+    // The block after the run now follows the last new block
+    if (groups.size() > 1 && succeedingRBN != 0)
+    {
+        ActiveBlock nextBlock = loadActiveBlockAtRBN(succeedingRBN, blockSize, headerSize);
+        ++stats.blocksRead;
+        nextBlock.precedingRBN = rbns.back();
+        ok = writeActiveBlockAtRBN(succeedingRBN, blockSize, headerSize, nextBlock) && ok;
+        ++stats.blocksWritten;
+    }
+
+    recordIndexChange(rbn, oldHighKey, highKeyOf(groups[0]));
+    for (size_t g = 1; g < groups.size(); ++g)
+    {
+        recordIndexChange(rbns[g], 0, highKeyOf(groups[g]));
+    }
+
+    if (groups.size() > 1) splitOccurred = true;
+    return ok;
 }
 
-bool BlockBuffer::writeActiveBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize, const ActiveBlock& block)
+std::vector<std::vector<ZipCodeRecord>> BlockBuffer::partitionRecords(const std::vector<ZipCodeRecord>& records,
+                                                                      const uint32_t blockSize,
+                                                                      const double fillFactor) const
 {
-    if(!blockFile.is_open())
+    const size_t usable = blockSize - 10 - recordBuffer.blockOverhead(); // Block minus metadata
+    const double fill = (fillFactor > 0.0 && fillFactor <= 1.0) ? fillFactor : 1.0;
+    const size_t perBlock = std::max<size_t>(1, static_cast<size_t>(usable * fill));
+
+    size_t totalSize = 0;
+    for (const auto& rec : records)
     {
-        setError("File not open");
-        return false;
+        totalSize += recordBuffer.packedSize(rec);
     }
 
-    blockFile.clear();
-    blockFile.seekp(rbn_offset(headerSize, rbn, blockSize));                  // position the PUT pointer for writing
+    // Fewest blocks at the fill factor, then spread the bytes evenly across them
+    const size_t groupCount = std::max<size_t>(1, (totalSize + perBlock - 1) / perBlock);
+    const size_t target = (totalSize + groupCount - 1) / groupCount;
 
-    if(!blockFile.good())
+    std::vector<std::vector<ZipCodeRecord>> groups(1);
+    size_t currentSize = 0;
+    for (const auto& rec : records)
     {
-        setError("Failed to seek to RBN");
-        return false;
+        const size_t recSize = recordBuffer.packedSize(rec);
+        if (!groups.back().empty() && (currentSize >= target || currentSize + recSize > usable))
+        {
+            groups.emplace_back();
+            currentSize = 0;
+        }
+        groups.back().push_back(rec);
+        currentSize += recSize;
     }
+    return groups;
+}
 
-    blockFile.write(reinterpret_cast<const char*>(&block.recordCount), sizeof(uint16_t));
-    blockFile.write(reinterpret_cast<const char*>(&block.precedingRBN), sizeof(uint32_t));
-    blockFile.write(reinterpret_cast<const char*>(&block.succeedingRBN), sizeof(uint32_t));
+bool BlockBuffer::removeSortedKeys(const std::vector<BlockKeyGroup>& groups, const uint16_t minBlockSize,
+                                   uint32_t& availListRBN, const uint32_t blockSize, const size_t headerSize,
+                                   BatchStats& stats)
+{
+    OperationScope operation(*this);
+    bool ok = true;
+    size_t g = 0;
+    while (g < groups.size())
+    {
+        // Collect a run of groups whose blocks follow each other in the chain and remove their keys
+        std::vector<uint32_t> rbns;
+        std::vector<uint32_t> oldHighKeys;
+        std::vector<std::vector<ZipCodeRecord>> blockRecords;
+        std::vector<bool> changed;
+        uint32_t precedingRBN = 0;
+        uint32_t succeedingRBN = 0;
+        bool underfull = false;
+        do
+        {
+            const BlockKeyGroup& group = groups[g++];
+            ActiveBlock block = loadActiveBlockAtRBN(group.rbn, blockSize, headerSize);
+            ++stats.blocksRead;
+            if (rbns.empty()) precedingRBN = block.precedingRBN;
+            succeedingRBN = block.succeedingRBN;
+
+            std::vector<ZipCodeRecord> records;
+            recordBuffer.unpackBlock(block.data, records);
+            const size_t before = records.size();
+            const uint32_t oldHighKey = highKeyOf(records);
+            records.erase(std::remove_if(records.begin(), records.end(),
+                [&group](const ZipCodeRecord& rec)
+                {
+                    return std::binary_search(group.zipCodes.begin(), group.zipCodes.end(), rec.getZipCode());
+                }), records.end());
+
+            const size_t removed = before - records.size();
+            stats.recordsRemoved += static_cast<uint32_t>(removed);
+            stats.keysMissing += static_cast<uint32_t>(group.zipCodes.size() - removed);
+            if (packedSizeOf(records) < minBlockSize) underfull = true;
+
+            rbns.push_back(group.rbn);
+            oldHighKeys.push_back(oldHighKey);
+            blockRecords.push_back(std::move(records));
+            changed.push_back(removed > 0);
+        } while (g < groups.size() && succeedingRBN == groups[g].rbn);
+
+        std::vector<std::vector<ZipCodeRecord>> parts;
+        if (underfull)
+        {
+            std::vector<ZipCodeRecord> all;
+            for (const auto& records : blockRecords)
+                all.insert(all.end(), records.begin(), records.end());
+
+            // Borrow from a neighbour only if the run alone cannot keep its blocks at minimum size
+            const size_t overhead = 10 + recordBuffer.blockOverhead();
+            const size_t usable = blockSize - overhead;
+            const size_t dataSize = packedSizeOf(all) - overhead;
+            const size_t blocksNeeded = std::max<size_t>(1, (dataSize + usable - 1) / usable);
+            const uint32_t neighbourRBN = (precedingRBN != 0) ? precedingRBN : succeedingRBN;
+            if (overhead + dataSize / blocksNeeded < minBlockSize && neighbourRBN != 0)
+            {
+                ActiveBlock neighbour = loadActiveBlockAtRBN(neighbourRBN, blockSize, headerSize);
+                ++stats.blocksRead;
+                std::vector<ZipCodeRecord> neighbourRecords;
+                recordBuffer.unpackBlock(neighbour.data, neighbourRecords);
+                const uint32_t neighbourHighKey = highKeyOf(neighbourRecords);
 
-    blockFile.write(block.data.data(), block.data.size());
+                if (neighbourRBN == precedingRBN)
+                {
+                    precedingRBN = neighbour.precedingRBN;
+                    all.insert(all.begin(), neighbourRecords.begin(), neighbourRecords.end());
+                    rbns.insert(rbns.begin(), neighbourRBN);
+                    oldHighKeys.insert(oldHighKeys.begin(), neighbourHighKey);
+                    blockRecords.insert(blockRecords.begin(), std::move(neighbourRecords));
+                    changed.insert(changed.begin(), true);
+                }
+                else
+                {
+                    succeedingRBN = neighbour.succeedingRBN;
+                    all.insert(all.end(), neighbourRecords.begin(), neighbourRecords.end());
+                    rbns.push_back(neighbourRBN);
+                    oldHighKeys.push_back(neighbourHighKey);
+                    blockRecords.push_back(std::move(neighbourRecords));
+                    changed.push_back(true);
+                }
+            }
+
+            parts = partitionRecords(all, blockSize, 1.0);
+        }
+
+        if (parts.empty() || parts.size() > rbns.size())
+        {
+            // Nothing underfull (or no better layout), write back only the blocks that lost records
+            for (size_t i = 0; i < rbns.size(); ++i)
+            {
+                if (!changed[i]) continue;
+                ActiveBlock out;
+                out.precedingRBN = (i == 0) ? precedingRBN : rbns[i - 1];
+                out.succeedingRBN = (i + 1 < rbns.size()) ? rbns[i + 1] : succeedingRBN;
+                out.recordCount = static_cast<uint16_t>(blockRecords[i].size());
+                recordBuffer.packBlock(blockRecords[i], out.data, blockSize);
+                ok = writeActiveBlockAtRBN(rbns[i], blockSize, headerSize, out) && ok;
+                ++stats.blocksWritten;
+                recordIndexChange(rbns[i], oldHighKeys[i], highKeyOf(blockRecords[i]));
+            }
+            continue;
+        }
+
+        // Rewrite the run over its first parts.size() RBNs and free the rest
+        for (size_t i = 0; i < parts.size(); ++i)
+        {
+            ActiveBlock out;
+            out.precedingRBN = (i == 0) ? precedingRBN : rbns[i - 1];
+            out.succeedingRBN = (i + 1 < parts.size()) ? rbns[i + 1] : succeedingRBN;
+            out.recordCount = static_cast<uint16_t>(parts[i].size());
+            recordBuffer.packBlock(parts[i], out.data, blockSize);
+            ok = writeActiveBlockAtRBN(rbns[i], blockSize, headerSize, out) && ok;
+            ++stats.blocksWritten;
+        }
+        for (size_t i = parts.size(); i < rbns.size(); ++i)
+        {
+            freeBlock(rbns[i], availListRBN, blockSize, headerSize);
+            ++stats.blocksFreed;
+            mergeOccurred = true;
+        }
+        if (parts.size() < rbns.size() && succeedingRBN != 0)
+        {
+            ActiveBlock nextBlock = loadActiveBlockAtRBN(succeedingRBN, blockSize, headerSize);
+            ++stats.blocksRead;
+            nextBlock.precedingRBN = rbns[parts.size() - 1];
+            ok = writeActiveBlockAtRBN(succeedingRBN, blockSize, headerSize, nextBlock) && ok;
+            ++stats.blocksWritten;
+        }
 
-    size_t bytesWritten = block.getTotalSize();
-    if(bytesWritten < blockSize)
+        // Records moved between blocks, so highest keys can cross; drop every entry before adding the new ones
+        for (size_t i = 0; i < rbns.size(); ++i)
+        {
+            recordIndexChange(rbns[i], oldHighKeys[i], 0);
+        }
+        for (size_t i = 0; i < parts.size(); ++i)
+        {
+            recordIndexChange(rbns[i], 0, highKeyOf(parts[i]));
+        }
+    }
+    return ok;
+}
+
+size_t BlockBuffer::packedSizeOf(const std::vector<ZipCodeRecord>& records) const
+{
+    size_t totalSize = 10 + recordBuffer.blockOverhead(); // metadata
+    for (const auto& rec : records)
     {
-        std::vector<char> padding(blockSize - bytesWritten, '\xFF');
-        blockFile.write(padding.data(), padding.size());
+        totalSize += recordBuffer.packedSize(rec);
     }
-    blockFile.flush();
-    return blockFile.good();
+    return totalSize;
 }
 
-bool BlockBuffer::writeAvailBlockAtRBN(const uint32_t rbn, const uint32_t blockSize,
-                                       const size_t headerSize, const AvailBlock& block)
+bool BlockBuffer::getMergeOccurred() const{
+    return mergeOccurred;
+}
+
+const std::vector<IndexChange>& BlockBuffer::getIndexChanges() const
+{
+    return indexChanges;
+}
+
+void BlockBuffer::clearIndexChanges()
+{
+    indexChanges.clear();
+}
+
+void BlockBuffer::recordIndexChange(const uint32_t rbn, const uint32_t oldHighKey, const uint32_t newHighKey)
+{
+    if (oldHighKey == newHighKey)
+        return;
+    indexChanges.push_back({rbn, oldHighKey, newHighKey});
+}
+
+uint32_t BlockBuffer::highKeyOf(const std::vector<ZipCodeRecord>& records)
 {
-    if(!blockFile.is_open())
+    return records.empty() ? 0 : records.back().getZipCode();
+}
+
+bool BlockBuffer::writeActiveBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize, const ActiveBlock& block)
+{
+    const size_t metaSize = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t);
+    if(metaSize + block.data.size() > blockSize)
     {
-        setError("File not open");
+        setError("Block data exceeds block size");
         return false;
     }
 
-    blockFile.clear();
-    blockFile.seekp(rbn_offset(headerSize, rbn, blockSize));
+    // Build the full block image in place, it reaches the file on eviction or flush
+    char* image = writableBlockBytes(rbn, blockSize, headerSize);
+    if(!image)
+    {
+        return false;
+    }
+    return buildActiveBlockImage(block, blockSize, image);
+}
 
-    if(!blockFile.good())
+bool BlockBuffer::buildActiveBlockImage(const ActiveBlock& block, const uint32_t blockSize, char* image)
+{
+    const size_t metaSize = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t);
+    if(metaSize + block.data.size() > blockSize)
     {
-        setError("Failed to seek to RBN");
         return false;
     }
 
-    // Write AvailBlock structure: recordCount(2) + succeedingRBN(4) + padding
-    blockFile.write(reinterpret_cast<const char*>(&block.recordCount), sizeof(uint16_t));
-    blockFile.write(reinterpret_cast<const char*>(&block.succeedingRBN), sizeof(uint32_t));
+    size_t offsetIdx = 0;
+    memcpy(image + offsetIdx, &block.recordCount, sizeof(uint16_t));
+    offsetIdx += sizeof(uint16_t);
+    memcpy(image + offsetIdx, &block.precedingRBN, sizeof(uint32_t));
+    offsetIdx += sizeof(uint32_t);
+    memcpy(image + offsetIdx, &block.succeedingRBN, sizeof(uint32_t));
+    offsetIdx += sizeof(uint32_t);
+
+    if(!block.data.empty())
+        memcpy(image + offsetIdx, block.data.data(), block.data.size());
+    offsetIdx += block.data.size();
+
+    std::fill(image + offsetIdx, image + blockSize, '\xFF'); // padding
+    return true;
+}
 
-    // Write padding to fill the rest of the block
-    size_t paddingSize = blockSize - sizeof(uint16_t) - sizeof(uint32_t);
-    std::vector<char> padding(paddingSize, ' ');
-    blockFile.write(padding.data(), paddingSize);
+bool BlockBuffer::writeAvailBlockAtRBN(const uint32_t rbn, const uint32_t blockSize,
+                                       const size_t headerSize, const AvailBlock& block)
+{
+    char* image = writableBlockBytes(rbn, blockSize, headerSize);
+    if(!image)
+    {
+        return false;
+    }
 
-    blockFile.flush();
-    return blockFile.good();
+    // AvailBlock structure: recordCount(2) + succeedingRBN(4) + padding
+    memcpy(image, &block.recordCount, sizeof(uint16_t));
+    memcpy(image + sizeof(uint16_t), &block.succeedingRBN, sizeof(uint32_t));
+    std::fill(image + sizeof(uint16_t) + sizeof(uint32_t), image + blockSize, ' ');
+    return true;
 }
 
 void BlockBuffer::freeBlock(const uint32_t rbn, uint32_t& availListRBN,
@@ -395,27 +877,362 @@ void BlockBuffer::freeBlock(const uint32_t rbn, uint32_t& availListRBN,
     // Create an AvailBlock that points to the current avail list head
     AvailBlock availBlock;
     availBlock.recordCount = 0;  // No records in a freed block
-    availBlock.succeedingRBN = availListRBN;  // Point to current head
+    availBlock.succeedingRBN = useFreeSpaceMap ? 0 : availListRBN;  // Point to current head
 
     // Write the AvailBlock to disk
     writeAvailBlockAtRBN(rbn, blockSize, headerSize, availBlock);
 
+    if (useFreeSpaceMap)
+    {
+        freeSpace.release(rbn);
+        return;
+    }
+
     // Update the avail list head to point to this newly freed block
     availListRBN = rbn;
 }
 
+bool BlockBuffer::openFreeSpaceMap(uint32_t& availListRBN, uint32_t& blockCount,
+                                   const uint32_t blockSize, const size_t headerSize)
+{
+    if (fileName.empty() || blockSize == 0)
+    {
+        setError("File not open");
+        return false;
+    }
+
+    // Blocks actually in the file, the header count can lag behind
+    size_t fileSize = 0;
+    if (useMapping)
+    {
+        fileSize = mappedFile.size();
+    }
+    else
+    {
+        blockFile.clear();
+        blockFile.seekg(0, std::ios::end);
+        fileSize = static_cast<size_t>(blockFile.tellg());
+    }
+    const uint32_t fileBlocks = fileSize > headerSize ? static_cast<uint32_t>((fileSize - headerSize) / blockSize) : 0;
+    if (fileBlocks > blockCount) blockCount = fileBlocks;
+
+    const std::string mapFile = FreeSpaceMap::pathFor(fileName);
+    // A writer that still used the avail list leaves a non zero head behind
+    if (availListRBN != 0 || !freeSpace.load(mapFile) || freeSpace.getBlockCount() > blockCount)
+    {
+        // Rebuild from the blocks themselves, free blocks have no records
+        freeSpace.reset(blockCount);
+        for (uint32_t rbn = 1; rbn <= blockCount; ++rbn)
+        {
+            const char* raw = blockBytes(rbn, blockSize, headerSize);
+            if (raw == nullptr)
+            {
+                return false;
+            }
+            uint16_t recordCount;
+            memcpy(&recordCount, raw, sizeof(recordCount));
+            if (recordCount == 0) freeSpace.release(rbn);
+        }
+        if (!freeSpace.save(mapFile))
+        {
+            setError(freeSpace.getLastError());
+            return false;
+        }
+    }
+    freeSpace.grow(blockCount);
+    if (!freeSpace.markDirty(mapFile))
+    {
+        setError(freeSpace.getLastError());
+        return false;
+    }
+
+    availListRBN = 0;
+    useFreeSpaceMap = true;
+    return true;
+}
+
+bool BlockBuffer::closeFreeSpaceMap(uint32_t& blockCount)
+{
+    if (!useFreeSpaceMap) return false;
+    useFreeSpaceMap = false;
+
+    freeSpace.grow(blockCount);
+    blockCount = freeSpace.shrinkToFit();
+    if (!freeSpace.save(FreeSpaceMap::pathFor(fileName)))
+    {
+        setError(freeSpace.getLastError());
+        return false;
+    }
+    return true;
+}
+
+const FreeSpaceMap& BlockBuffer::getFreeSpaceMap() const
+{
+    return freeSpace;
+}
+
 const std::string& BlockBuffer::getLastError() const{
     return lastError;
 }
 
 size_t BlockBuffer::getMemoryOffset(){
+    if (useMapping) return 0;
     return blockFile.tellg();
 }
 
 void BlockBuffer::closeFile(){
+    stopReadahead();
+    if (useWriteAheadLog && !closeWriteAheadLog())
+        setError("Failed to checkpoint the write-ahead log: " + wal.getLastError());
+    if (useMapping)
+    {
+        mappedFile.close();
+        useMapping = false;
+        return;
+    }
+    if (blockFile.is_open() && !flush())
+        setError("Failed to write back buffered blocks");
+    blockCache.clear();
     blockFile.close(); // close the file
 }
 
+bool BlockBuffer::flush()
+{
+    if (useMapping)
+        return true; // Shared mapping, the page cache already holds every write
+    if (!blockFile.is_open())
+        return false;
+
+    bool ok = blockCache.flush();
+    if (useWriteAheadLog)
+        return ok && wal.commit(); // Durable in the log, checkpoints bring it to the file
+    blockFile.flush();
+    return ok && blockFile.good();
+}
+
+bool BlockBuffer::openWriteAheadLog(const uint32_t blockSize, const size_t headerSize, const size_t groupSize)
+{
+    if (useWriteAheadLog) return true;
+    if (useMapping || !blockFile.is_open())
+    {
+        setError("Write-ahead log needs a file opened with openFile");
+        return false;
+    }
+
+    // open() replays a log left by a crash behind the stream, drop anything buffered
+    flush();
+    blockCache.clear();
+    if (!wal.open(fileName, blockSize, headerSize, groupSize))
+    {
+        setError(wal.getLastError());
+        return false;
+    }
+    blocksRecovered = wal.getBlocksRecovered();
+    blockFile.clear();
+    blockFile.seekg(headerSize);
+    useWriteAheadLog = true;
+    return true;
+}
+
+bool BlockBuffer::closeWriteAheadLog()
+{
+    if (!useWriteAheadLog) return true;
+    const bool written = blockCache.flush();
+    useWriteAheadLog = false;
+    if (!wal.close())
+    {
+        setError(wal.getLastError());
+        return false;
+    }
+    return written;
+}
+
+const WriteAheadLog& BlockBuffer::getWriteAheadLog() const
+{
+    return wal;
+}
+
+uint32_t BlockBuffer::getBlocksRecovered() const
+{
+    return blocksRecovered;
+}
+
+void BlockBuffer::endOperation()
+{
+    if (!useWriteAheadLog || !wal.endOperation()) return;
+    // Every dirty frame belongs to a finished operation now, so the group is whole
+    if (!blockCache.flush() || !wal.commit())
+        setError("Failed to commit the write-ahead log: " + wal.getLastError());
+}
+
+char* BlockBuffer::pinBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize)
+{
+    if (useMapping)
+    {
+        // Mapped blocks never move unless the file grows, nothing to pin
+        if (blockBytes(rbn, blockSize, headerSize) == nullptr)
+            return nullptr;
+        return mappedFile.data() + static_cast<size_t>(rbn_offset(headerSize, rbn, blockSize));
+    }
+
+    CacheFrame* frame = fetchFrame(rbn, blockSize, headerSize);
+    if (!frame)
+        return nullptr;
+    blockCache.pin(frame);
+    return frame->bytes.data();
+}
+
+void BlockBuffer::unpinBlockAtRBN(const uint32_t rbn, const bool dirty)
+{
+    if (useMapping) return;
+    blockCache.unpin(blockCache.peek(rbn), dirty);
+}
+
+void BlockBuffer::setCacheFrameCount(const size_t frameCount)
+{
+    blockCache.setFrameCount(frameCount);
+}
+
+uint64_t BlockBuffer::getCacheHits() const
+{
+    return blockCache.getHits();
+}
+
+uint64_t BlockBuffer::getCacheMisses() const
+{
+    return blockCache.getMisses();
+}
+
+uint64_t BlockBuffer::getBlockWrites() const
+{
+    return blockWrites;
+}
+
+const char* BlockBuffer::blockBytes(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize)
+{
+    if (!useMapping)
+    {
+        CacheFrame* frame = fetchFrame(rbn, blockSize, headerSize);
+        return frame ? frame->bytes.data() : nullptr;
+    }
+
+    const size_t offset = static_cast<size_t>(rbn_offset(headerSize, rbn, blockSize));
+    if (rbn == 0 || offset + blockSize > mappedFile.size())
+    {
+        setError("RBN " + std::to_string(rbn) + " is past the end of the file");
+        return nullptr;
+    }
+    return mappedFile.data() + offset;
+}
+
+char* BlockBuffer::writableBlockBytes(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize)
+{
+    if (!useMapping)
+    {
+        if (!blockFile.is_open())
+        {
+            setError("File not open");
+            return nullptr;
+        }
+        CacheFrame* frame = claimFrameForWrite(rbn, blockSize, headerSize);
+        if (!frame)
+        {
+            setError("No free buffer pool frame for RBN " + std::to_string(rbn));
+            return nullptr;
+        }
+        frame->dirty = true;
+        return frame->bytes.data();
+    }
+
+    const size_t offset = static_cast<size_t>(rbn_offset(headerSize, rbn, blockSize));
+    if (rbn == 0 || !mappedFile.reserve(offset + blockSize))
+    {
+        setError("Failed to map RBN " + std::to_string(rbn) + ": " + mappedFile.getLastError());
+        return nullptr;
+    }
+    return mappedFile.data() + offset;
+}
+
+CacheFrame* BlockBuffer::fetchFrame(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize)
+{
+    if (!blockFile.is_open())
+    {
+        setError("file not open");
+        return nullptr;
+    }
+
+    CacheFrame* frame = blockCache.lookup(rbn);
+    if (frame && frame->bytes.size() == blockSize)
+        return frame;
+
+    bool isNew = false;
+    frame = blockCache.claim(rbn, static_cast<uint64_t>(rbn_offset(headerSize, rbn, blockSize)),
+                             blockSize, isNew);
+    if (!frame)
+    {
+        setError("No free buffer pool frame for RBN " + std::to_string(rbn));
+        return nullptr;
+    }
+    if (!isNew)
+        return frame;
+    if (useWriteAheadLog && wal.lookup(rbn, frame->bytes.data()))
+        return frame; // Newer than the file until the next checkpoint
+
+    blockFile.clear();
+    blockFile.seekg(rbn_offset(headerSize, rbn, blockSize));
+    if (!blockFile.good())
+    {
+        blockCache.discard(rbn);
+        setError("failed to seek RBN number");
+        return nullptr;
+    }
+
+    blockFile.read(frame->bytes.data(), static_cast<std::streamsize>(blockSize));
+    std::streamsize bytesRead = blockFile.gcount();
+
+    const size_t metaSize = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t);
+    if (bytesRead <= 0 || static_cast<size_t>(bytesRead) < metaSize)
+    {
+        blockCache.discard(rbn);
+        setError("Failed to read block from file.");
+        return nullptr;
+    }
+
+    // Short read at end of file, treat the rest as padding
+    std::fill(frame->bytes.begin() + bytesRead, frame->bytes.end(), '\xFF');
+    return frame;
+}
+
+CacheFrame* BlockBuffer::claimFrameForWrite(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize)
+{
+    bool isNew = false;
+    return blockCache.claim(rbn, static_cast<uint64_t>(rbn_offset(headerSize, rbn, blockSize)),
+                            blockSize, isNew);
+}
+
+bool BlockBuffer::writeFrameToFile(const CacheFrame& frame)
+{
+    if (useWriteAheadLog)
+    {
+        // The file is only written by checkpoints, after the image is durable in the log
+        wal.stage(frame.rbn, frame.bytes.data());
+        ++blockWrites;
+        return true;
+    }
+
+    blockFile.clear();
+    blockFile.seekp(static_cast<std::streamoff>(frame.fileOffset)); // position the PUT pointer for writing
+    if (!blockFile.good())
+    {
+        setError("Failed to seek to RBN");
+        return false;
+    }
+
+    blockFile.write(frame.bytes.data(), static_cast<std::streamsize>(frame.bytes.size()));
+    ++blockWrites;
+    return blockFile.good();
+}
+
 void BlockBuffer::dumpPhysicalOrder(std::ostream& out, uint32_t sequenceSetHead,
                                    uint32_t availHead, uint32_t blockCount,
                                    uint32_t blockSize, size_t headerSize)
@@ -434,9 +1251,10 @@ void BlockBuffer::dumpPhysicalOrder(std::ostream& out, uint32_t sequenceSetHead,
             out << rbn << "  *available*  " << ab.succeedingRBN << "\n";
             continue;
         } else {
-            std::vector<ZipCodeRecord> recs; recordBuffer.unpackBlock(blk.data, recs);
+            BlockRecordIterator it(blk.data.data(), blk.data.size());
+            ZipCodeRecordView view;
             out << rbn << "  ";
-            for (const auto& r : recs) out << r.getZipCode() << " ";
+            while (it.next(view)) out << view.getZipCode() << " ";
             out << blk.succeedingRBN;
             if (blk.succeedingRBN == rbn) out << "  (self-loop)"; // annotate
             out << "\n";
@@ -444,11 +1262,11 @@ void BlockBuffer::dumpPhysicalOrder(std::ostream& out, uint32_t sequenceSetHead,
         }
 
         // Active block line: "<RBN>  keya keyb … keyk  <succRBN>"
-        std::vector<ZipCodeRecord> recs;
-        recordBuffer.unpackBlock(blk.data, recs);
+        BlockRecordIterator it(blk.data.data(), blk.data.size());
+        ZipCodeRecordView view;
 
         out << rbn << "  ";
-        for (const auto& rec : recs) out << rec.getZipCode() << " ";
+        while (it.next(view)) out << view.getZipCode() << " ";
         out << blk.succeedingRBN << "\n";
     }
 }
@@ -464,6 +1282,7 @@ void BlockBuffer::dumpLogicalOrder(std::ostream& out, uint32_t sequenceSetHead,
 
     // Active sequence set chain
     {
+        startReadahead(sequenceSetHead, blockSize, headerSize);
         std::unordered_set<uint32_t> seen;
         uint32_t curr = sequenceSetHead;
         size_t steps = 0;
@@ -489,16 +1308,17 @@ void BlockBuffer::dumpLogicalOrder(std::ostream& out, uint32_t sequenceSetHead,
                 continue;
             }
 
-            std::vector<ZipCodeRecord> recs;
-            recordBuffer.unpackBlock(blk.data, recs);
+            BlockRecordIterator it(blk.data.data(), blk.data.size());
+            ZipCodeRecordView view;
 
             out << curr << "  ";
-            for (const auto& r : recs)
-                out << r.getZipCode() << " ";
+            while (it.next(view))
+                out << view.getZipCode() << " ";
             out << blk.succeedingRBN << "\n";
 
             curr = blk.succeedingRBN;
         }
+        stopReadahead();
     }
 
     // Avail list chain
@@ -542,59 +1362,73 @@ void BlockBuffer::setError(const std::string& message){
 
 ActiveBlock BlockBuffer::loadActiveBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize){
     ActiveBlock block;
-    if (!blockFile.is_open()) 
+    ActiveBlockView view = viewActiveBlockAtRBN(rbn, blockSize, headerSize);
+    if (view.data == nullptr)
     {
-        setError("file not open");
         return block;
     }
 
-    blockFile.clear();
-    blockFile.seekg(rbn_offset(headerSize, rbn, blockSize));
+    block.recordCount = view.recordCount;
+    block.precedingRBN = view.precedingRBN;
+    block.succeedingRBN = view.succeedingRBN;
 
-    if (!blockFile.good()) 
-    {
-        setError("failed to seek RBN number");
-        return block;
-    }
+    // Store the remaining bytes as the payload/data portion of the block
+    block.data.assign(view.data, view.data + view.dataSize);
 
-    // Read the raw block bytes into a temporary buffer
-    std::vector<char> raw(blockSize);
-    blockFile.read(raw.data(), static_cast<std::streamsize>(blockSize));
+    return block;
+}
 
-    std::streamsize bytesRead = blockFile.gcount();
-    if (bytesRead <= 0) 
-    {
-        setError("Failed to read block from file.");
-        return block;
-    }
+ActiveBlockView BlockBuffer::viewActiveBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize)
+{
+    ActiveBlockView view;
+    view.data = nullptr;
+    view.dataSize = 0;
 
-    const size_t metaSize = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t);
-    if (static_cast<size_t>(bytesRead) < metaSize) 
+    if (prefetcher.isOpen()) prefetcher.advance(rbn); // keep the readahead window moving
+
+    const char* raw = blockBytes(rbn, blockSize, headerSize);
+    if (raw == nullptr)
     {
-        setError("Block too small to contain header metadata");
-        return block;
+        return view;
     }
 
-    // Copy metadata into the ActiveBlock structure
+    // Copy metadata into the view
     size_t offsetIdx = 0;
-    memcpy(&block.recordCount, raw.data() + offsetIdx, sizeof(block.recordCount));
-    offsetIdx += sizeof(block.recordCount); //reads in block data and adds to offset
-    memcpy(&block.precedingRBN, raw.data() + offsetIdx, sizeof(block.precedingRBN));
-    offsetIdx += sizeof(block.precedingRBN); //reads in preceding RBN and adds to offset
-    memcpy(&block.succeedingRBN, raw.data() + offsetIdx, sizeof(block.succeedingRBN));
-    offsetIdx += sizeof(block.succeedingRBN); //reads in succeeding RBN and adds to offset
+    memcpy(&view.recordCount, raw + offsetIdx, sizeof(view.recordCount));
+    offsetIdx += sizeof(view.recordCount); //reads in block data and adds to offset
+    memcpy(&view.precedingRBN, raw + offsetIdx, sizeof(view.precedingRBN));
+    offsetIdx += sizeof(view.precedingRBN); //reads in preceding RBN and adds to offset
+    memcpy(&view.succeedingRBN, raw + offsetIdx, sizeof(view.succeedingRBN));
+    offsetIdx += sizeof(view.succeedingRBN); //reads in succeeding RBN and adds to offset
+
+    // The remaining bytes are the payload/data portion of the block
+    view.data = raw + offsetIdx;
+    view.dataSize = blockSize - offsetIdx;
+
+    return view;
+}
 
-    // Store the remaining bytes as the payload/data portion of the block
-    if (static_cast<size_t>(bytesRead) > offsetIdx) 
-    {
-        block.data.assign(raw.begin() + offsetIdx, raw.begin() + bytesRead);
-    } 
-    else 
-    {
-        block.data.clear();
-    }
+bool BlockBuffer::startReadahead(const uint32_t headRBN, const uint32_t blockSize, const size_t headerSize,
+                                 const size_t depth)
+{
+    if (fileName.empty() || !prefetcher.open(fileName, blockSize, headerSize, depth))
+        return false;
+    prefetcher.followChain(headRBN);
+    return true;
+}
 
-    return block;
+bool BlockBuffer::startReadahead(const std::vector<uint32_t>& rbns, const uint32_t blockSize,
+                                 const size_t headerSize, const size_t depth)
+{
+    if (fileName.empty() || !prefetcher.open(fileName, blockSize, headerSize, depth))
+        return false;
+    prefetcher.followList(rbns);
+    return true;
+}
+
+void BlockBuffer::stopReadahead()
+{
+    prefetcher.close();
 }
 
 bool BlockBuffer::tryBorrowFromPreceding(ActiveBlock& block, ActiveBlock& precedingBlock,
@@ -604,15 +1438,24 @@ bool BlockBuffer::tryBorrowFromPreceding(ActiveBlock& block, ActiveBlock& preced
                                         const size_t headerSize, const uint32_t rbn)
 {
     bool borrowed = false;
+    const uint32_t blockHighKey = highKeyOf(records);
+    const uint32_t precedingHighKey = highKeyOf(precedingRecords);
+
+    // Track both sizes as records move, the block images are only repacked at the end
+    size_t blockTotal = block.getTotalSize();
+    size_t precedingTotal = precedingBlock.getTotalSize();
     
     for(int i = precedingRecords.size() - 1; i >= 0; --i)
     {
-        if((precedingRecords[i].getRecordSize() + block.getTotalSize() + 4 <= blockSize) && 
-            (precedingBlock.getTotalSize() - precedingRecords[i].getRecordSize() - 4 >= minBlockSize))
+        const size_t moveSize = recordBuffer.packedSize(precedingRecords[i]) + 4;
+        if((blockTotal + moveSize <= blockSize) && 
+            (precedingTotal >= moveSize + minBlockSize))
         {
             ZipCodeRecord temp = precedingRecords[i];
             precedingRecords.erase(precedingRecords.begin() + i);
             records.push_back(temp);
+            blockTotal += moveSize;
+            precedingTotal -= moveSize;
             borrowed = true;
         }
         else
@@ -642,6 +1485,9 @@ bool BlockBuffer::tryBorrowFromPreceding(ActiveBlock& block, ActiveBlock& preced
     // Update counts
     block.recordCount = static_cast<uint16_t>(records.size());
     precedingBlock.recordCount = static_cast<uint16_t>(precedingRecords.size());
+
+    recordIndexChange(block.precedingRBN, precedingHighKey, highKeyOf(precedingRecords));
+    recordIndexChange(rbn, blockHighKey, highKeyOf(records));
     
     // Write both blocks
     return (writeActiveBlockAtRBN(rbn, blockSize, headerSize, block) && 
@@ -655,15 +1501,24 @@ bool BlockBuffer::tryBorrowFromSucceeding(ActiveBlock& block, ActiveBlock& succe
                                          const size_t headerSize, const uint32_t rbn)
 {
     bool borrowed = false;
+    const uint32_t blockHighKey = highKeyOf(records);
+    const uint32_t succeedingHighKey = highKeyOf(succeedingRecords);
+
+    // Track both sizes as records move, the block images are only repacked at the end
+    size_t blockTotal = block.getTotalSize();
+    size_t succeedingTotal = succeedingBlock.getTotalSize();
     
     while(!succeedingRecords.empty())
     {
-        if((succeedingRecords[0].getRecordSize() + block.getTotalSize() + 4 <= blockSize) && 
-            (succeedingBlock.getTotalSize() - succeedingRecords[0].getRecordSize() - 4 >= minBlockSize))
+        const size_t moveSize = recordBuffer.packedSize(succeedingRecords[0]) + 4;
+        if((blockTotal + moveSize <= blockSize) && 
+            (succeedingTotal >= moveSize + minBlockSize))
         {
             ZipCodeRecord temp = succeedingRecords[0];
             succeedingRecords.erase(succeedingRecords.begin());
             records.push_back(temp);
+            blockTotal += moveSize;
+            succeedingTotal -= moveSize;
             borrowed = true;
         }
         else
@@ -693,6 +1548,9 @@ bool BlockBuffer::tryBorrowFromSucceeding(ActiveBlock& block, ActiveBlock& succe
     // Update counts
     block.recordCount = static_cast<uint16_t>(records.size());
     succeedingBlock.recordCount = static_cast<uint16_t>(succeedingRecords.size());
+
+    recordIndexChange(rbn, blockHighKey, highKeyOf(records));
+    recordIndexChange(block.succeedingRBN, succeedingHighKey, highKeyOf(succeedingRecords));
     
     // Write both blocks
     return (writeActiveBlockAtRBN(rbn, blockSize, headerSize, block) && 
@@ -700,8 +1558,17 @@ bool BlockBuffer::tryBorrowFromSucceeding(ActiveBlock& block, ActiveBlock& succe
 }
 
 uint32_t BlockBuffer::allocateBlock(uint32_t& availListRBN, uint32_t& blockCount, 
-                                    const uint32_t blockSize, const size_t headerSize) 
+                                    const uint32_t blockSize, const size_t headerSize,
+                                    const uint32_t nearRBN) 
 {
+    // Reuse the free block nearest the caller's block, no I/O
+    if (useFreeSpaceMap)
+    {
+        freeSpace.grow(blockCount);
+        const uint32_t freeRBN = freeSpace.allocate(nearRBN);
+        if (freeRBN != 0) return freeRBN;
+    }
+
     // Try to reuse a freed block first
     if (availListRBN != 0) 
     {
@@ -716,41 +1583,31 @@ uint32_t BlockBuffer::allocateBlock(uint32_t& availListRBN, uint32_t& blockCount
     
     // No freed blocks available - allocate new block at end of file
     blockCount++;  // Increment total block count
+
+    // Grow the mapping now so the block can be written in place
+    if (useMapping && !mappedFile.reserve(static_cast<size_t>(rbn_offset(headerSize, blockCount, blockSize)) + blockSize))
+    {
+        setError("Failed to grow mapped file: " + mappedFile.getLastError());
+    }
     return blockCount;  // New block gets this RBN
 }
 
 AvailBlock BlockBuffer::loadAvailBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize) 
 {
     AvailBlock block;
-    if (!blockFile.is_open()) 
+    const char* raw = blockBytes(rbn, blockSize, headerSize);
+    if (raw == nullptr)
     {
-        setError("file not open");
-        return block;
-    }
-
-    blockFile.clear();
-    blockFile.seekg(rbn_offset(headerSize, rbn, blockSize));
-    
-    if (!blockFile.good())
-    {
-        setError("failed to seek RBN number");
         return block;
     }
 
     // Read binary metadata
-    blockFile.read(reinterpret_cast<char*>(&block.recordCount), sizeof(uint16_t));
-    blockFile.read(reinterpret_cast<char*>(&block.succeedingRBN), sizeof(uint32_t));
+    memcpy(&block.recordCount, raw, sizeof(uint16_t));
+    memcpy(&block.succeedingRBN, raw + sizeof(uint16_t), sizeof(uint32_t));
 
-    // Read/skip padding
-    size_t paddingSize = blockSize - sizeof(uint16_t) - sizeof(uint32_t);
-    block.padding.resize(paddingSize);
-    blockFile.read(block.padding.data(), paddingSize);
+    // Copy padding
+    block.padding.assign(raw + sizeof(uint16_t) + sizeof(uint32_t), raw + blockSize);
 
-    if (!blockFile.good()) 
-    {
-        setError("Failed to read avail block from file.");
-    }
-    
     return block;
 }
 
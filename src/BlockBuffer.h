@@ -6,12 +6,50 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <functional>
 #include "RecordBuffer.h"
 #include "ZipCodeRecord.h"
+#include "BlockCache.h"
+#include "MappedFile.h"
+#include "BlockPrefetcher.h"
+#include "FreeSpaceMap.h"
+#include "WriteAheadLog.h"
+
+/**
+ * @struct BatchStats
+ * @brief Work done by a batch operation on the sequence set
+ */
+struct BatchStats
+{
+    uint32_t blocksRead; // Active blocks loaded
+    uint32_t blocksWritten; // Active blocks written
+    uint32_t blocksAllocated; // Blocks taken from the avail list or the end of the file
+    uint32_t recordsAdded; // Records merged into the sequence set
+    uint32_t duplicatesSkipped; // Records whose key was already present
+    uint32_t recordsRemoved; // Records deleted from the sequence set
+    uint32_t keysMissing; // Keys to delete that were not found
+    uint32_t blocksFreed; // Blocks returned to the avail list
+};
+
+/**
+ * @struct BlockKeyGroup
+ * @brief Sorted keys that all route to one sequence set block
+ */
+struct BlockKeyGroup
+{
+    uint32_t rbn; // Block the keys route to
+    std::vector<uint32_t> zipCodes; // Keys in ascending order
+};
+
+class ZipCodeRecordView;
 
 class BlockBuffer
 {
     public:
+        static const size_t READAHEAD_AFTER_BLOCKS = 2; // Blocks a range scan reads before reading ahead
+
+        static constexpr double DEFAULT_FILL_FACTOR = 0.9; // Share of a block filled when a batch splits it
+
         /**
          * @brief Default constructor
          */
@@ -23,11 +61,36 @@ class BlockBuffer
 
         /**
          * @brief Open file for reading
+         * @details A write-ahead log left by a crash is not replayed here, only by the
+         *          writer that opens it next (openWriteAheadLog)
          * @param filename [IN] Path to block file
          * @return True if file opened successfully
          */
         bool openFile(const std::string& filename, const size_t headerSize);
 
+        /**
+         * @brief Open file through a memory mapping instead of a stream
+         * @details Blocks are read and written directly in the mapping, views returned by
+         *          viewActiveBlockAtRBN point straight into it. Fails on platforms without mmap,
+         *          callers should fall back to openFile.
+         * @param filename [IN] Path to block file
+         * @return True if file was opened and mapped successfully
+         */
+        bool openMappedFile(const std::string& filename, const size_t headerSize);
+
+        /**
+         * @brief Check if the file was opened with openMappedFile
+         */
+        bool isMapped() const;
+
+        /**
+         * @brief Select the record format written into blocks
+         * @details Pass the header's sizeFormatType so edits keep the file's format.
+         *          Blocks in either format are always readable.
+         * @param format [IN] RecordBuffer::TEXT_RECORDS, BINARY_RECORDS or SLOTTED_RECORDS
+         */
+        void setRecordFormat(const uint8_t format);
+
         /**
          * @brief Check if there is more data in the file
          * @return True if more data is available
@@ -48,6 +111,40 @@ class BlockBuffer
          */
         bool readRecordAtRBN(const uint32_t rbn, const uint32_t zipCode, const uint32_t blockSize, const size_t headerSize, ZipCodeRecord& outRecord);
 
+        /**
+         * @brief Reads the records of many keys, viewing each block once
+         * @details Keys are grouped by RBN and the blocks visited in ascending RBN order.
+         *          A slotted page binary searches each of its keys, other blocks are
+         *          scanned once against their sorted keys.
+         * @param zipCodes Keys to read, in request order
+         * @param rbns Block each key routes to (from the index), -1 if it routes to none
+         * @param outRecords One record per key in request order, left default if not found
+         * @param found One flag per key in request order
+         * @return Number of keys found
+         */
+        size_t readRecordsAtRBNs(const std::vector<uint32_t>& zipCodes, const std::vector<uint32_t>& rbns,
+                                 const uint32_t blockSize, const size_t headerSize,
+                                 std::vector<ZipCodeRecord>& outRecords, std::vector<bool>& found);
+
+        /**
+         * @brief Streams the records with keys in lo..hi in key order
+         * @details Starts at the block the index routes lo to and follows succeedingRBN
+         *          until a key passes hi, so only the blocks holding the range are read.
+         *          Records are viewed in place. Readahead along the chain starts once the
+         *          range spans more than READAHEAD_AFTER_BLOCKS blocks.
+         * @param startRBN Block the index routes lo to (the sequence set head if unknown)
+         * @param lo Lowest key delivered
+         * @param hi Highest key delivered
+         * @param offset Records in range skipped before the first one delivered
+         * @param limit Most records delivered, 0 for no limit
+         * @param visit Called with each record, returns false to stop the scan
+         * @return Number of records delivered
+         */
+        size_t scanRange(const uint32_t startRBN, const uint32_t lo, const uint32_t hi,
+                         const uint32_t blockSize, const size_t headerSize,
+                         const size_t offset, const size_t limit,
+                         const std::function<bool(const ZipCodeRecordView&)>& visit);
+
         /**
          * @brief Writes an active block to the rbn
          * @details Writes the provided block data to the specified RBN in the file
@@ -58,6 +155,15 @@ class BlockBuffer
         bool writeActiveBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, 
                                     const size_t headerSize, const ActiveBlock& block);
 
+        /**
+         * @brief Lay out the on-disk image of an active block
+         * @details Metadata, then the block data, then 0xFF padding up to blockSize
+         * @param block The ActiveBlock to lay out
+         * @param image [OUT] blockSize bytes
+         * @return False if the data does not fit in the block
+         */
+        static bool buildActiveBlockImage(const ActiveBlock& block, const uint32_t blockSize, char* image);
+
         /**
          * @brief Writes an available block to the rbn
          * @details Writes the provided block data to the specifed RBN in the file
@@ -88,12 +194,61 @@ class BlockBuffer
         bool addRecord(const uint32_t rbn, const uint32_t blockSize, uint32_t& availListRBN, 
                         const ZipCodeRecord& record, const size_t headerSize, uint32_t& blockCount);
 
+        /**
+         * @brief Merges a key sorted run of records into one block in a single load and write
+         * @details Every record must belong to the block at rbn (at or below its highest key, or
+         *          above every key when rbn is the tail). If the merged records do not fit, the
+         *          block is split into as many blocks as needed, each filled to fillFactor of
+         *          blockSize, linked in after rbn. Keys already present are skipped. Highest key
+         *          changes go to the index change log. If a group does not pack into a block,
+         *          nothing is allocated, written or logged.
+         * @param rbn The RBN of the target block
+         * @param records Records sorted by zip code
+         * @param fillFactor Share of each block filled when splitting (0 < fillFactor <= 1)
+         * @param stats Counters to add this batch's work to
+         * @return True if every block was written
+         */
+        bool addSortedRecords(const uint32_t rbn, const uint32_t blockSize, uint32_t& availListRBN,
+                              const std::vector<ZipCodeRecord>& records, const size_t headerSize,
+                              uint32_t& blockCount, const double fillFactor, BatchStats& stats);
+
+        /**
+         * @brief Removes a batch of keys, then rebalances the affected blocks in one pass
+         * @details Groups must be in sequence set order, one per block. Groups whose blocks are
+         *          adjacent in the chain form a run that is loaded and edited together. A run whose
+         *          blocks all stay at or above minBlockSize is written back as is. Otherwise its
+         *          records are spread evenly over as few blocks as hold them, reusing the run's
+         *          RBNs in order and freeing the rest; if that still leaves blocks underfull the
+         *          preceding (or, at the head, the succeeding) neighbour joins the run first.
+         *          Each block is read and written at most once per run, no matter how many of
+         *          its keys were removed. Highest key changes go to the index change log.
+         * @param groups Keys to remove grouped by the block they route to
+         * @param stats Counters to add this batch's work to
+         * @return True if every block was written
+         */
+        bool removeSortedKeys(const std::vector<BlockKeyGroup>& groups, const uint16_t minBlockSize,
+                              uint32_t& availListRBN, const uint32_t blockSize, const size_t headerSize,
+                              BatchStats& stats);
+
         /**
          * @brief Checks if a merge occurred during the last add operation
          * @return True if a merge occurred
          */
         bool getMergeOccurred() const;
 
+        /**
+         * @brief Highest key changes made by addRecord and removeRecordAtRBN since the last clear
+         * @details One entry per block whose highest key changed, in the order the changes were
+         *          made. Applying them in order keeps an index set in step with the sequence set.
+         * @return Change log reference
+         */
+        const std::vector<IndexChange>& getIndexChanges() const;
+
+        /**
+         * @brief Empty the highest key change log
+         */
+        void clearIndexChanges();
+
         /**
          * @brief Get description of last error
          * @return Error message string reference
@@ -108,9 +263,54 @@ class BlockBuffer
 
         /**
          * @brief Close the currently opened file
+         * @details Writes back any dirty blocks held by the buffer pool first
          */
         void closeFile();
 
+        /**
+         * @brief Write back every dirty block held by the buffer pool
+         * @return True if all blocks reached the file
+         */
+        bool flush();
+
+        /**
+         * @brief Pin a block in the buffer pool and get its raw image
+         * @details The returned pointer stays valid until unpinBlockAtRBN is called
+         * @param rbn The RBN of the block to pin
+         * @param blockSize The size of blocks in the file
+         * @param headerSize The size of the file header
+         * @return Pointer to blockSize bytes or nullptr on failure
+         */
+        char* pinBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize);
+
+        /**
+         * @brief Release a block pinned with pinBlockAtRBN
+         * @param rbn The RBN of the pinned block
+         * @param dirty True if the caller modified the block image
+         */
+        void unpinBlockAtRBN(const uint32_t rbn, const bool dirty);
+
+        /**
+         * @brief Set the number of frames in the buffer pool
+         * @param frameCount Number of blocks the pool may hold
+         */
+        void setCacheFrameCount(const size_t frameCount);
+
+        /**
+         * @brief Number of block reads served by the buffer pool
+         */
+        uint64_t getCacheHits() const;
+
+        /**
+         * @brief Number of block reads that went to the file
+         */
+        uint64_t getCacheMisses() const;
+
+        /**
+         * @brief Number of block writes that went to the file (or the write-ahead log)
+         */
+        uint64_t getBlockWrites() const;
+
         /**
          * @brief Dumps the physical order of blocks in the file to standard output
          * @param out [IN] Output stream to write to
@@ -151,6 +351,98 @@ class BlockBuffer
          */
         ActiveBlock loadActiveBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize);
 
+        /**
+         * @brief Views an active block at the RBN without copying its data
+         * @details The view points into the file mapping or a buffer pool frame and is only
+         *          valid until the next call that reads, writes or allocates a block
+         * @param rbn The RBN of the block to view
+         * @return The view, data is nullptr if the block could not be read
+         */
+        ActiveBlockView viewActiveBlockAtRBN(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize);
+
+        /**
+         * @brief Track free blocks in the file's free space map instead of the avail list
+         * @details Loads the companion map (FreeSpaceMap::pathFor) if it was closed cleanly,
+         *          otherwise rebuilds it from the blocks' record counts. Blocks on the old
+         *          avail list are already marked free, so availListRBN is set to 0 and the
+         *          list is retired. blockCount is raised if the file holds more blocks. The
+         *          saved map is marked dirty until closeFreeSpaceMap.
+         *          While open, allocateBlock and freeBlock only flip bits: allocation reads
+         *          nothing and takes the free block closest to the block being split.
+         * @param availListRBN [IN,OUT] Avail list head from the header, 0 afterwards
+         * @param blockCount [IN,OUT] Block count from the header
+         * @return True if the map is in use
+         */
+        bool openFreeSpaceMap(uint32_t& availListRBN, uint32_t& blockCount,
+                              const uint32_t blockSize, const size_t headerSize);
+
+        /**
+         * @brief Save the free space map and stop using it
+         * @details Free blocks at the end of the file are dropped from the map and from
+         *          blockCount, the caller truncates the file to match after closeFile.
+         * @param blockCount [IN,OUT] Block count, lowered by the trailing free blocks
+         * @return True if the map was saved
+         */
+        bool closeFreeSpaceMap(uint32_t& blockCount);
+
+        /**
+         * @brief The free space map (empty unless openFreeSpaceMap succeeded)
+         */
+        const FreeSpaceMap& getFreeSpaceMap() const;
+
+        /**
+         * @brief Route block writes through the file's write-ahead log
+         * @details Call right after openFile, before reading blocks. From then on addRecord, removeRecordAtRBN, addSortedRecords and
+         *          removeSortedKeys are each one operation: the blocks they write reach the
+         *          log together, groupSize operations per fsync, and the file only through
+         *          checkpoints. flush() commits the open group. Not available when mapped.
+         * @param groupSize Operations committed with one fsync
+         * @return True if the log is in use
+         */
+        bool openWriteAheadLog(const uint32_t blockSize, const size_t headerSize,
+                               const size_t groupSize = WriteAheadLog::DEFAULT_GROUP_SIZE);
+
+        /**
+         * @brief Commit, checkpoint and close the write-ahead log
+         * @details closeFile does this too, call it directly to see whether it worked
+         * @return True if every block reached the file
+         */
+        bool closeWriteAheadLog();
+
+        /**
+         * @brief The write-ahead log, for its counters
+         */
+        const WriteAheadLog& getWriteAheadLog() const;
+
+        /**
+         * @brief Blocks replayed from a crashed write-ahead log by openWriteAheadLog
+         */
+        uint32_t getBlocksRecovered() const;
+
+        /**
+         * @brief Start reading ahead along the chain for a logical scan
+         * @details A background thread walks the chain up to depth blocks ahead of the
+         *          blocks viewed or loaded, so they are already in memory when the scan
+         *          gets there. For read only scans, stop before editing blocks.
+         * @param headRBN The first block of the chain
+         * @return True if readahead started, scans work the same either way
+         */
+        bool startReadahead(const uint32_t headRBN, const uint32_t blockSize, const size_t headerSize,
+                            const size_t depth = BlockPrefetcher::DEFAULT_DEPTH);
+
+        /**
+         * @brief Start reading ahead through a scan order known up front
+         * @param rbns RBNs in the order they will be viewed or loaded, e.g. from an index
+         * @return True if readahead started, scans work the same either way
+         */
+        bool startReadahead(const std::vector<uint32_t>& rbns, const uint32_t blockSize,
+                            const size_t headerSize, const size_t depth = BlockPrefetcher::DEFAULT_DEPTH);
+
+        /**
+         * @brief Stop reading ahead
+         */
+        void stopReadahead();
+
         /**
          * @brief Loads an available block from the RBN
          * @details Creates a local AvailBlock to populate with data from the specified RBN in the file
@@ -168,17 +460,108 @@ class BlockBuffer
         bool mergeOccurred; // Tracks if a merge occurred during last remove operation. Likely temporary
         bool splitOccurred; // Tracks if a split occurred during last add operation.
         RecordBuffer recordBuffer; // RecordBuffer for packing/unpacking records
+        BlockCache blockCache; // Buffer pool in front of blockFile
+        uint64_t blockWrites; // Block images written back to blockFile or the write-ahead log
+        MappedFile mappedFile; // Memory mapping used instead of blockFile when opened mapped
+        bool useMapping; // True if blocks live in mappedFile
+        std::vector<IndexChange> indexChanges; // Highest key changes not yet consumed by an index
+        std::string fileName; // Path of the open file, reopened by the prefetcher
+        BlockPrefetcher prefetcher; // Readahead for logical scans, open while a scan runs
+        FreeSpaceMap freeSpace; // Free blocks, replaces the avail list while useFreeSpaceMap
+        bool useFreeSpaceMap; // True between openFreeSpaceMap and closeFreeSpaceMap
+        WriteAheadLog wal; // Redo log the buffer pool writes back into while useWriteAheadLog
+        bool useWriteAheadLog; // True between openWriteAheadLog and closeWriteAheadLog
+        uint32_t blocksRecovered; // Blocks replayed from the log by openWriteAheadLog
+
+        /**
+         * @class OperationScope
+         * @brief Ends a write-ahead log operation when a public mutation returns
+         */
+        class OperationScope
+        {
+            public:
+                explicit OperationScope(BlockBuffer& owner) : owner(owner) {}
+                ~OperationScope() { owner.endOperation(); }
+            private:
+                BlockBuffer& owner;
+        };
+
+        /**
+         * @brief Count a finished mutation, committing the log group once it is full
+         */
+        void endOperation();
+
+        /**
+         * @brief Append to the change log if the highest key actually changed
+         */
+        void recordIndexChange(const uint32_t rbn, const uint32_t oldHighKey, const uint32_t newHighKey);
+
+        /**
+         * @brief Highest key of a sorted run of records
+         * @return Zip code of the last record, 0 if there are none
+         */
+        static uint32_t highKeyOf(const std::vector<ZipCodeRecord>& records);
+
+        /**
+         * @brief Bytes a block holding these records occupies, metadata included
+         */
+        size_t packedSizeOf(const std::vector<ZipCodeRecord>& records) const;
+
+        /**
+         * @brief Cut a sorted run of records into block sized groups
+         * @details Uses as few groups as fit at fillFactor and spreads the records evenly over them
+         * @return Groups in key order, at least one
+         */
+        std::vector<std::vector<ZipCodeRecord>> partitionRecords(const std::vector<ZipCodeRecord>& records,
+                                                                 const uint32_t blockSize,
+                                                                 const double fillFactor) const;
+
+        /**
+         * @brief Get the raw image of a block for reading
+         * @return Pointer to blockSize bytes in the mapping or a pool frame, nullptr on failure
+         */
+        const char* blockBytes(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize);
+
+        /**
+         * @brief Get the raw image of a block for overwriting, marking it dirty
+         * @return Pointer to blockSize bytes in the mapping or a pool frame, nullptr on failure
+         */
+        char* writableBlockBytes(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize);
+
+        /**
+         * @brief Get the buffer pool frame for an RBN, reading it from the file on a miss
+         * @return Frame pointer or nullptr on failure
+         */
+        CacheFrame* fetchFrame(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize);
+
+        /**
+         * @brief Get a buffer pool frame to overwrite completely, without reading the file
+         * @return Frame pointer or nullptr if every frame is pinned
+         */
+        CacheFrame* claimFrameForWrite(const uint32_t rbn, const uint32_t blockSize, const size_t headerSize);
+
+        /**
+         * @brief Write a frame's block image to the file
+         * @param frame The frame to write
+         * @return True if the write succeeded
+         */
+        bool writeFrameToFile(const CacheFrame& frame);
 
         /**
-         * @brief Allocates a new block at the end of the file
+         * @brief Allocates a free block, or a new block at the end of the file
+         * @details With the free space map open this takes the free block closest to
+         *          nearRBN without any I/O, otherwise it pops the avail list
+         * @param nearRBN Block the new one will be linked next to, 0 for no preference
          * @return RBN of the newly allocated block
          */
         uint32_t allocateBlock(uint32_t& availListRBN, uint32_t& blockCount, 
-                                const uint32_t blockSize, const size_t headerSize);
+                                const uint32_t blockSize, const size_t headerSize,
+                                const uint32_t nearRBN = 0);
 
         /**
          * @brief Frees a block at the specified RBN
-         * @details Push to available list
+         * @details Writes an empty avail image so scans skip the block, then marks it in
+         *          the free space map or pushes it on the avail list
          * @param rbn The RBN of the block to free
          * @param availListRBN Reference to the avail list head RBN
          * @param blockSize The size of blocks in the file
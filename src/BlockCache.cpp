@@ -0,0 +1,197 @@
+#include "BlockCache.h"
+#include <algorithm>
+
+BlockCache::BlockCache(const size_t frameCount)
+    : maxFrames(frameCount == 0 ? 1 : frameCount), writeBack(nullptr),
+      hits(0), misses(0), evictions(0), writeBacks(0)
+{
+}
+
+BlockCache::~BlockCache()
+{
+}
+
+void BlockCache::setWriteBack(WriteBackFn fn)
+{
+    writeBack = fn;
+}
+
+void BlockCache::setFrameCount(const size_t frameCount)
+{
+    maxFrames = (frameCount == 0) ? 1 : frameCount;
+    while (frames.size() > maxFrames)
+    {
+        if (!evictOne())
+            break; // Everything left is pinned
+    }
+}
+
+size_t BlockCache::getFrameCount() const
+{
+    return maxFrames;
+}
+
+CacheFrame* BlockCache::lookup(const uint32_t rbn)
+{
+    auto found = frameTable.find(rbn);
+    if (found == frameTable.end())
+    {
+        ++misses;
+        return nullptr;
+    }
+
+    ++hits;
+    frames.splice(frames.begin(), frames, found->second); // Move to MRU position
+    return &(*found->second);
+}
+
+CacheFrame* BlockCache::peek(const uint32_t rbn)
+{
+    auto found = frameTable.find(rbn);
+    return (found == frameTable.end()) ? nullptr : &(*found->second);
+}
+
+CacheFrame* BlockCache::claim(const uint32_t rbn, const uint64_t fileOffset,
+                              const size_t blockSize, bool& isNew)
+{
+    auto found = frameTable.find(rbn);
+    if (found != frameTable.end())
+    {
+        frames.splice(frames.begin(), frames, found->second);
+        CacheFrame& frame = *found->second;
+        isNew = false;
+        if (frame.bytes.size() != blockSize)
+        {
+            // Same RBN viewed with a different block size, the old image is meaningless
+            frame.bytes.assign(blockSize, '\0');
+            frame.dirty = false;
+            isNew = true;
+        }
+        frame.fileOffset = fileOffset;
+        return &frame;
+    }
+
+    if (frames.size() >= maxFrames && !evictOne())
+        return nullptr; // Every frame is pinned
+
+    frames.push_front(CacheFrame());
+    CacheFrame& frame = frames.front();
+    frame.rbn = rbn;
+    frame.fileOffset = fileOffset;
+    frame.bytes.assign(blockSize, '\0');
+    frame.dirty = false;
+    frame.pinCount = 0;
+    frameTable[rbn] = frames.begin();
+
+    isNew = true;
+    return &frame;
+}
+
+void BlockCache::discard(const uint32_t rbn)
+{
+    auto found = frameTable.find(rbn);
+    if (found == frameTable.end() || found->second->pinCount > 0)
+        return;
+    frames.erase(found->second);
+    frameTable.erase(found);
+}
+
+void BlockCache::pin(CacheFrame* frame)
+{
+    if (frame) ++frame->pinCount;
+}
+
+void BlockCache::unpin(CacheFrame* frame, const bool dirty)
+{
+    if (!frame) return;
+    if (frame->pinCount > 0) --frame->pinCount;
+    if (dirty) frame->dirty = true;
+}
+
+bool BlockCache::flush()
+{
+    // Write back in RBN order so the file sees (mostly) sequential writes
+    std::vector<CacheFrame*> dirtyFrames;
+    for (auto& frame : frames)
+    {
+        if (frame.dirty) dirtyFrames.push_back(&frame);
+    }
+    std::sort(dirtyFrames.begin(), dirtyFrames.end(),
+        [](const CacheFrame* a, const CacheFrame* b)
+        {
+            return a->rbn < b->rbn;
+        });
+
+    bool ok = true;
+    for (auto* frame : dirtyFrames)
+    {
+        ok = writeBackFrame(*frame) && ok;
+    }
+    return ok;
+}
+
+void BlockCache::clear()
+{
+    frames.clear();
+    frameTable.clear();
+}
+
+uint64_t BlockCache::getHits() const
+{
+    return hits;
+}
+
+uint64_t BlockCache::getMisses() const
+{
+    return misses;
+}
+
+uint64_t BlockCache::getEvictions() const
+{
+    return evictions;
+}
+
+uint64_t BlockCache::getWriteBacks() const
+{
+    return writeBacks;
+}
+
+void BlockCache::resetStats()
+{
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    writeBacks = 0;
+}
+
+bool BlockCache::evictOne()
+{
+    // Walk from the LRU end towards the front looking for an unpinned frame
+    for (auto it = frames.end(); it != frames.begin(); )
+    {
+        --it;
+        if (it->pinCount > 0)
+            continue;
+
+        if (!writeBackFrame(*it))
+            return false;
+
+        frameTable.erase(it->rbn);
+        frames.erase(it);
+        ++evictions;
+        return true;
+    }
+    return false;
+}
+
+bool BlockCache::writeBackFrame(CacheFrame& frame)
+{
+    if (!frame.dirty)
+        return true;
+    if (!writeBack || !writeBack(frame))
+        return false;
+
+    frame.dirty = false;
+    ++writeBacks;
+    return true;
+}
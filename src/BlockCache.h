@@ -0,0 +1,185 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <functional>
+
+/**
+ * @file BlockCache.h
+ * @author Group 2
+ * @brief BlockCache class for buffering block images in memory
+ * @version 0.1
+ * @date 2025-11-02
+ */
+
+/**
+ * @struct CacheFrame
+ * @brief One buffer pool frame holding a full block image
+ */
+struct CacheFrame
+{
+    uint32_t rbn; // RBN of the block held by this frame
+    uint64_t fileOffset; // Byte offset of the block in the file
+    std::vector<char> bytes; // Full block image (metadata + data + padding)
+    bool dirty; // Frame has been modified since it was last written back
+    uint16_t pinCount; // Number of active users, pinned frames are never evicted
+};
+
+/**
+ * @class BlockCache
+ * @brief Fixed size buffer pool with LRU eviction
+ * @details Frames are kept in a list ordered from most to least recently used.
+ *          Dirty frames are handed to the write back function when evicted or
+ *          flushed, so the owner decides how bytes reach the file.
+ */
+class BlockCache
+{
+public:
+    static const size_t DEFAULT_FRAME_COUNT = 64;
+
+    using WriteBackFn = std::function<bool(const CacheFrame& frame)>;
+
+    /**
+     * @brief Constructor
+     * @param frameCount [IN] Maximum number of frames held by the pool
+     */
+    explicit BlockCache(const size_t frameCount = DEFAULT_FRAME_COUNT);
+
+    /**
+     * @brief Destructor
+     * @details Does not write back, the owner must call flush() first
+     */
+    ~BlockCache();
+
+    /**
+     * @brief Set the function used to write dirty frames back to storage
+     * @param fn [IN] Write back function
+     */
+    void setWriteBack(WriteBackFn fn);
+
+    /**
+     * @brief Change the number of frames in the pool
+     * @details Shrinking evicts least recently used frames (writing back dirty ones)
+     * @param frameCount [IN] New frame count (minimum of 1)
+     */
+    void setFrameCount(const size_t frameCount);
+
+    /**
+     * @brief Frame Count Getter
+     * @return Maximum number of frames
+     */
+    size_t getFrameCount() const;
+
+    /**
+     * @brief Look up the frame holding an RBN
+     * @details Counts a hit or miss and moves a found frame to the front of the LRU list
+     * @param rbn [IN] RBN to look for
+     * @return Frame pointer or nullptr on a miss
+     */
+    CacheFrame* lookup(const uint32_t rbn);
+
+    /**
+     * @brief Find the frame holding an RBN without touching counters or LRU order
+     * @param rbn [IN] RBN to look for
+     * @return Frame pointer or nullptr if not resident
+     */
+    CacheFrame* peek(const uint32_t rbn);
+
+    /**
+     * @brief Get a frame for an RBN without reading it
+     * @details Returns the resident frame if there is one, otherwise evicts the least
+     *          recently used unpinned frame (writing it back if dirty) and reuses it.
+     *          Does not count towards hits or misses.
+     * @param rbn [IN] RBN the frame will hold
+     * @param fileOffset [IN] Byte offset of the block in the file
+     * @param blockSize [IN] Size of the block image
+     * @param isNew [OUT] True if the frame did not already hold the RBN
+     * @return Frame pointer or nullptr if every frame is pinned
+     */
+    CacheFrame* claim(const uint32_t rbn, const uint64_t fileOffset,
+                      const size_t blockSize, bool& isNew);
+
+    /**
+     * @brief Drop a frame without writing it back
+     * @param rbn [IN] RBN of the frame to drop
+     */
+    void discard(const uint32_t rbn);
+
+    /**
+     * @brief Pin a frame so it cannot be evicted
+     * @param frame [IN] Frame to pin
+     */
+    void pin(CacheFrame* frame);
+
+    /**
+     * @brief Release a pin on a frame
+     * @param frame [IN] Frame to unpin
+     * @param dirty [IN] True if the caller modified the frame
+     */
+    void unpin(CacheFrame* frame, const bool dirty);
+
+    /**
+     * @brief Write back every dirty frame in ascending RBN order
+     * @return True if every write back succeeded
+     */
+    bool flush();
+
+    /**
+     * @brief Drop every frame without writing back
+     */
+    void clear();
+
+    /**
+     * @brief Number of lookups served from the pool
+     */
+    uint64_t getHits() const;
+
+    /**
+     * @brief Number of lookups that had to go to storage
+     */
+    uint64_t getMisses() const;
+
+    /**
+     * @brief Number of frames evicted to make room
+     */
+    uint64_t getEvictions() const;
+
+    /**
+     * @brief Number of dirty frames written back to storage
+     */
+    uint64_t getWriteBacks() const;
+
+    /**
+     * @brief Reset all counters to zero
+     */
+    void resetStats();
+
+private:
+    size_t maxFrames; // Capacity of the pool
+    std::list<CacheFrame> frames; // Frames ordered most to least recently used
+    std::unordered_map<uint32_t, std::list<CacheFrame>::iterator> frameTable; // RBN to frame
+    WriteBackFn writeBack; // Owner supplied write back
+    uint64_t hits; // Lookups found in the pool
+    uint64_t misses; // Lookups not found in the pool
+    uint64_t evictions; // Frames evicted
+    uint64_t writeBacks; // Dirty frames written back
+
+    /**
+     * @brief Evict the least recently used unpinned frame
+     * @return True if a frame was evicted
+     */
+    bool evictOne();
+
+    /**
+     * @brief Write back a single frame if it is dirty
+     * @param frame [IN,OUT] Frame to write back
+     * @return True if the frame is clean afterwards
+     */
+    bool writeBackFrame(CacheFrame& frame);
+};
+
+#endif // BLOCK_CACHE_H
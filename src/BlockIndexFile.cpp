@@ -6,7 +6,7 @@
 
 const std::string ENDOFFILE = "|";
 
-BlockIndexFile::BlockIndexFile(){    
+BlockIndexFile::BlockIndexFile() : layoutCurrent(false){    
 }
 
 BlockIndexFile::~BlockIndexFile(){    
@@ -18,21 +18,28 @@ bool BlockIndexFile::createIndexFromBlockedFile(const std::string& zcbFilePath,
                                                uint32_t sequenceSetHead)
 {
     indexEntries.clear();  // Clear any existing entries
+    layoutCurrent = false;
     
     BlockBuffer blockBuffer;
     RecordBuffer recordBuffer;
     
-    if (!blockBuffer.openFile(zcbFilePath, headerSize)) {
+    // Prefer the mapped backend for the full sequence set walk, fall back to streams
+    if (!blockBuffer.openMappedFile(zcbFilePath, headerSize) &&
+        !blockBuffer.openFile(zcbFilePath, headerSize)) {
         return false;
     }
+    blockBuffer.startReadahead(sequenceSetHead, blockSize, headerSize);
     
     uint32_t currentRBN = sequenceSetHead;
     while(currentRBN != 0)
     {
-        ActiveBlock block = blockBuffer.loadActiveBlockAtRBN(currentRBN, blockSize, headerSize);
+        ActiveBlockView block = blockBuffer.viewActiveBlockAtRBN(currentRBN, blockSize, headerSize);
+        if (block.data == nullptr) {
+            break;
+        }
         
         std::vector<ZipCodeRecord> records;
-        recordBuffer.unpackBlock(block.data, records);
+        recordBuffer.unpackBlock(block.data, block.dataSize, records);
         
         if (!records.empty()) {
             IndexEntry entry;
@@ -50,25 +57,73 @@ bool BlockIndexFile::createIndexFromBlockedFile(const std::string& zcbFilePath,
         {
             return a.key < b.key;
         });
+    buildSearchLayout();
     
     blockBuffer.closeFile();
     return true;
 }
 
 void BlockIndexFile::addIndexEntry(const IndexEntry& entry){
-    if(indexEntries.empty()){
-        indexEntries.push_back(entry);
-        return;
-    }
+    // Keep entries sorted by key, appending in key order is O(1)
+    auto pos = std::upper_bound(indexEntries.begin(), indexEntries.end(), entry.key,
+        [](const uint32_t key, const IndexEntry& e)
+        {
+            return key < e.key;
+        });
+    indexEntries.insert(pos, entry);
+    layoutCurrent = false;
+}
 
-    for(int i = 0; i < indexEntries.size(); i++){
-        if(indexEntries[i].key < entry.key){
-            indexEntries.insert(indexEntries.begin() + i, entry);
-            return;
+
+bool BlockIndexFile::applyChanges(const std::vector<IndexChange>& changes){
+    for(const auto& change : changes){
+        layoutCurrent = false;
+        if(change.oldHighKey == 0){ // Block joined the sequence set
+            IndexEntry entry;
+            entry.key = change.newHighKey;
+            entry.recordRBN = change.rbn;
+            addIndexEntry(entry);
+            continue;
+        }
+
+        auto it = findEntry(change.oldHighKey, change.rbn);
+        if(it == indexEntries.end()){
+            return false; // Index does not match the sequence set
+        }
+
+        if(change.newHighKey == 0){ // Block left the sequence set
+            indexEntries.erase(it);
+            continue;
+        }
+
+        // Blocks stay in key order, so the new key normally fits the same slot
+        const bool inOrder = (it == indexEntries.begin() || (it - 1)->key < change.newHighKey) &&
+                             (it + 1 == indexEntries.end() || change.newHighKey < (it + 1)->key);
+        if(inOrder){
+            it->key = change.newHighKey;
+        }
+        else{
+            indexEntries.erase(it);
+            IndexEntry entry;
+            entry.key = change.newHighKey;
+            entry.recordRBN = change.rbn;
+            addIndexEntry(entry);
         }
     }
+    return true;
 }
 
+std::vector<IndexEntry>::iterator BlockIndexFile::findEntry(const uint32_t key, const uint32_t rbn){
+    auto it = std::lower_bound(indexEntries.begin(), indexEntries.end(), key,
+        [](const IndexEntry& e, const uint32_t k)
+        {
+            return e.key < k;
+        });
+    if(it == indexEntries.end() || it->key != key || it->recordRBN != rbn){
+        return indexEntries.end();
+    }
+    return it;
+}
 
 bool BlockIndexFile::write(const std::string& filename){
     std::ofstream file;
@@ -91,6 +146,7 @@ bool BlockIndexFile::read(const std::string& filename){
     std::ifstream file;
     file.open(filename, std::ios::in);
     indexEntries.clear(); //clear list
+    layoutCurrent = false;
     if(!file){
         return false;
     }
@@ -109,6 +165,7 @@ bool BlockIndexFile::read(const std::string& filename){
         file >> current; //read in next "{" or EOF marker
     }
     file.close();
+    buildSearchLayout();
 
     return true;
 }
@@ -116,10 +173,71 @@ bool BlockIndexFile::read(const std::string& filename){
 
 uint32_t BlockIndexFile::findRBNForKey(const uint32_t zipCode) const
 {
-    for(const auto& index : indexEntries)
+    if(!layoutCurrent)
     {
-        if(zipCode <= index.key) 
-            return index.recordRBN;
+        // First entry whose highest key is >= zipCode
+        auto it = std::lower_bound(indexEntries.begin(), indexEntries.end(), zipCode,
+            [](const IndexEntry& e, const uint32_t key)
+            {
+                return e.key < key;
+            });
+        return (it == indexEntries.end()) ? static_cast<uint32_t>(-1) : it->recordRBN;
     }
-    return -1;
+
+    // Branch free descent, node k has children 2k and 2k+1
+    const uint32_t* keys = eytzingerKeys.data();
+    const size_t n = indexEntries.size();
+    size_t k = 1;
+    while(k <= n)
+    {
+#if defined(__GNUC__)
+        __builtin_prefetch(keys + 16 * k); // Cache line holding the node four levels down
+#endif
+        k = 2 * k + (keys[k] < zipCode);
+    }
+
+    // Undo the right turns taken after the last left turn, that node is the answer
+#if defined(__GNUC__)
+    k >>= __builtin_ffsll(static_cast<long long>(~k));
+#else
+    while(k & 1) k >>= 1;
+    k >>= 1;
+#endif
+    return (k == 0) ? static_cast<uint32_t>(-1) : eytzingerRBNs[k];
+}
+
+void BlockIndexFile::buildSearchLayout()
+{
+    eytzingerKeys.assign(indexEntries.size() + 1, 0);
+    eytzingerRBNs.assign(indexEntries.size() + 1, 0);
+    size_t next = 0;
+    fillLayout(next, 1);
+    layoutCurrent = true;
+}
+
+uint32_t BlockIndexFile::getTailRBN() const
+{
+    return indexEntries.empty() ? 0 : indexEntries.back().recordRBN;
+}
+
+size_t BlockIndexFile::getEntryCount() const
+{
+    return indexEntries.size();
+}
+
+const std::vector<IndexEntry>& BlockIndexFile::getEntries() const
+{
+    return indexEntries;
+}
+
+void BlockIndexFile::fillLayout(size_t& next, const size_t node)
+{
+    // In order walk of the implicit tree hands out the sorted entries
+    if(node > indexEntries.size())
+        return;
+    fillLayout(next, 2 * node);
+    eytzingerKeys[node] = indexEntries[next].key;
+    eytzingerRBNs[node] = indexEntries[next].recordRBN;
+    ++next;
+    fillLayout(next, 2 * node + 1);
 }
\ No newline at end of file
@@ -32,6 +32,15 @@ public:
     */
     void addIndexEntry(const IndexEntry& entry);
 
+    /**
+     * @brief Apply a BlockBuffer highest key change log in order
+     * @details Updates, inserts and removes entries in place so the index does not need
+     *          a rebuild after add/del. Marks the search layout stale.
+     * @param changes The changes reported by BlockBuffer::getIndexChanges
+     * @returns true if every change matched the index, false means the index is stale
+     */
+    bool applyChanges(const std::vector<IndexChange>& changes);
+
     /**
      * @brief Writes the index entries to a file
      * @param filename The name of the file to write to
@@ -48,19 +57,59 @@ public:
 
     /**
      * @brief Find RBN for block containing the given zip code
+     * @details Uses the Eytzinger layout when it is current, otherwise a binary
+     *          search over the sorted entries. Both are O(log n).
      * @param zipCode zipCode Zip code to search for
      * @return RBN of block that should contain this zip (or -1 if not found)
      */
     uint32_t findRBNForKey(const uint32_t zipCode) const;
 
+    /**
+     * @brief RBN of the block with the highest key
+     * @return Tail RBN or 0 if the index is empty
+     */
+    uint32_t getTailRBN() const;
+
+    /**
+     * @brief Rebuild the Eytzinger (breadth first) copy of the keys used by findRBNForKey
+     * @details Called by read and createIndexFromBlockedFile. Adding entries marks the
+     *          layout stale until this is called again.
+     */
+    void buildSearchLayout();
+
+    /**
+     * @brief Number of entries in the index
+     */
+    size_t getEntryCount() const;
+
+    /**
+     * @brief Index entries sorted by key
+     */
+    const std::vector<IndexEntry>& getEntries() const;
+
     bool createIndexFromBlockedFile(const std::string& zcbFilePath,
                                                uint32_t blockSize,
                                                size_t headerSize,
                                                uint32_t sequenceSetHead);
 
 private:
-    std::vector<IndexEntry> indexEntries; // Vector of index entries
+    std::vector<IndexEntry> indexEntries; // Vector of index entries, sorted by key
+    std::vector<uint32_t> eytzingerKeys; // Keys in breadth first order, 1-indexed
+    std::vector<uint32_t> eytzingerRBNs; // RBNs matching eytzingerKeys
+    bool layoutCurrent; // eytzingerKeys matches indexEntries
 
+    /**
+     * @brief Fill the Eytzinger arrays from the sorted entries
+     * @param next [IN,OUT] Next sorted entry to place
+     * @param node [IN] Eytzinger node being filled
+     */
+    void fillLayout(size_t& next, const size_t node);
+
+    /**
+     * @brief Find the entry for a block by its current highest key
+     * @return Iterator to the entry or end() if no entry matches both key and rbn
+     */
+    std::vector<IndexEntry>::iterator findEntry(const uint32_t key, const uint32_t rbn);
 
 };
 
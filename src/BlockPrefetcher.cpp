@@ -0,0 +1,207 @@
+#include "BlockPrefetcher.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <cerrno>
+
+#if ZCD_HAS_MMAP
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Byte offset of an RBN, same layout as BlockBuffer
+static inline uint64_t blockOffset(const size_t headerSize, const uint32_t rbn, const uint32_t blockSize)
+{
+    return static_cast<uint64_t>(headerSize) + static_cast<uint64_t>(rbn - 1) * blockSize;
+}
+
+BlockPrefetcher::BlockPrefetcher()
+    : fd(-1), blockSize(0), headerSize(0), depth(DEFAULT_DEPTH), blockCount(0),
+      plan(), planPosition(0), planAdvised(0), walker(), walkLock(), walkWake(),
+      stopping(false), walked(0), consumed(0), blocksAdvised(0), lastError()
+{
+}
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+    close();
+}
+
+#if ZCD_HAS_MMAP
+
+bool BlockPrefetcher::open(const std::string& filename, const uint32_t inBlockSize,
+                           const size_t inHeaderSize, const size_t inDepth)
+{
+    close();
+
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        setError("Cannot open file: " + filename + " (" + std::strerror(errno) + ")");
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || inBlockSize == 0)
+    {
+        setError("Cannot stat file: " + filename);
+        close();
+        return false;
+    }
+
+    blockSize = inBlockSize;
+    headerSize = inHeaderSize;
+    depth = inDepth > 0 ? inDepth : 1;
+    const size_t fileSize = static_cast<size_t>(st.st_size);
+    blockCount = fileSize > headerSize ? static_cast<uint32_t>((fileSize - headerSize) / blockSize) : 0;
+    blocksAdvised = 0;
+    return true;
+}
+
+void BlockPrefetcher::close()
+{
+    stopWalker();
+    plan.clear();
+    planPosition = 0;
+    planAdvised = 0;
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void BlockPrefetcher::adviseRBN(const uint32_t rbn)
+{
+    if (rbn == 0 || rbn > blockCount) return;
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd, static_cast<off_t>(blockOffset(headerSize, rbn, blockSize)),
+                  static_cast<off_t>(blockSize), POSIX_FADV_WILLNEED);
+#endif
+    ++blocksAdvised;
+}
+
+void BlockPrefetcher::walkChain(uint32_t curr)
+{
+    const size_t metaSize = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t);
+    char meta[metaSize];
+
+    // A valid chain visits each block once, anything longer is a cycle
+    for (uint32_t steps = 0; curr != 0 && steps < blockCount; ++steps)
+    {
+        {
+            std::unique_lock<std::mutex> guard(walkLock);
+            walkWake.wait(guard, [this] { return stopping || walked < consumed + depth; });
+            if (stopping) return;
+        }
+
+        adviseRBN(curr);
+        const off_t offset = static_cast<off_t>(blockOffset(headerSize, curr, blockSize));
+        if (pread(fd, meta, metaSize, offset) != static_cast<ssize_t>(metaSize)) return;
+        std::memcpy(&curr, meta + sizeof(uint16_t) + sizeof(uint32_t), sizeof(curr));
+
+        std::lock_guard<std::mutex> guard(walkLock);
+        ++walked;
+    }
+}
+
+#else // !ZCD_HAS_MMAP
+
+bool BlockPrefetcher::open(const std::string& filename, const uint32_t inBlockSize,
+                           const size_t inHeaderSize, const size_t inDepth)
+{
+    setError("Readahead is not supported on this platform: " + filename);
+    return false;
+}
+
+void BlockPrefetcher::close()
+{
+}
+
+void BlockPrefetcher::adviseRBN(const uint32_t rbn)
+{
+}
+
+void BlockPrefetcher::walkChain(uint32_t curr)
+{
+}
+
+#endif // ZCD_HAS_MMAP
+
+void BlockPrefetcher::followList(const std::vector<uint32_t>& rbns)
+{
+    if (fd < 0) return;
+    stopWalker();
+    plan = rbns;
+    planPosition = 0;
+    planAdvised = 0;
+    while (planAdvised < plan.size() && planAdvised < depth)
+        adviseRBN(plan[planAdvised++]);
+}
+
+void BlockPrefetcher::followChain(const uint32_t headRBN)
+{
+    if (fd < 0) return;
+    stopWalker();
+    plan.clear();
+    planPosition = 0;
+    planAdvised = 0;
+    stopping = false;
+    walked = 0;
+    consumed = 0;
+    walker = std::thread(&BlockPrefetcher::walkChain, this, headRBN);
+}
+
+void BlockPrefetcher::advance(const uint32_t rbn)
+{
+    if (fd < 0) return;
+
+    if (!plan.empty())
+    {
+        // Reads off the plan (avail blocks, lookups) do not move the window
+        if (planPosition < plan.size() && plan[planPosition] == rbn) ++planPosition;
+        while (planAdvised < plan.size() && planAdvised < planPosition + depth)
+            adviseRBN(plan[planAdvised++]);
+        return;
+    }
+
+    if (walker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> guard(walkLock);
+            ++consumed;
+        }
+        walkWake.notify_one();
+    }
+}
+
+void BlockPrefetcher::stopWalker()
+{
+    if (!walker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(walkLock);
+        stopping = true;
+    }
+    walkWake.notify_one();
+    walker.join();
+}
+
+bool BlockPrefetcher::isOpen() const
+{
+    return fd >= 0;
+}
+
+uint64_t BlockPrefetcher::getBlocksAdvised() const
+{
+    return blocksAdvised;
+}
+
+const std::string& BlockPrefetcher::getLastError() const
+{
+    return lastError;
+}
+
+void BlockPrefetcher::setError(const std::string& message)
+{
+    lastError = message;
+}
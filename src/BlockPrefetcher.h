@@ -0,0 +1,144 @@
+#ifndef BLOCK_PREFETCHER_H
+#define BLOCK_PREFETCHER_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ * @file BlockPrefetcher.h
+ * @author Group 2
+ * @brief BlockPrefetcher class for reading ahead along the sequence set
+ * @version 0.1
+ * @date 2025-11-12
+ */
+
+/**
+ * @class BlockPrefetcher
+ * @brief Keeps the next blocks of a logical scan on their way into the page cache
+ * @details A logical scan is a chain of dependent reads, the next RBN is only known
+ *          once the current block is in memory. The prefetcher asks the kernel to read
+ *          up to depth blocks ahead of the scan (posix_fadvise WILLNEED) so that the
+ *          scan's own reads, stream or mapped, hit the page cache.
+ *
+ *          When the scan order is known up front (from an index) the RBNs are advised
+ *          straight from the list. Otherwise a background thread walks the chain ahead
+ *          of the scan, reading only each block's metadata to find the next RBN.
+ *          The scan calls advance() for every block it reaches.
+ *
+ *          Meant for read only scans, the walker does not see blocks the scan relinks.
+ *          Without POSIX file APIs open() fails and the scan runs unassisted.
+ */
+class BlockPrefetcher
+{
+public:
+    static const size_t DEFAULT_DEPTH = 16; // Blocks kept in flight ahead of the scan
+
+    /**
+     * @brief Default constructor
+     */
+    BlockPrefetcher();
+
+    /**
+     * @brief Destructor
+     * @details Stops the walker thread and closes the file
+     */
+    ~BlockPrefetcher();
+
+    /**
+     * @brief Open the blocked file for readahead
+     * @param filename [IN] Path to the blocked file
+     * @param blockSize [IN] Bytes per block
+     * @param headerSize [IN] Bytes before RBN 1
+     * @param depth [IN] Blocks to keep advised ahead of the scan (at least 1)
+     * @return True if the file was opened
+     */
+    bool open(const std::string& filename, const uint32_t blockSize, const size_t headerSize,
+              const size_t depth);
+
+    /**
+     * @brief Read ahead through a known scan order
+     * @param rbns [IN] RBNs in the order the scan will visit them
+     */
+    void followList(const std::vector<uint32_t>& rbns);
+
+    /**
+     * @brief Read ahead by walking the chain from a head RBN on a background thread
+     * @param headRBN [IN] First block of the chain
+     */
+    void followChain(const uint32_t headRBN);
+
+    /**
+     * @brief Tell the prefetcher the scan has reached a block
+     * @param rbn [IN] Block the scan is about to read
+     */
+    void advance(const uint32_t rbn);
+
+    /**
+     * @brief Stop the walker thread and close the file
+     */
+    void close();
+
+    /**
+     * @brief Check if a file is open
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Number of blocks advised since open
+     */
+    uint64_t getBlocksAdvised() const;
+
+    /**
+     * @brief Get description of last error
+     */
+    const std::string& getLastError() const;
+
+private:
+    int fd; // Read only descriptor used for advice and metadata reads
+    uint32_t blockSize; // Bytes per block
+    size_t headerSize; // Bytes before RBN 1
+    size_t depth; // Blocks kept advised ahead of the scan
+    uint32_t blockCount; // Whole blocks in the file, bounds the chain walk
+
+    std::vector<uint32_t> plan; // Scan order when following a list
+    size_t planPosition; // Next plan entry the scan will reach
+    size_t planAdvised; // Plan entries advised so far
+
+    std::thread walker; // Background chain walker
+    std::mutex walkLock; // Guards stopping, walked and consumed
+    std::condition_variable walkWake; // Signals the walker when the scan moves or stops
+    bool stopping; // Walker should exit
+    uint64_t walked; // Blocks the walker has advised
+    uint64_t consumed; // Blocks the scan has reached
+
+    std::atomic<uint64_t> blocksAdvised; // Blocks advised since open
+    std::string lastError; // Last error message
+
+    /**
+     * @brief Ask the kernel to start reading a block
+     */
+    void adviseRBN(const uint32_t rbn);
+
+    /**
+     * @brief Walker thread body, stays at most depth blocks ahead of the scan
+     */
+    void walkChain(uint32_t headRBN);
+
+    /**
+     * @brief Stop and join the walker thread if it is running
+     */
+    void stopWalker();
+
+    /**
+     * @brief Set error message
+     */
+    void setError(const std::string& message);
+};
+
+#endif // BLOCK_PREFETCHER_H
@@ -0,0 +1,97 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @file BoundedQueue.h
+ * @author Group 2
+ * @brief BoundedQueue class for handing work between two pipeline stages
+ * @version 0.1
+ * @date 2025-11-20
+ */
+
+/**
+ * @class BoundedQueue
+ * @brief Blocking FIFO holding at most capacity items
+ * @details push waits while the queue is full, pop while it is empty. close() ends the
+ *          stream: pop drains what is left and then returns false, push returns false at
+ *          once, so a stage that fails closes its queues to stop the stages around it.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    /**
+     * @brief Constructor
+     * @param inCapacity [IN] Items held before push waits (at least 1)
+     */
+    explicit BoundedQueue(const size_t inCapacity)
+        : items(), capacity(inCapacity > 0 ? inCapacity : 1), closed(false), pushWaits(0)
+    {
+    }
+
+    /**
+     * @brief Append an item, waiting for room
+     * @return False if the queue was closed, the item is dropped
+     */
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> guard(queueLock);
+        if (items.size() >= capacity && !closed) ++pushWaits;
+        notFull.wait(guard, [this] { return items.size() < capacity || closed; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest item, waiting for one
+     * @return False once the queue is closed and empty
+     */
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> guard(queueLock);
+        notEmpty.wait(guard, [this] { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief End the stream and wake every waiting stage
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    /**
+     * @brief Pushes that had to wait for room, i.e. times the consumer was the bottleneck
+     */
+    size_t getPushWaits() const
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        return pushWaits;
+    }
+
+private:
+    std::deque<T> items; // Queued items, oldest first
+    size_t capacity; // Most items held
+    bool closed; // No more items will be pushed
+    size_t pushWaits; // Pushes that found the queue full
+    mutable std::mutex queueLock; // Guards everything above
+    std::condition_variable notEmpty; // Signals pop
+    std::condition_variable notFull; // Signals push
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,239 @@
+#include "BulkLoader.h"
+#include "BlockBuffer.h"
+#include <algorithm>
+#include <thread>
+
+const size_t BLOCK_METADATA_SIZE = 10; // recordCount (2) | precedingRBN (4) | succeedingRBN (4)
+const size_t RECORD_SLACK = 4; // Per record margin kept by every packing loop
+
+BulkLoader::BulkLoader()
+    : recordBuffer(), fillFactor(1.0), blockReserve(0), blockSize(0), recordCount(0), blockCount(0), indexEntries(),
+      writeCount(0), packWaits(0), writeWaits(0), packError(), writeError(), lastError()
+{
+}
+
+void BulkLoader::setRecordFormat(const uint8_t format)
+{
+    recordBuffer.setRecordFormat(format);
+}
+
+void BulkLoader::setFillFactor(const double inFillFactor)
+{
+    fillFactor = inFillFactor;
+}
+
+void BulkLoader::setBlockReserve(const uint32_t inBlockReserve)
+{
+    blockReserve = inBlockReserve;
+}
+
+bool BulkLoader::load(const std::string& zcbFile, const std::vector<uint8_t>& headerBytes,
+                      const uint32_t inBlockSize, const std::function<bool(ZipCodeRecord&)>& nextRecord)
+{
+    blockSize = inBlockSize;
+    recordCount = 0;
+    blockCount = 0;
+    indexEntries.clear();
+    writeCount = 0;
+    packWaits = 0;
+    writeWaits = 0;
+    packError.clear();
+    writeError.clear();
+    lastError.clear();
+
+    if (blockSize <= BLOCK_METADATA_SIZE + recordBuffer.blockOverhead())
+    {
+        setError("Block size too small: " + std::to_string(blockSize));
+        return false;
+    }
+
+    std::ofstream out(zcbFile, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        setError("Cannot create output file: " + zcbFile);
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(headerBytes.data()), static_cast<std::streamsize>(headerBytes.size()));
+    ++writeCount;
+
+    BoundedQueue<std::vector<ZipCodeRecord>> records(QUEUE_DEPTH);
+    BoundedQueue<std::vector<char>> images(QUEUE_DEPTH);
+    std::thread packer(&BulkLoader::runPacker, this, std::ref(records), std::ref(images));
+    std::thread writer(&BulkLoader::runWriter, this, std::ref(out), std::ref(images));
+
+    // Source stage: the push fails once a later stage has given up
+    std::vector<ZipCodeRecord> batch;
+    batch.reserve(RECORD_BATCH);
+    ZipCodeRecord record;
+    bool flowing = true;
+    while (flowing && nextRecord(record))
+    {
+        batch.push_back(record);
+        if (batch.size() == RECORD_BATCH)
+        {
+            flowing = records.push(std::move(batch));
+            batch.clear();
+            batch.reserve(RECORD_BATCH);
+        }
+    }
+    if (flowing && !batch.empty()) records.push(std::move(batch));
+    records.close();
+
+    packer.join();
+    writer.join();
+    packWaits = records.getPushWaits();
+    writeWaits = images.getPushWaits();
+
+    out.close();
+    if (!packError.empty())
+    {
+        setError(packError);
+        return false;
+    }
+    if (!writeError.empty())
+    {
+        setError(writeError);
+        return false;
+    }
+    if (!out)
+    {
+        setError("Failed to write " + zcbFile);
+        return false;
+    }
+    return true;
+}
+
+uint32_t BulkLoader::getRecordCount() const
+{
+    return recordCount;
+}
+
+uint32_t BulkLoader::getBlockCount() const
+{
+    return blockCount;
+}
+
+const std::vector<IndexEntry>& BulkLoader::getIndexEntries() const
+{
+    return indexEntries;
+}
+
+size_t BulkLoader::getWriteCount() const
+{
+    return writeCount;
+}
+
+void BulkLoader::getStageWaits(size_t& outPackWaits, size_t& outWriteWaits) const
+{
+    outPackWaits = packWaits;
+    outWriteWaits = writeWaits;
+}
+
+const std::string& BulkLoader::getLastError() const
+{
+    return lastError;
+}
+
+void BulkLoader::runPacker(BoundedQueue<std::vector<ZipCodeRecord>>& records, BoundedQueue<std::vector<char>>& images)
+{
+    const size_t emptySize = BLOCK_METADATA_SIZE + recordBuffer.blockOverhead();
+    const size_t reserveLimit = blockReserve < blockSize ? blockSize - blockReserve : 0;
+    const size_t fillLimit = std::min(static_cast<size_t>(blockSize * fillFactor), reserveLimit);
+    const size_t blocksPerRun = std::max<size_t>(1, WRITE_BYTES / blockSize);
+
+    std::vector<ZipCodeRecord> blockRecords;
+    size_t currentSize = emptySize;
+    std::vector<char> run;
+    run.reserve(blocksPerRun * blockSize);
+
+    std::vector<ZipCodeRecord> batch;
+    bool ok = true;
+    while (ok && records.pop(batch))
+    {
+        for (const ZipCodeRecord& rec : batch)
+        {
+            const size_t recordSize = recordBuffer.packedSize(rec) + RECORD_SLACK;
+            if (!blockRecords.empty() &&
+                (currentSize + recordSize > blockSize || currentSize + recordSize > fillLimit))
+            {
+                // Another record follows, so the block links to the next RBN
+                if (!finishBlock(blockRecords, blockCount + 2, run))
+                {
+                    ok = false;
+                    break;
+                }
+                currentSize = emptySize;
+
+                if (run.size() >= blocksPerRun * blockSize)
+                {
+                    ok = images.push(std::move(run));
+                    run.clear();
+                    run.reserve(blocksPerRun * blockSize);
+                    if (!ok) break;
+                }
+            }
+            blockRecords.push_back(rec);
+            currentSize += recordSize;
+            ++recordCount;
+        }
+    }
+
+    if (ok && !blockRecords.empty()) ok = finishBlock(blockRecords, 0, run);
+    if (ok && !run.empty()) images.push(std::move(run));
+
+    // Stop the source as well if this stage failed
+    images.close();
+    if (!ok) records.close();
+}
+
+bool BulkLoader::finishBlock(std::vector<ZipCodeRecord>& blockRecords, const uint32_t succeedingRBN,
+                             std::vector<char>& run)
+{
+    const uint32_t rbn = blockCount + 1;
+
+    ActiveBlock block;
+    block.precedingRBN = rbn - 1;
+    block.succeedingRBN = succeedingRBN;
+    block.recordCount = static_cast<uint16_t>(blockRecords.size());
+    const bool packed = recordBuffer.packBlock(blockRecords, block.data, blockSize);
+
+    const size_t offset = run.size();
+    run.resize(offset + blockSize);
+    if (!packed || !BlockBuffer::buildActiveBlockImage(block, blockSize, run.data() + offset))
+    {
+        packError = "Record " + std::to_string(blockRecords.front().getZipCode()) +
+                    " does not fit in a block of " + std::to_string(blockSize) + " bytes";
+        return false;
+    }
+
+    // Records are sorted, so the last one holds the block's highest key
+    IndexEntry entry;
+    entry.key = blockRecords.back().getZipCode();
+    entry.recordRBN = rbn;
+    indexEntries.push_back(entry);
+
+    ++blockCount;
+    blockRecords.clear();
+    return true;
+}
+
+void BulkLoader::runWriter(std::ofstream& out, BoundedQueue<std::vector<char>>& images)
+{
+    std::vector<char> run;
+    while (images.pop(run))
+    {
+        out.write(run.data(), static_cast<std::streamsize>(run.size()));
+        ++writeCount;
+        if (!out)
+        {
+            writeError = "Failed to write blocks";
+            images.close();
+            return;
+        }
+    }
+}
+
+void BulkLoader::setError(const std::string& message)
+{
+    lastError = message;
+}
@@ -0,0 +1,147 @@
+#ifndef BULK_LOADER_H
+#define BULK_LOADER_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <fstream>
+#include "ZipCodeRecord.h"
+#include "RecordBuffer.h"
+#include "BlockIndexFile.h"
+#include "BoundedQueue.h"
+
+/**
+ * @file BulkLoader.h
+ * @author Group 2
+ * @brief BulkLoader class for writing a new blocked file from sorted records in a pipeline
+ * @version 0.1
+ * @date 2025-11-20
+ */
+
+/**
+ * @class BulkLoader
+ * @brief Packs sorted records into blocks and writes them as one sequential stream
+ * @details Three stages run at once, connected by bounded queues:
+ *            source : the calling thread pulls sorted records and hands them on in batches
+ *            pack   : fills blocks in order up to the fill factor or block reserve,
+ *                     whichever leaves more room, links them at RBN 1, 2, ... and
+ *                     lays out their images; the highest key of each block
+ *                     becomes an index entry as soon as the block is finished
+ *            write  : appends runs of consecutive block images to the file with one
+ *                     write each, after the header bytes, without flushing per block
+ *          The blocks are identical to those BlockBuffer::writeActiveBlockAtRBN writes, and
+ *          the index entries match BlockIndexFile::createIndexFromBlockedFile, so the
+ *          file does not have to be read back to index it. A stage that fails closes its
+ *          queues, which stops the others.
+ */
+class BulkLoader
+{
+public:
+    static const size_t RECORD_BATCH = 2048; // Records handed to the packer at once
+    static const size_t WRITE_BYTES = 1u << 20; // Block images gathered into one write
+    static const size_t QUEUE_DEPTH = 4; // Batches waiting between two stages
+
+    /**
+     * @brief Default constructor
+     */
+    BulkLoader();
+
+    /**
+     * @brief Select the record format packed into the blocks
+     * @param format [IN] RecordBuffer::TEXT_RECORDS, BINARY_RECORDS or SLOTTED_RECORDS
+     */
+    void setRecordFormat(const uint8_t format);
+
+    /**
+     * @brief Share of each block filled before the next one is started
+     * @param fillFactor [IN] In (0, 1], default 1
+     */
+    void setFillFactor(const double fillFactor);
+
+    /**
+     * @brief Bytes left free at the end of every block, on top of the fill factor
+     * @param blockReserve [IN] Default 0, a block still takes one record if the reserve leaves no room
+     */
+    void setBlockReserve(const uint32_t blockReserve);
+
+    /**
+     * @brief Write a new blocked file, replacing any file of the same name
+     * @param zcbFile [IN] Path of the file
+     * @param headerBytes [IN] Serialized header, RBN 1 starts right after it
+     * @param blockSize [IN] Bytes per block
+     * @param nextRecord [IN] Returns the next record in zip code order, false after the last
+     * @return True if every block was written
+     */
+    bool load(const std::string& zcbFile, const std::vector<uint8_t>& headerBytes, const uint32_t blockSize,
+              const std::function<bool(ZipCodeRecord&)>& nextRecord);
+
+    /**
+     * @brief Records written by the last load
+     */
+    uint32_t getRecordCount() const;
+
+    /**
+     * @brief Blocks written by the last load
+     */
+    uint32_t getBlockCount() const;
+
+    /**
+     * @brief Highest key and RBN of every block written, in key order
+     */
+    const std::vector<IndexEntry>& getIndexEntries() const;
+
+    /**
+     * @brief Write calls made by the last load, the header included
+     */
+    size_t getWriteCount() const;
+
+    /**
+     * @brief Times the source waited for the packer and the packer for the writer
+     * @param packWaits [OUT] Record batches that found the pack queue full
+     * @param writeWaits [OUT] Image runs that found the write queue full
+     */
+    void getStageWaits(size_t& packWaits, size_t& writeWaits) const;
+
+    /**
+     * @brief Get description of last error
+     */
+    const std::string& getLastError() const;
+
+private:
+    RecordBuffer recordBuffer; // Packs block data, used by the pack stage only
+    double fillFactor; // Share of a block filled
+    uint32_t blockReserve; // Bytes left free per block
+    uint32_t blockSize; // Bytes per block of the current load
+    uint32_t recordCount; // Records packed
+    uint32_t blockCount; // Blocks packed
+    std::vector<IndexEntry> indexEntries; // One per block, filled by the pack stage
+    size_t writeCount; // Writes made by the write stage
+    size_t packWaits; // Source pushes that waited
+    size_t writeWaits; // Pack pushes that waited
+    std::string packError; // Set by the pack stage if it failed
+    std::string writeError; // Set by the write stage if it failed
+    std::string lastError; // Last error message
+
+    /**
+     * @brief Pack stage body
+     */
+    void runPacker(BoundedQueue<std::vector<ZipCodeRecord>>& records, BoundedQueue<std::vector<char>>& images);
+
+    /**
+     * @brief Lay out one finished block at the end of run
+     * @return False if the records do not fit in a block
+     */
+    bool finishBlock(std::vector<ZipCodeRecord>& blockRecords, const uint32_t succeedingRBN,
+                     std::vector<char>& run);
+
+    /**
+     * @brief Write stage body
+     */
+    void runWriter(std::ofstream& out, BoundedQueue<std::vector<char>>& images);
+
+    void setError(const std::string& message);
+};
+
+#endif // BULK_LOADER_H
@@ -8,6 +8,7 @@
 
 #include "CSVBuffer.h"
 #include "ZipCodeRecord.h"
+#include "RecordTokenizer.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
@@ -18,7 +19,10 @@
  * @details Initializes buffer in closed state
  */
 CSVBuffer::CSVBuffer() 
-    : lineNumber(0), recordsProcessed(0), errorState(false), lastError("")
+    : lineNumber(0), recordsProcessed(0), errorState(false), isLengthIndicatedMode(false), lastError(""),
+      parallelMode(false), chunkBytes(DEFAULT_CHUNK_BYTES), maxChunksInFlight(0), readerAtEnd(false),
+      carry(), nextChunkLine(0), chunksInFlight(), parseQueue(), parseWorkers(), parseLock(),
+      parseWake(), parseDone(), parseStopping(false)
 {
 }
 
@@ -27,7 +31,10 @@ CSVBuffer::CSVBuffer()
  * @details Automatically opens file and skips header
  */
 CSVBuffer::CSVBuffer(const std::string& filename, const uint32_t headerSize)
-    : lineNumber(0), recordsProcessed(0), errorState(false), lastError("")
+    : lineNumber(0), recordsProcessed(0), errorState(false), isLengthIndicatedMode(false), lastError(""),
+      parallelMode(false), chunkBytes(DEFAULT_CHUNK_BYTES), maxChunksInFlight(0), readerAtEnd(false),
+      carry(), nextChunkLine(0), chunksInFlight(), parseQueue(), parseWorkers(), parseLock(),
+      parseWake(), parseDone(), parseStopping(false)
 {
     openLengthIndicatedFile(filename, headerSize);
 }
@@ -71,6 +78,217 @@ bool CSVBuffer::openFile(const std::string& filename)
     return true;
 }
 
+/**
+ * @brief Open CSV file for reading in parallel chunks
+ * @details Skips the header like openFile, then starts the parse workers
+ */
+bool CSVBuffer::openFileParallel(const std::string& filename, const size_t threads, const size_t inChunkBytes)
+{
+    if (!openFile(filename))
+    {
+        return false;
+    }
+
+    size_t workerCount = threads;
+    if (workerCount == 0)
+    {
+        workerCount = std::thread::hardware_concurrency();
+        if (workerCount == 0) workerCount = 1;
+    }
+
+    // The first data row was already read by skipHeader
+    parallelMode = true;
+    chunkBytes = inChunkBytes > 0 ? inChunkBytes : DEFAULT_CHUNK_BYTES;
+    maxChunksInFlight = 2 * workerCount;
+    readerAtEnd = false;
+    carry = currentLine + "\n";
+    nextChunkLine = lineNumber + 1;
+    currentLine.clear();
+
+    parseStopping = false;
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        parseWorkers.emplace_back(&CSVBuffer::runParseWorker, this);
+    }
+    return true;
+}
+
+/**
+ * @brief Read the records of the next parsed chunk
+ * @details Keeps the workers busy by reading ahead before waiting on the oldest chunk
+ */
+bool CSVBuffer::getNextBatch(std::vector<ZipCodeRecord>& batch)
+{
+    batch.clear();
+    if (!parallelMode || errorState)
+    {
+        return false;
+    }
+
+    for (;;)
+    {
+        while (chunksInFlight.size() < maxChunksInFlight && queueNextChunk())
+        {
+        }
+        if (chunksInFlight.empty())
+        {
+            return false; // End of file
+        }
+
+        const std::shared_ptr<ParseChunk> chunk = chunksInFlight.front();
+        {
+            std::unique_lock<std::mutex> guard(parseLock);
+            parseDone.wait(guard, [&chunk] { return chunk->done; });
+        }
+        chunksInFlight.pop_front();
+
+        batch.swap(chunk->records);
+        recordsProcessed += static_cast<uint32_t>(batch.size());
+        if (chunk->errorLine != 0)
+        {
+            lineNumber = chunk->errorLine;
+            setError(chunk->errorMessage);
+            return !batch.empty();
+        }
+
+        lineNumber = chunk->lastLine;
+        if (!batch.empty())
+        {
+            return true;
+        }
+        // Only blank lines in this chunk, try the next one
+    }
+}
+
+bool CSVBuffer::queueNextChunk()
+{
+    if (readerAtEnd)
+    {
+        return false;
+    }
+
+    // A chunk starts with the partial line left by the previous one
+    std::shared_ptr<ParseChunk> chunk = std::make_shared<ParseChunk>();
+    chunk->text.swap(carry);
+    const size_t start = chunk->text.size();
+    chunk->text.resize(start + chunkBytes);
+    csvFile.read(&chunk->text[start], static_cast<std::streamsize>(chunkBytes));
+    const size_t got = static_cast<size_t>(csvFile.gcount());
+    chunk->text.resize(start + got);
+
+    if (got < chunkBytes)
+    {
+        readerAtEnd = true;
+    }
+    else
+    {
+        const size_t cut = chunk->text.rfind('\n');
+        if (cut == std::string::npos)
+        {
+            carry.swap(chunk->text); // No line end yet, keep reading
+            return true;
+        }
+        carry.assign(chunk->text, cut + 1, std::string::npos);
+        chunk->text.resize(cut + 1);
+    }
+
+    const uint32_t lines = static_cast<uint32_t>(std::count(chunk->text.begin(), chunk->text.end(), '\n'));
+    const bool unterminated = !chunk->text.empty() && chunk->text.back() != '\n';
+    chunk->firstLine = nextChunkLine;
+    nextChunkLine += lines;
+    chunk->lastLine = nextChunkLine - (unterminated ? 0 : 1);
+    chunk->errorLine = 0;
+    chunk->done = false;
+
+    chunksInFlight.push_back(chunk);
+    {
+        std::lock_guard<std::mutex> guard(parseLock);
+        parseQueue.push_back(chunk);
+    }
+    parseWake.notify_one();
+    return true;
+}
+
+void CSVBuffer::parseChunk(ParseChunk& chunk)
+{
+    // Tokenized in place, one pass over the chunk
+    const std::string_view text(chunk.text);
+    std::string_view fields[EXPECTED_FIELD_COUNT];
+    uint32_t number = chunk.firstLine;
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+        if (text[begin] == '\n') // Skip empty lines
+        {
+            ++begin;
+            ++number;
+            continue;
+        }
+
+        size_t fieldCount = 0;
+        const size_t used = RecordTokenizer::splitRecord(text.substr(begin), fields, EXPECTED_FIELD_COUNT, fieldCount);
+        ZipCodeRecord record;
+        if (fieldCount != EXPECTED_FIELD_COUNT)
+        {
+            chunk.errorLine = number;
+            chunk.errorMessage = "Failed to parse line " + std::to_string(number);
+            return;
+        }
+        if (!RecordTokenizer::fieldsToRecord(fields, record))
+        {
+            chunk.errorLine = number;
+            chunk.errorMessage = "Failed to convert fields to record on line " + std::to_string(number);
+            return;
+        }
+        chunk.records.push_back(record);
+
+        number += static_cast<uint32_t>(std::count(text.begin() + begin, text.begin() + begin + used, '\n'));
+        begin += used;
+    }
+}
+
+void CSVBuffer::runParseWorker()
+{
+    for (;;)
+    {
+        std::shared_ptr<ParseChunk> chunk;
+        {
+            std::unique_lock<std::mutex> guard(parseLock);
+            parseWake.wait(guard, [this] { return parseStopping || !parseQueue.empty(); });
+            if (parseStopping) return;
+            chunk = parseQueue.front();
+            parseQueue.pop_front();
+        }
+
+        parseChunk(*chunk);
+
+        {
+            std::lock_guard<std::mutex> guard(parseLock);
+            chunk->done = true;
+        }
+        parseDone.notify_all();
+    }
+}
+
+void CSVBuffer::stopParseWorkers()
+{
+    {
+        std::lock_guard<std::mutex> guard(parseLock);
+        parseStopping = true;
+        parseQueue.clear();
+    }
+    parseWake.notify_all();
+    for (std::thread& worker : parseWorkers)
+    {
+        worker.join();
+    }
+    parseWorkers.clear();
+    chunksInFlight.clear();
+    carry.clear();
+    parallelMode = false;
+    readerAtEnd = false;
+}
+
 /**
  * @brief Read next zip code record from file
  * @details Parses line and converts to ZipCodeRecord
@@ -89,14 +307,14 @@ bool CSVBuffer::getNextRecord(ZipCodeRecord& record)
         std::string lineToProcess = currentLine;
         currentLine.clear(); // Clear it so we don't use it again
         
-        std::vector<std::string> fields;
+        std::string_view fields[EXPECTED_FIELD_COUNT];
         if (!parseLine(lineToProcess, fields)) // Parse this line
         {
             setError("Failed to parse line " + std::to_string(lineNumber));
             return false;
         }
         
-        if (!fieldsToRecord(fields, record)) // Convert fields to record
+        if (!RecordTokenizer::fieldsToRecord(fields, record)) // Convert fields to record
         {
             setError("Failed to convert fields to record on line " + std::to_string(lineNumber));
             return false;
@@ -123,14 +341,14 @@ bool CSVBuffer::getNextRecord(ZipCodeRecord& record)
         return getNextRecord(record);  // Recursively try next line
     }
     
-    std::vector<std::string> fields;
+    std::string_view fields[EXPECTED_FIELD_COUNT];
     if (!parseLine(currentLine, fields)) // Parse the line into fields
     {
         setError("Failed to parse line " + std::to_string(lineNumber));
         return false;
     }
     
-    if (!fieldsToRecord(fields, record))  // Convert fields to record
+    if (!RecordTokenizer::fieldsToRecord(fields, record))  // Convert fields to record
     {
         setError("Failed to convert fields to record on line " + std::to_string(lineNumber));
         return false;
@@ -146,6 +364,10 @@ bool CSVBuffer::getNextRecord(ZipCodeRecord& record)
  */
 bool CSVBuffer::hasMoreRecords() const
 {
+    if (parallelMode)
+    {
+        return !errorState && !(readerAtEnd && chunksInFlight.empty());
+    }
     return csvFile.is_open() && !csvFile.eof() && !errorState;
 }
 
@@ -154,6 +376,7 @@ bool CSVBuffer::hasMoreRecords() const
  */
 void CSVBuffer::closeFile()
 {
+    stopParseWorkers();
     if (csvFile.is_open()) 
     {
         csvFile.close();
@@ -222,75 +445,11 @@ bool CSVBuffer::skipHeader()
     return false;
 }
 
-bool CSVBuffer::parseLine(const std::string& line, std::vector<std::string>& fields)
-{
-    fields.clear();
-    std::stringstream ss(line);
-    std::string field;
-    
-    while (std::getline(ss, field, ',')) 
-    {
-        trimString(field);
-        fields.push_back(field);
-    }
-    
-    if (fields.size() != EXPECTED_FIELD_COUNT) // Validate field count
-    {
-        return false;
-    }
-    
-    return true;
-}
-
-/**
- * @brief Convert string fields to ZipCodeRecord
- * @details Validates and converts each field type
- */
-bool CSVBuffer::fieldsToRecord(const std::vector<std::string>& fields, ZipCodeRecord& record)
+bool CSVBuffer::parseLine(const std::string_view line, std::string_view* fields)
 {
-    if (fields.size() != EXPECTED_FIELD_COUNT) 
-        return false;
-    
-    // Validate and convert each field
-    // Field 0: Zip Code (integer)
-    if (!isValidUInt32(fields[0])) 
-    {
-        return false;
-    }
-    uint32_t zipCode = static_cast<uint32_t>(std::stoul(fields[0]));
-    
-    // Field 4: Latitude (double)
-    if (!isValidDouble(fields[4])) 
-    {
-        return false;
-    }
-    double latitude = std::stod(fields[4]);
-    
-    // Field 5: Longitude (double)  
-    if (!isValidDouble(fields[5])) 
-    {
-        return false;
-    }
-    double longitude = std::stod(fields[5]);
-    
-    // Field 1: Place Name (string)
-    std::string placeName = fields[1];
-    
-    // Field 2: State (string, must be 2 chars)
-    std::string state = fields[2];
-    if (state.length() != 2)
-    {
-        return false;
-    }
-    
-    // Field 3: County (string)
-    std::string county = fields[3];
-    
-    // Create the record
-    ZipCodeRecord tempRecord(zipCode, latitude, longitude, placeName, state, county);
-    record = tempRecord;
-    
-    return true;
+    size_t fieldCount = 0;
+    const size_t used = RecordTokenizer::splitRecord(line, fields, EXPECTED_FIELD_COUNT, fieldCount);
+    return used == line.size() && fieldCount == EXPECTED_FIELD_COUNT; // Validate field count
 }
 
 /**
@@ -311,43 +470,6 @@ void CSVBuffer::trimString(std::string& str)
     }).base(), str.end());
 }
 
-/**
- * @brief Validate that string represents valid integer
- */
-bool CSVBuffer::isValidUInt32(const std::string& str) const
-{
-    if (str.empty()) return false;
-    
-    try 
-    {
-        long val = std::stol(str);
-        if (val < 0 || val > 4294967295) return false;
-        return true;
-    } 
-    catch (const std::exception&) 
-    {
-        return false;
-    }
-}
-
-/**
- * @brief Validate that string represents valid double
- */
-bool CSVBuffer::isValidDouble(const std::string& str) const
-{
-    if (str.empty()) return false;
-    
-    try 
-    {
-        std::stod(str);
-        return true;
-    } 
-    catch (const std::exception&) 
-    {
-        return false;
-    }
-}
-
 /**
  * @brief Set error state with message
  */
@@ -421,14 +543,14 @@ bool CSVBuffer::getNextLengthIndicatedRecord(ZipCodeRecord& record)
     }
 
     // Parse CSV string
-    std::vector<std::string> fields;
+    std::string_view fields[EXPECTED_FIELD_COUNT];
     if (!parseLine(csvRecord, fields)) 
     {
         setError("Failed to parse record");
         return false;
     }
 
-    if (!fieldsToRecord(fields, record)) 
+    if (!RecordTokenizer::fieldsToRecord(fields, record)) 
     {
         setError("Failed to convert fields to record");
         return false;
@@ -483,14 +605,14 @@ bool CSVBuffer::readRecordAtMemoryAddress(const size_t address, ZipCodeRecord& r
     }
     
     // Parse CSV string
-    std::vector<std::string> fields;
+    std::string_view fields[EXPECTED_FIELD_COUNT];
     if (!parseLine(csvRecord, fields)) 
     {
         setError("Failed to parse record");
         return false;
     }
     
-    if (!fieldsToRecord(fields, record)) 
+    if (!RecordTokenizer::fieldsToRecord(fields, record)) 
     {
         setError("Failed to convert fields to record");
         return false;
@@ -6,7 +6,13 @@
 #include <vector>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 /**
  * @file CSVBuffer.h
@@ -22,6 +28,10 @@
  * @details Reads CSV files line by line, parses comma-separated values,
  *          and converts them into ZipCodeRecord objects. Handles header
  *          row skipping and provides efficient sequential access.
+ *
+ *          openFileParallel reads the rows after the header in large chunks cut at
+ *          line ends and parses them on worker threads. getNextBatch hands back each
+ *          chunk's records in file order, so the result matches getNextRecord.
  */
 class CSVBuffer
 {
@@ -29,6 +39,7 @@ public:
     // Header field constants for validation (ie stored class members)
     static const int EXPECTED_FIELD_COUNT = 6;
     static const char* const EXPECTED_HEADERS[EXPECTED_FIELD_COUNT];
+    static const size_t DEFAULT_CHUNK_BYTES = 4 << 20; // Bytes read per parallel chunk
     
     /**
      * @brief Default constructor
@@ -71,6 +82,27 @@ public:
      */
     bool getNextRecord(ZipCodeRecord& record);
     
+    /**
+     * @brief Open CSV file for reading in parallel chunks
+     * @param filename [IN] Path to CSV file
+     * @param threads [IN] Parse threads, 0 for one per core
+     * @param chunkBytes [IN] Bytes read per chunk, a chunk always ends at a line end
+     * @return true if file opened successfully and header is valid
+     * @post Header skipped as by openFile, records are read with getNextBatch
+     * @details At most two chunks per thread are read ahead of the caller
+     */
+    bool openFileParallel(const std::string& filename, const size_t threads = 0,
+                          const size_t chunkBytes = DEFAULT_CHUNK_BYTES);
+
+    /**
+     * @brief Read the records of the next chunk parsed by openFileParallel
+     * @param batch [OUT] Records in file order, replaces the contents
+     * @return true if records were read, false at end of file or once an error is set
+     * @details A malformed line sets the same error as getNextRecord, with its line
+     *          number, after the records before it in the chunk are returned
+     */
+    bool getNextBatch(std::vector<ZipCodeRecord>& batch);
+    
     /**
      * @brief Check if more records are available
      * @return true if more data can be read, false if EOF or error
@@ -141,6 +173,21 @@ public:
     bool readRecordAtMemoryAddress(const size_t address, ZipCodeRecord& record);
 
 private:
+    /**
+     * @struct ParseChunk
+     * @brief Whole lines of the file parsed by one worker
+     */
+    struct ParseChunk
+    {
+        std::string text; // Lines, each ending in a newline except maybe the last of the file
+        uint32_t firstLine; // Line number of the first line
+        uint32_t lastLine; // Line number of the last line
+        std::vector<ZipCodeRecord> records; // Parsed records in file order
+        uint32_t errorLine; // First malformed line, 0 if none
+        std::string errorMessage; // Error for errorLine
+        bool done; // Parsed, guarded by parseLock
+    };
+
     std::ifstream csvFile; // Input file stream
     std::string currentLine; // Current line buffer
     uint32_t lineNumber; // Current line number (1-based)
@@ -148,6 +195,21 @@ private:
     bool errorState; // Error flag
     bool isLengthIndicatedMode;  // Track read mode
     std::string lastError; // Last error message
+
+    bool parallelMode; // Records come from parse workers (openFileParallel)
+    size_t chunkBytes; // Bytes read per chunk
+    size_t maxChunksInFlight; // Chunks read ahead of getNextBatch
+    bool readerAtEnd; // Every byte of the file has been put in a chunk
+    std::string carry; // Partial line at the end of the last chunk read
+    uint32_t nextChunkLine; // Line number of the first line of the next chunk
+    std::deque<std::shared_ptr<ParseChunk>> chunksInFlight; // Chunks read, in file order
+    std::deque<std::shared_ptr<ParseChunk>> parseQueue; // Chunks waiting for a worker, guarded by parseLock
+    std::vector<std::thread> parseWorkers; // Parse threads
+    std::mutex parseLock; // Guards parseQueue, parseStopping and ParseChunk::done
+    std::condition_variable parseWake; // Wakes workers
+    std::condition_variable parseDone; // Signals a parsed chunk
+    bool parseStopping; // Workers should exit
+
     /**
      * @brief Skip and validate CSV header row
      * @return true if header is valid and skipped successfully
@@ -160,21 +222,11 @@ private:
     /**
      * @brief Parse comma-separated line into individual fields
      * @param line [IN] CSV line to parse
-     * @param fields [OUT] Vector to store parsed fields
+     * @param fields [OUT] EXPECTED_FIELD_COUNT views into line
      * @return true if parsing successful
-     * @details Handles quoted fields and comma separation
+     * @details Handles quoted fields and comma separation, see RecordTokenizer
      */
-    bool parseLine(const std::string& line, std::vector<std::string>& fields);
-    
-    /**
-     * @brief Convert string fields to ZipCodeRecord
-     * @param fields [IN] Vector of string fields from CSV
-     * @param record [OUT] ZipCodeRecord to populate
-     * @return true if conversion successful
-     * @pre fields must contain exactly 6 valid elements
-     * @post record is populated with converted data
-     */
-    bool fieldsToRecord(const std::vector<std::string>& fields, ZipCodeRecord& record);
+    bool parseLine(const std::string_view line, std::string_view* fields);
     
     /**
      * @brief Trim whitespace from string
@@ -184,19 +236,27 @@ private:
     void trimString(std::string& str);
     
     /**
-     * @brief Validate that a string represents a valid integer
-     * @param str [IN] String to validate
-     * @return true if string is a valid integer
+     * @brief Read the next chunk and queue it for the workers
+     * @return false once the whole file has been queued
      */
-    bool isValidUInt32(const std::string& str) const;
-    
+    bool queueNextChunk();
+
     /**
-     * @brief Validate that a string represents a valid double
-     * @param str [IN] String to validate  
-     * @return true if string is a valid double
+     * @brief Parse every line of a chunk, stopping at the first malformed one
+     * @details Only touches the chunk, so workers run it concurrently
      */
-    bool isValidDouble(const std::string& str) const;
-    
+    void parseChunk(ParseChunk& chunk);
+
+    /**
+     * @brief Parse worker body
+     */
+    void runParseWorker();
+
+    /**
+     * @brief Stop and join the parse workers and drop unread chunks
+     */
+    void stopParseWorkers();
+
     /**
      * @brief Set error state with message
      * @param message [IN] Error description
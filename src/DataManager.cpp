@@ -1,9 +1,13 @@
 // DataManager.cpp
 #include "DataManager.h"
 #include "ZipCodeRecord.h"
+#include "BlockIndexFile.h"
 #include <sstream>
 #include <map>
 #include <iostream>
+#include <fstream>
+#include <thread>
+#include <vector>
 
 void DataManager::updateExtremes(Extremes& ex, const ZipCodeRecord& rec) 
 {
@@ -34,12 +38,83 @@ void DataManager::processRecord(const ZipCodeRecord& rec)
     updateExtremes(ex, rec);
 }
 
+/**
+ * @brief Check if a coordinate beats the current extreme
+ * @details Strictly further wins. On a tie the lower zip wins, which is the record a
+ *          logical (ascending zip) scan meets first, so the result does not depend on
+ *          the order blocks are visited in.
+ */
+static bool isFurther(const double value, const uint32_t zip, const double best,
+                      const uint32_t bestZip, const bool larger)
+{
+    if (value != best) return larger ? value > best : value < best;
+    return zip < bestZip;
+}
+
+void DataManager::updateExtremes(Extremes& ex, const ZipCodeRecordView& rec)
+{
+    if (!ex.initialized)
+    {
+        updateExtremes(ex, rec.toRecord());
+        return;
+    }
+    const uint32_t zip = rec.getZipCode();
+    const double lat = rec.getLatitude();
+    const double lon = rec.getLongitude();
+    if (isFurther(lon, zip, ex.easternmost.getLongitude(), ex.easternmost.getZipCode(), true))
+        ex.easternmost = rec.toRecord();
+    if (isFurther(lon, zip, ex.westernmost.getLongitude(), ex.westernmost.getZipCode(), false))
+        ex.westernmost = rec.toRecord();
+    if (isFurther(lat, zip, ex.northernmost.getLatitude(), ex.northernmost.getZipCode(), true))
+        ex.northernmost = rec.toRecord();
+    if (isFurther(lat, zip, ex.southernmost.getLatitude(), ex.southernmost.getZipCode(), false))
+        ex.southernmost = rec.toRecord();
+}
+
+void DataManager::mergeExtremes(Extremes& into, const Extremes& from)
+{
+    if (!from.initialized) return;
+    if (!into.initialized)
+    {
+        into = from;
+        return;
+    }
+    const ZipCodeRecord& e = from.easternmost;
+    const ZipCodeRecord& w = from.westernmost;
+    const ZipCodeRecord& n = from.northernmost;
+    const ZipCodeRecord& s = from.southernmost;
+    if (isFurther(e.getLongitude(), e.getZipCode(), into.easternmost.getLongitude(), into.easternmost.getZipCode(), true))
+        into.easternmost = e;
+    if (isFurther(w.getLongitude(), w.getZipCode(), into.westernmost.getLongitude(), into.westernmost.getZipCode(), false))
+        into.westernmost = w;
+    if (isFurther(n.getLatitude(), n.getZipCode(), into.northernmost.getLatitude(), into.northernmost.getZipCode(), true))
+        into.northernmost = n;
+    if (isFurther(s.getLatitude(), s.getZipCode(), into.southernmost.getLatitude(), into.southernmost.getZipCode(), false))
+        into.southernmost = s;
+}
+
+void DataManager::processRecord(const ZipCodeRecordView& rec)
+{
+    processRecordInto(stateExtremes_, rec);
+}
+
+void DataManager::processRecordInto(std::unordered_map<std::string, Extremes>& extremes,
+                                    const ZipCodeRecordView& rec)
+{
+    // Enforce two-char state IDs, the key fits in the small string buffer
+    const std::string_view st = rec.getState();
+    if (st.size() != 2) return;
+
+    Extremes& ex = extremes[std::string(st)];
+    updateExtremes(ex, rec);
+}
+
 std::size_t DataManager::processFromCsv(const std::string& csvPath) 
 {
     stateExtremes_.clear();
     
     CSVBuffer buf;
-    if (!buf.openFile(csvPath)) 
+    if (!buf.openFileParallel(csvPath)) 
     {
         std::ostringstream oss;
         oss << "Failed to open CSV \"" << csvPath << "\"";
@@ -48,21 +123,21 @@ std::size_t DataManager::processFromCsv(const std::string& csvPath)
     }
     
     std::size_t processed = 0;
-    ZipCodeRecord rec;
+    std::vector<ZipCodeRecord> batch;
     
-    // Stream through records
-    while (buf.hasMoreRecords()) 
+    // Stream through records, chunks are parsed on worker threads in file order
+    while (buf.getNextBatch(batch)) 
     {
-        if (buf.getNextRecord(rec)) 
+        for (const ZipCodeRecord& rec : batch)
         {
             processRecord(rec);
-            ++processed;
-        } 
-        else if (buf.hasError()) 
-        {
-            std::cerr << "Parse error on line " << buf.getCurrentLineNumber()
-                      << ": " << buf.getLastError() << "\n";
         }
+        processed += batch.size();
+    }
+    if (buf.hasError()) 
+    {
+        std::cerr << "Parse error on line " << buf.getCurrentLineNumber()
+                  << ": " << buf.getLastError() << "\n";
     }
     
     buf.closeFile();
@@ -174,6 +249,13 @@ std::string DataManager::signatureFromBlockedSequence(const std::string& zcbPath
     return mgr.signature();
 }
 
+std::string DataManager::signatureFromBlockedParallel(const std::string& zcbPath, const unsigned threadCount)
+{
+    DataManager mgr;
+    mgr.processFromBlockedParallel(zcbPath, threadCount);
+    return mgr.signature();
+}
+
 bool DataManager::verifyIdenticalResults(const std::string& fileA,
                                          const std::string& fileB,
                                          const uint8_t fileAType,
@@ -198,6 +280,11 @@ bool DataManager::verifyIdenticalResults(const std::string& fileA,
              sigA = signatureFromBlockedSequence(fileA);
              break;
         }
+        case 3:
+        {
+             sigA = signatureFromBlockedParallel(fileA);
+             break;
+        }
         default:
         {
             std::cerr << "Not a recognized signature." << std::endl;
@@ -222,6 +309,11 @@ bool DataManager::verifyIdenticalResults(const std::string& fileA,
              sigB = signatureFromBlockedSequence(fileB);
              break;
         }
+        case 3:
+        {
+             sigB = signatureFromBlockedParallel(fileB);
+             break;
+        }
         default:
         {
             std::cerr << "Not a recognized signature." << std::endl;
@@ -245,28 +337,44 @@ std::size_t DataManager::processFromBlockedSequence(const std::string& inFile)
     }
 
     BlockBuffer blockBuffer;
-    if (!blockBuffer.openFile(inFile, header.getHeaderSize())) 
+    if (!blockBuffer.openMappedFile(inFile, header.getHeaderSize()) &&
+        !blockBuffer.openFile(inFile, header.getHeaderSize())) 
     {
         throw std::runtime_error("Failed to open blocked file");
     }
 
+    // Read ahead in index order when the index is current, otherwise along the chain
+    BlockIndexFile index;
+    if (!header.getStaleFlag() && index.read(header.getIndexFileName()))
+    {
+        std::vector<uint32_t> order;
+        order.reserve(index.getEntryCount());
+        for (const auto& entry : index.getEntries()) order.push_back(entry.recordRBN);
+        blockBuffer.startReadahead(order, header.getBlockSize(), header.getHeaderSize());
+    }
+    else
+    {
+        blockBuffer.startReadahead(header.getSequenceSetListRBN(), header.getBlockSize(), header.getHeaderSize());
+    }
+
     std::size_t processed = 0;
 
     uint32_t currentRBN = header.getSequenceSetListRBN();
 
      while (currentRBN != 0) 
      {
-        ActiveBlock block = blockBuffer.loadActiveBlockAtRBN(currentRBN, header.getBlockSize(), header.getHeaderSize());
-        
-        // Unpack records from block
-        std::vector<ZipCodeRecord> records;
-        RecordBuffer recBuf;
-        recBuf.unpackBlock(block.data, records);
+        ActiveBlockView block = blockBuffer.viewActiveBlockAtRBN(currentRBN, header.getBlockSize(), header.getHeaderSize());
+        if (block.data == nullptr)
+        {
+            throw std::runtime_error("Failed to read block " + std::to_string(currentRBN));
+        }
         
-        // Process each record
-        for (const auto& rec : records) 
+        // Read records in place from the block bytes
+        BlockRecordIterator it(block.data, block.dataSize);
+        ZipCodeRecordView view;
+        while (it.next(view))
         {
-            processRecord(rec);
+            processRecord(view);
             ++processed;
         }
         
@@ -277,3 +385,97 @@ std::size_t DataManager::processFromBlockedSequence(const std::string& inFile)
     blockBuffer.closeFile();
     return processed;
 }
+
+std::size_t DataManager::processFromBlockedParallel(const std::string& inFile, unsigned threadCount)
+{
+    stateExtremes_.clear();
+
+    HeaderBuffer headerBuffer;
+    HeaderRecord header;
+    if (!headerBuffer.readHeader(inFile, header))
+    {
+        std::cout<< headerBuffer.getLastError() << std::endl;
+        throw std::runtime_error("Failed to read header");
+    }
+
+    const uint32_t blockSize = header.getBlockSize();
+    const size_t headerSize = header.getHeaderSize();
+
+    // Every whole block in the file, active or avail
+    std::ifstream sizeProbe(inFile, std::ios::binary | std::ios::ate);
+    const std::streamoff fileSize = sizeProbe ? static_cast<std::streamoff>(sizeProbe.tellg()) : 0;
+    sizeProbe.close();
+    if (blockSize == 0 || fileSize < static_cast<std::streamoff>(headerSize))
+    {
+        throw std::runtime_error("Failed to open blocked file");
+    }
+    const uint32_t blockCount = static_cast<uint32_t>((fileSize - headerSize) / blockSize);
+
+    if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+    if (threadCount > blockCount) threadCount = blockCount > 0 ? blockCount : 1;
+
+    struct ScanPart
+    {
+        std::unordered_map<std::string, Extremes> extremes;
+        std::size_t processed = 0;
+        std::string error;
+    };
+    std::vector<ScanPart> parts(threadCount);
+
+    // Each thread gets a contiguous RBN range and its own mapping of the file
+    auto scanRange = [&](ScanPart& part, const uint32_t firstRBN, const uint32_t lastRBN)
+    {
+        BlockBuffer blockBuffer;
+        if (!blockBuffer.openMappedFile(inFile, headerSize) &&
+            !blockBuffer.openFile(inFile, headerSize))
+        {
+            part.error = "Failed to open blocked file";
+            return;
+        }
+        ZipCodeRecordView view;
+        for (uint32_t rbn = firstRBN; rbn <= lastRBN; ++rbn)
+        {
+            ActiveBlockView block = blockBuffer.viewActiveBlockAtRBN(rbn, blockSize, headerSize);
+            if (block.data == nullptr)
+            {
+                part.error = "Failed to read block " + std::to_string(rbn);
+                return;
+            }
+            if (block.recordCount == 0) continue; // avail block
+
+            BlockRecordIterator it(block.data, block.dataSize);
+            while (it.next(view))
+            {
+                processRecordInto(part.extremes, view);
+                ++part.processed;
+            }
+        }
+        blockBuffer.closeFile();
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    uint32_t nextRBN = 1;
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        // Spread the remainder over the first ranges
+        const uint32_t length = blockCount / threadCount + (t < blockCount % threadCount ? 1 : 0);
+        if (length == 0) continue;
+        workers.emplace_back(scanRange, std::ref(parts[t]), nextRBN, nextRBN + length - 1);
+        nextRBN += length;
+    }
+    for (auto& worker : workers) worker.join();
+
+    std::size_t processed = 0;
+    for (const auto& part : parts)
+    {
+        if (!part.error.empty()) throw std::runtime_error(part.error);
+        for (const auto& kv : part.extremes)
+        {
+            mergeExtremes(stateExtremes_[kv.first], kv.second);
+        }
+        processed += part.processed;
+    }
+    return processed;
+}
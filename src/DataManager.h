@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <iosfwd>
 #include "ZipCodeRecord.h"
+#include "ZipCodeRecordView.h"
 #include "CSVBuffer.h"
 #include "BlockBuffer.h"
 #include "HeaderBuffer.h"
@@ -51,6 +52,19 @@ public:
 
     std::size_t processFromBlockedSequence(const std::string& inFile);
 
+    /**
+     * @brief Scan every block of a blocked file in physical order on several threads.
+     * @details RBNs 1..blockCount are split into one contiguous range per thread and
+     *          avail blocks are skipped. Each thread keeps its own extremes map and the
+     *          maps are merged at the end. Ties go to the lower zip, so the signature
+     *          matches processFromBlockedSequence.
+     * @param inFile path to .zcb file
+     * @param threadCount number of threads (0 uses every hardware thread)
+     * @return number of records processed
+     * @throws std::runtime_error if the file cannot be opened or a block cannot be read
+     */
+    std::size_t processFromBlockedParallel(const std::string& inFile, unsigned threadCount = 0);
+
     /**
      * @brief Print header + per-state rows to the provided stream.
      * @param os output stream (e.g., std::cout)
@@ -77,6 +91,11 @@ public:
 
     static std::string signatureFromBlockedSequence(const std::string& zcbPath);
 
+    /**
+     * @brief Convenience: parallel physical scan of a blocked file, return signature.
+     */
+    static std::string signatureFromBlockedParallel(const std::string& zcbPath, const unsigned threadCount = 0);
+
     /**
      * @brief Verify identical results when using two differently sorted files.
      * @return true if the signatures match; false otherwise
@@ -101,5 +120,34 @@ private:
      * @param rec ZipCodeRecord being processed
      */
     static void updateExtremes(Extremes& ex, const ZipCodeRecord& rec);
+
+    /**
+     * @brief Process a record read in place from a block
+     * @details Only copies the record when it becomes one of the extremes
+     * @param rec view of the record being processed
+     */
+    void processRecord(const ZipCodeRecordView& rec);
+
+    /**
+     * @brief Updates the extremes for a state from a record view
+     * @param ex the extremes being updated
+     * @param rec view of the record being processed
+     */
+    static void updateExtremes(Extremes& ex, const ZipCodeRecordView& rec);
+
+    /**
+     * @brief Process a record view into a given extremes map
+     * @param extremes the map being updated (one per scan thread)
+     * @param rec view of the record being processed
+     */
+    static void processRecordInto(std::unordered_map<std::string, Extremes>& extremes,
+                                  const ZipCodeRecordView& rec);
+
+    /**
+     * @brief Fold one thread's extremes for a state into another
+     * @param into the extremes being updated
+     * @param from the extremes being merged in
+     */
+    static void mergeExtremes(Extremes& into, const Extremes& from);
 };
 #endif
\ No newline at end of file
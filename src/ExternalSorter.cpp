@@ -0,0 +1,309 @@
+#include "ExternalSorter.h"
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+#include <limits>
+
+ExternalSorter::ExternalSorter()
+    : tempPrefix(), memoryBudget(DEFAULT_MEMORY_BUDGET), arena(), keys(), runFiles(), readers(), heap(),
+      nextKey(0), runsWritten(0), fileCounter(0), recordCount(0), bytesSpilled(0), finished(false), lastError()
+{
+}
+
+ExternalSorter::~ExternalSorter()
+{
+    close();
+}
+
+void ExternalSorter::open(const std::string& inTempPrefix, const size_t inMemoryBudget)
+{
+    close();
+    tempPrefix = inTempPrefix;
+    memoryBudget = inMemoryBudget < MIN_MEMORY_BUDGET ? MIN_MEMORY_BUDGET : inMemoryBudget;
+    nextKey = 0;
+    runsWritten = 0;
+    fileCounter = 0;
+    recordCount = 0;
+    bytesSpilled = 0;
+    finished = false;
+    lastError.clear();
+}
+
+bool ExternalSorter::add(const ZipCodeRecord& record)
+{
+    if (finished)
+    {
+        setError("Record added after finish");
+        return false;
+    }
+
+    const uint32_t size = record.getSerializedSize();
+    const size_t held = arena.size() + keys.size() * sizeof(SortKey);
+    if (!keys.empty() &&
+        (held + size + sizeof(SortKey) > memoryBudget ||
+         arena.size() + size > std::numeric_limits<uint32_t>::max()))
+    {
+        if (!spillRun()) return false;
+    }
+
+    const size_t offset = arena.size();
+    arena.resize(offset + size);
+    record.serializeTo(arena.data() + offset);
+    keys.push_back({record.getZipCode(), static_cast<uint32_t>(offset)});
+    ++recordCount;
+    return true;
+}
+
+bool ExternalSorter::finish()
+{
+    if (finished) return !hasError();
+    finished = true;
+
+    if (runFiles.empty())
+    {
+        // Everything fit, return the records from memory
+        std::stable_sort(keys.begin(), keys.end(),
+                         [](const SortKey& a, const SortKey& b) { return a.zipCode < b.zipCode; });
+        nextKey = 0;
+        return true;
+    }
+
+    if (!keys.empty() && !spillRun()) return false;
+    arena.clear();
+    arena.shrink_to_fit();
+    keys.clear();
+    keys.shrink_to_fit();
+
+    // Merge groups of runs in order until one merge can read them all
+    const size_t fanIn = mergeFanIn();
+    while (runFiles.size() > fanIn)
+    {
+        std::vector<std::string> mergedRuns;
+        for (size_t first = 0; first < runFiles.size(); first += fanIn)
+        {
+            const size_t last = std::min(first + fanIn, runFiles.size());
+            if (last - first == 1)
+            {
+                mergedRuns.push_back(runFiles[first]);
+                continue;
+            }
+            std::string merged;
+            if (!mergeRuns(first, last, merged))
+            {
+                for (const std::string& runFile : mergedRuns) std::remove(runFile.c_str());
+                return false;
+            }
+            mergedRuns.push_back(merged);
+        }
+        runFiles.swap(mergedRuns);
+    }
+
+    return openReaders(0, runFiles.size());
+}
+
+bool ExternalSorter::next(ZipCodeRecord& record)
+{
+    if (!finished || hasError()) return false;
+
+    if (runFiles.empty())
+    {
+        if (nextKey >= keys.size()) return false;
+        const SortKey& key = keys[nextKey++];
+        record = ZipCodeRecord::deserialize(arena.data() + key.offset, arena.size() - key.offset);
+        return true;
+    }
+    return popHead(record);
+}
+
+void ExternalSorter::close()
+{
+    readers.clear();
+    heap.clear();
+    for (const std::string& runFile : runFiles) std::remove(runFile.c_str());
+    runFiles.clear();
+    arena.clear();
+    arena.shrink_to_fit();
+    keys.clear();
+    keys.shrink_to_fit();
+}
+
+uint64_t ExternalSorter::getRecordCount() const
+{
+    return recordCount;
+}
+
+size_t ExternalSorter::getRunCount() const
+{
+    return runsWritten;
+}
+
+uint64_t ExternalSorter::getBytesSpilled() const
+{
+    return bytesSpilled;
+}
+
+bool ExternalSorter::hasError() const
+{
+    return !lastError.empty();
+}
+
+const std::string& ExternalSorter::getLastError() const
+{
+    return lastError;
+}
+
+bool ExternalSorter::spillRun()
+{
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const SortKey& a, const SortKey& b) { return a.zipCode < b.zipCode; });
+
+    const std::string runFile = newRunFile();
+    std::ofstream out(runFile, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        setError("Cannot create run file: " + runFile);
+        return false;
+    }
+    runFiles.push_back(runFile);
+
+    for (const SortKey& key : keys)
+    {
+        const uint8_t* record = arena.data() + key.offset;
+        const size_t size = ZipCodeRecord::SERIALIZED_HEADER_SIZE + ZipCodeRecord::serializedNamesLength(record);
+        out.write(reinterpret_cast<const char*>(record), static_cast<std::streamsize>(size));
+        bytesSpilled += size;
+    }
+    out.close();
+    if (!out)
+    {
+        setError("Failed to write run file: " + runFile);
+        return false;
+    }
+
+    ++runsWritten;
+    arena.clear();
+    keys.clear();
+    return true;
+}
+
+bool ExternalSorter::mergeRuns(const size_t first, const size_t last, std::string& merged)
+{
+    if (!openReaders(first, last)) return false;
+
+    merged = newRunFile();
+    std::ofstream out(merged, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        setError("Cannot create run file: " + merged);
+        return false;
+    }
+
+    std::vector<uint8_t> bytes;
+    ZipCodeRecord record;
+    while (popHead(record))
+    {
+        bytes.resize(record.getSerializedSize());
+        record.serializeTo(bytes.data());
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        bytesSpilled += bytes.size();
+    }
+    out.close();
+    if (!hasError() && !out) setError("Failed to write run file: " + merged);
+    if (hasError())
+    {
+        std::remove(merged.c_str());
+        return false;
+    }
+
+    readers.clear();
+    for (size_t run = first; run < last; ++run) std::remove(runFiles[run].c_str());
+    return true;
+}
+
+bool ExternalSorter::openReaders(const size_t first, const size_t last)
+{
+    readers.clear();
+    heap.clear();
+    for (size_t run = first; run < last; ++run)
+    {
+        std::unique_ptr<RunReader> reader(new RunReader());
+        reader->buffer.resize(RUN_BUFFER_BYTES);
+        reader->file.rdbuf()->pubsetbuf(reader->buffer.data(), static_cast<std::streamsize>(reader->buffer.size()));
+        reader->file.open(runFiles[run], std::ios::binary);
+        if (!reader->file)
+        {
+            setError("Cannot open run file: " + runFiles[run]);
+            return false;
+        }
+
+        const size_t index = readers.size();
+        if (readRecord(*reader, reader->head))
+        {
+            heap.push_back({reader->head.getZipCode(), index});
+        }
+        else if (hasError())
+        {
+            return false;
+        }
+        readers.push_back(std::move(reader));
+    }
+    std::make_heap(heap.begin(), heap.end(), std::greater<HeapEntry>());
+    return true;
+}
+
+bool ExternalSorter::popHead(ZipCodeRecord& record)
+{
+    if (heap.empty()) return false;
+
+    std::pop_heap(heap.begin(), heap.end(), std::greater<HeapEntry>());
+    const size_t run = heap.back().run;
+    heap.pop_back();
+
+    RunReader& reader = *readers[run];
+    record = reader.head;
+    if (readRecord(reader, reader.head))
+    {
+        heap.push_back({reader.head.getZipCode(), run});
+        std::push_heap(heap.begin(), heap.end(), std::greater<HeapEntry>());
+    }
+    return !hasError();
+}
+
+bool ExternalSorter::readRecord(RunReader& reader, ZipCodeRecord& record)
+{
+    std::vector<uint8_t>& bytes = reader.bytes;
+    bytes.resize(ZipCodeRecord::SERIALIZED_HEADER_SIZE);
+    if (!reader.file.read(reinterpret_cast<char*>(bytes.data()), ZipCodeRecord::SERIALIZED_HEADER_SIZE))
+    {
+        if (reader.file.gcount() != 0) setError("Truncated record in run file");
+        return false;
+    }
+
+    const size_t names = ZipCodeRecord::serializedNamesLength(bytes.data());
+    bytes.resize(ZipCodeRecord::SERIALIZED_HEADER_SIZE + names);
+    if (names > 0 &&
+        !reader.file.read(reinterpret_cast<char*>(bytes.data() + ZipCodeRecord::SERIALIZED_HEADER_SIZE),
+                          static_cast<std::streamsize>(names)))
+    {
+        setError("Truncated record in run file");
+        return false;
+    }
+
+    record = ZipCodeRecord::deserialize(bytes.data(), bytes.size());
+    return true;
+}
+
+std::string ExternalSorter::newRunFile()
+{
+    return tempPrefix + ".run" + std::to_string(fileCounter++);
+}
+
+size_t ExternalSorter::mergeFanIn() const
+{
+    return std::max<size_t>(2, memoryBudget / RUN_BUFFER_BYTES);
+}
+
+void ExternalSorter::setError(const std::string& message)
+{
+    lastError = message;
+}
@@ -0,0 +1,206 @@
+#ifndef EXTERNAL_SORTER_H
+#define EXTERNAL_SORTER_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include "ZipCodeRecord.h"
+
+/**
+ * @file ExternalSorter.h
+ * @author Group 2
+ * @brief ExternalSorter class for sorting more records by zip code than fit in memory
+ * @version 0.1
+ * @date 2025-11-19
+ */
+
+/**
+ * @class ExternalSorter
+ * @brief Sorts records by zip code within a memory budget, spilling sorted runs to disk
+ * @details Added records are kept in their binary form (ZipCodeRecord::serialize) in one
+ *          arena, with a (zip, offset) key per record. When the arena and keys pass the
+ *          budget the keys are sorted and the records written in key order to a run file.
+ *          finish() spills the last run and next() then merges all runs with a min heap,
+ *          reading each run through its own buffer. If there are more runs than buffers
+ *          fit in the budget, groups of runs are first merged into longer runs.
+ *          If nothing was spilled the records are returned straight from memory.
+ *
+ *          Run file: records back to back in ZipCodeRecord's binary form, which holds
+ *          its own name lengths. Equal zips come out in the order they were added.
+ *          Run files are named <tempPrefix>.run<N> and removed by close().
+ */
+class ExternalSorter
+{
+public:
+    static const size_t DEFAULT_MEMORY_BUDGET = 64u << 20; // Bytes of records and keys held in memory
+    static const size_t MIN_MEMORY_BUDGET = 256u << 10; // Smaller budgets are raised to this
+    static const size_t RUN_BUFFER_BYTES = 64u << 10; // Read buffer of each run being merged
+
+    /**
+     * @brief Default constructor
+     */
+    ExternalSorter();
+
+    /**
+     * @brief Destructor
+     * @details Removes any run files left
+     */
+    ~ExternalSorter();
+
+    /**
+     * @brief Start a new sort
+     * @param tempPrefix [IN] Path prefix of the run files
+     * @param memoryBudget [IN] Bytes of records held in memory before a run is spilled
+     */
+    void open(const std::string& tempPrefix, const size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    /**
+     * @brief Add a record, spilling a run if the budget is reached
+     * @return False if a run could not be written
+     */
+    bool add(const ZipCodeRecord& record);
+
+    /**
+     * @brief Stop adding and prepare the merge
+     * @return False if a run could not be written or merged
+     */
+    bool finish();
+
+    /**
+     * @brief Next record in zip code order, call after finish()
+     * @param record [OUT] The record
+     * @return False once every record was returned or on a read error (see hasError)
+     */
+    bool next(ZipCodeRecord& record);
+
+    /**
+     * @brief Remove the run files and release memory
+     */
+    void close();
+
+    /**
+     * @brief Records added since open
+     */
+    uint64_t getRecordCount() const;
+
+    /**
+     * @brief Runs written to disk, merge passes not counted
+     */
+    size_t getRunCount() const;
+
+    /**
+     * @brief Bytes written to run files, merge passes included
+     */
+    uint64_t getBytesSpilled() const;
+
+    /**
+     * @brief Checks if the sorter is in an error state
+     */
+    bool hasError() const;
+
+    /**
+     * @brief Get description of last error
+     */
+    const std::string& getLastError() const;
+
+private:
+    /**
+     * @struct SortKey
+     * @brief Position of one record held in memory
+     */
+    struct SortKey
+    {
+        uint32_t zipCode; // Record key
+        uint32_t offset; // Start of the record in the arena
+    };
+
+    /**
+     * @struct RunReader
+     * @brief One run being merged and the record at its head
+     */
+    struct RunReader
+    {
+        std::ifstream file; // Run file
+        std::vector<char> buffer; // Stream buffer
+        std::vector<uint8_t> bytes; // Record being read
+        ZipCodeRecord head; // Smallest record not yet returned
+    };
+
+    /**
+     * @struct HeapEntry
+     * @brief Head of a run in the merge heap
+     */
+    struct HeapEntry
+    {
+        uint32_t zipCode; // Zip of the head record
+        size_t run; // Index into readers, lower runs hold earlier records
+
+        bool operator>(const HeapEntry& other) const
+        {
+            return zipCode != other.zipCode ? zipCode > other.zipCode : run > other.run;
+        }
+    };
+
+    std::string tempPrefix; // Run file prefix
+    size_t memoryBudget; // Bytes held before a spill
+    std::vector<uint8_t> arena; // Records of the current run, binary form
+    std::vector<SortKey> keys; // One per record in arena
+    std::vector<std::string> runFiles; // Runs not yet merged away, in the order written
+    std::vector<std::unique_ptr<RunReader>> readers; // Runs of the final merge
+    std::vector<HeapEntry> heap; // Min heap of run heads
+    size_t nextKey; // Next key returned from memory when nothing was spilled
+    size_t runsWritten; // Runs spilled by add and finish
+    size_t fileCounter; // Suffix of the next run file
+    uint64_t recordCount; // Records added
+    uint64_t bytesSpilled; // Bytes written to run files
+    bool finished; // finish() was called
+    std::string lastError; // Last error message
+
+    /**
+     * @brief Sort the keys and write the arena to a new run file
+     */
+    bool spillRun();
+
+    /**
+     * @brief Merge runs first..last - 1 of runFiles into one new run file
+     * @param merged [OUT] Path of the new run
+     */
+    bool mergeRuns(const size_t first, const size_t last, std::string& merged);
+
+    /**
+     * @brief Open runs for a merge and fill the heap with their heads
+     */
+    bool openReaders(const size_t first, const size_t last);
+
+    /**
+     * @brief Pop the smallest head, refilling the heap from its run
+     * @param record [OUT] The record popped
+     * @return False if the heap is empty or a run could not be read
+     */
+    bool popHead(ZipCodeRecord& record);
+
+    /**
+     * @brief Read the next record of a run
+     * @param reader [IN] Run to read
+     * @param record [OUT] The record
+     * @return False at the end of the run (or on a read error, see hasError)
+     */
+    bool readRecord(RunReader& reader, ZipCodeRecord& record);
+
+    /**
+     * @brief Path of a new run file
+     */
+    std::string newRunFile();
+
+    /**
+     * @brief Runs whose buffers fit in the budget at once, at least 2
+     */
+    size_t mergeFanIn() const;
+
+    void setError(const std::string& message);
+};
+
+#endif // EXTERNAL_SORTER_H
@@ -0,0 +1,296 @@
+#include "FreeSpaceMap.h"
+#include <cstring>
+#include <fstream>
+
+const size_t WORD_BITS = 64;
+
+/**
+ * @brief Index of the lowest set bit, word must not be 0
+ */
+static inline unsigned lowestBit(const uint64_t word)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+    unsigned bit = 0;
+    while (!((word >> bit) & 1)) ++bit;
+    return bit;
+#endif
+}
+
+/**
+ * @brief Index of the highest set bit, word must not be 0
+ */
+static inline unsigned highestBit(const uint64_t word)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(63 - __builtin_clzll(word));
+#else
+    unsigned bit = 63;
+    while (!((word >> bit) & 1)) --bit;
+    return bit;
+#endif
+}
+
+/**
+ * @brief Number of set bits
+ */
+static inline uint32_t countBits(const uint64_t word)
+{
+#if defined(__GNUC__)
+    return static_cast<uint32_t>(__builtin_popcountll(word));
+#else
+    uint32_t count = 0;
+    for (uint64_t w = word; w != 0; w &= w - 1) ++count;
+    return count;
+#endif
+}
+
+FreeSpaceMap::FreeSpaceMap()
+    : words(), blockCount(0), freeCount(0), lowestFreeWord(0), lastError()
+{
+}
+
+std::string FreeSpaceMap::pathFor(const std::string& zcbFilePath)
+{
+    return zcbFilePath + ".fsm";
+}
+
+void FreeSpaceMap::reset(const uint32_t inBlockCount)
+{
+    blockCount = inBlockCount;
+    freeCount = 0;
+    lowestFreeWord = 0;
+    words.assign((blockCount + WORD_BITS - 1) / WORD_BITS, 0);
+}
+
+bool FreeSpaceMap::load(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    char raw[HEADER_SIZE];
+    if (!file || !file.read(raw, HEADER_SIZE) || memcmp(raw, "FSMP", 4) != 0)
+    {
+        setError("Not a free space map: " + filename);
+        return false;
+    }
+
+    uint16_t version = 0;
+    memcpy(&version, raw + 4, sizeof(uint16_t));
+    if (version != VERSION)
+    {
+        setError("Unsupported free space map version " + std::to_string(version));
+        return false;
+    }
+    if (raw[6] != 1)
+    {
+        setError("Free space map was not closed cleanly");
+        return false;
+    }
+
+    uint32_t storedBlocks = 0, storedFree = 0;
+    memcpy(&storedBlocks, raw + 8, sizeof(uint32_t));
+    memcpy(&storedFree, raw + 12, sizeof(uint32_t));
+
+    reset(storedBlocks);
+    if (!words.empty() &&
+        !file.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(uint64_t))))
+    {
+        reset(0);
+        setError("Free space map is truncated");
+        return false;
+    }
+
+    for (const uint64_t word : words) freeCount += countBits(word);
+    const size_t tailBits = blockCount % WORD_BITS;
+    if (freeCount != storedFree || (tailBits != 0 && (words.back() >> tailBits) != 0))
+    {
+        reset(0);
+        setError("Corrupt free space map");
+        return false;
+    }
+    return true;
+}
+
+bool FreeSpaceMap::save(const std::string& filename)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        setError("Cannot create free space map: " + filename);
+        return false;
+    }
+
+    char raw[HEADER_SIZE];
+    std::fill(raw, raw + HEADER_SIZE, '\0');
+    const uint16_t version = VERSION;
+    memcpy(raw, "FSMP", 4);
+    memcpy(raw + 4, &version, sizeof(uint16_t));
+    raw[6] = 1; // clean
+    memcpy(raw + 8, &blockCount, sizeof(uint32_t));
+    memcpy(raw + 12, &freeCount, sizeof(uint32_t));
+
+    file.write(raw, HEADER_SIZE);
+    file.write(reinterpret_cast<const char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(uint64_t)));
+    if (!file.good())
+    {
+        setError("Failed to write free space map");
+        return false;
+    }
+    return true;
+}
+
+bool FreeSpaceMap::markDirty(const std::string& filename)
+{
+    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file)
+    {
+        setError("Cannot open free space map: " + filename);
+        return false;
+    }
+    const char clean = 0;
+    file.seekp(6);
+    file.write(&clean, 1);
+    return file.good();
+}
+
+void FreeSpaceMap::grow(const uint32_t inBlockCount)
+{
+    if (inBlockCount <= blockCount) return;
+    blockCount = inBlockCount;
+    words.resize((blockCount + WORD_BITS - 1) / WORD_BITS, 0);
+}
+
+uint32_t FreeSpaceMap::allocate(const uint32_t nearRBN)
+{
+    if (freeCount == 0) return 0;
+
+    if (nearRBN == 0 || nearRBN > blockCount)
+    {
+        for (size_t w = lowestFreeWord; w < words.size(); ++w)
+        {
+            if (words[w] != 0)
+            {
+                lowestFreeWord = w;
+                const uint32_t rbn = firstFreeIn(w);
+                take(rbn);
+                return rbn;
+            }
+        }
+        return 0;
+    }
+
+    // Search outward a word at a time, the first hit on either side is within a word of the best
+    const size_t home = (nearRBN - 1) / WORD_BITS;
+    uint32_t best = closestFreeIn(home, nearRBN);
+    for (size_t distance = 1; best == 0 && (distance <= home || home + distance < words.size()); ++distance)
+    {
+        const uint32_t left = distance <= home ? closestFreeIn(home - distance, nearRBN) : 0;
+        const uint32_t right = home + distance < words.size() ? closestFreeIn(home + distance, nearRBN) : 0;
+        if (left == 0) best = right;
+        else if (right == 0) best = left;
+        else best = (nearRBN - left <= right - nearRBN) ? left : right;
+    }
+    if (best != 0) take(best);
+    return best;
+}
+
+void FreeSpaceMap::release(const uint32_t rbn)
+{
+    if (rbn == 0 || rbn > blockCount || isFree(rbn)) return;
+    const size_t w = (rbn - 1) / WORD_BITS;
+    words[w] |= uint64_t(1) << ((rbn - 1) % WORD_BITS);
+    ++freeCount;
+    if (w < lowestFreeWord) lowestFreeWord = w;
+}
+
+void FreeSpaceMap::releaseRange(const uint32_t first, const uint32_t last)
+{
+    if (first == 0 || first > last || first > blockCount) return;
+    const uint32_t end = last < blockCount ? last : blockCount;
+
+    uint32_t rbn = first;
+    while (rbn <= end)
+    {
+        const size_t w = (rbn - 1) / WORD_BITS;
+        const unsigned lowBit = (rbn - 1) % WORD_BITS;
+        const uint32_t wordLast = static_cast<uint32_t>((w + 1) * WORD_BITS);
+        const unsigned highBit = (end < wordLast) ? (end - 1) % WORD_BITS : WORD_BITS - 1;
+
+        const uint64_t mask = (highBit == WORD_BITS - 1 ? ~uint64_t(0) : ((uint64_t(1) << (highBit + 1)) - 1))
+                              & (~uint64_t(0) << lowBit);
+        freeCount += countBits(mask & ~words[w]);
+        words[w] |= mask;
+        if (w < lowestFreeWord) lowestFreeWord = w;
+        rbn = static_cast<uint32_t>(w * WORD_BITS + highBit + 2);
+    }
+}
+
+bool FreeSpaceMap::isFree(const uint32_t rbn) const
+{
+    if (rbn == 0 || rbn > blockCount) return false;
+    return (words[(rbn - 1) / WORD_BITS] >> ((rbn - 1) % WORD_BITS)) & 1;
+}
+
+uint32_t FreeSpaceMap::shrinkToFit()
+{
+    while (blockCount > 0 && isFree(blockCount))
+    {
+        take(blockCount);
+        --blockCount;
+    }
+    words.resize((blockCount + WORD_BITS - 1) / WORD_BITS);
+    if (lowestFreeWord > words.size()) lowestFreeWord = words.size();
+    return blockCount;
+}
+
+uint32_t FreeSpaceMap::getBlockCount() const
+{
+    return blockCount;
+}
+
+uint32_t FreeSpaceMap::getFreeCount() const
+{
+    return freeCount;
+}
+
+const std::string& FreeSpaceMap::getLastError() const
+{
+    return lastError;
+}
+
+uint32_t FreeSpaceMap::firstFreeIn(const size_t word) const
+{
+    if (words[word] == 0) return 0;
+    return static_cast<uint32_t>(word * WORD_BITS + lowestBit(words[word]) + 1);
+}
+
+uint32_t FreeSpaceMap::closestFreeIn(const size_t word, const uint32_t nearRBN) const
+{
+    const uint64_t bits = words[word];
+    if (bits == 0) return 0;
+
+    const uint32_t base = static_cast<uint32_t>(word * WORD_BITS) + 1; // RBN of bit 0
+    if (nearRBN < base) return base + lowestBit(bits);
+    if (nearRBN >= base + WORD_BITS) return base + highestBit(bits);
+
+    const unsigned position = nearRBN - base;
+    const uint64_t above = bits & (~uint64_t(0) << position);
+    const uint64_t below = bits & ((uint64_t(1) << position) - 1);
+    if (above == 0) return base + highestBit(below);
+    if (below == 0) return base + lowestBit(above);
+
+    const uint32_t up = base + lowestBit(above);
+    const uint32_t down = base + highestBit(below);
+    return (nearRBN - down <= up - nearRBN) ? down : up;
+}
+
+void FreeSpaceMap::take(const uint32_t rbn)
+{
+    words[(rbn - 1) / WORD_BITS] &= ~(uint64_t(1) << ((rbn - 1) % WORD_BITS));
+    --freeCount;
+}
+
+void FreeSpaceMap::setError(const std::string& message)
+{
+    lastError = message;
+}
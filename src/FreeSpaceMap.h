@@ -0,0 +1,149 @@
+#ifndef FREE_SPACE_MAP_H
+#define FREE_SPACE_MAP_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @file FreeSpaceMap.h
+ * @author Group 2
+ * @brief FreeSpaceMap class for tracking free blocks of a blocked file
+ * @version 0.1
+ * @date 2025-11-13
+ */
+
+/**
+ * @class FreeSpaceMap
+ * @brief One bit per RBN marking the free blocks, kept in memory
+ * @details Replaces the avail list. Allocating and freeing only flip bits, so neither
+ *          reads a block, and allocation can pick the free block closest to a given RBN.
+ *          Ranges are freed a word at a time.
+ *
+ *          Stored in a companion file next to the blocked file:
+ *            magic "FSMP" | version (2) | clean (1) | reserved (1) | blockCount (4)
+ *            freeCount (4) | ceil(blockCount / 64) x uint64 words, bit (rbn - 1) set if free
+ *          The clean byte is cleared while a writer has the map open, a map that was
+ *          not closed cleanly is rejected and must be rebuilt from the blocks.
+ */
+class FreeSpaceMap
+{
+public:
+    static const uint32_t HEADER_SIZE = 16;
+    static const uint16_t VERSION = 1;
+
+    /**
+     * @brief Default constructor
+     */
+    FreeSpaceMap();
+
+    /**
+     * @brief Companion file name used for a blocked file
+     * @param zcbFilePath [IN] Path to the blocked sequence set file
+     * @return zcbFilePath with ".fsm" appended
+     */
+    static std::string pathFor(const std::string& zcbFilePath);
+
+    /**
+     * @brief Start over with every block in use
+     * @param blockCount [IN] Blocks in the file
+     */
+    void reset(const uint32_t blockCount);
+
+    /**
+     * @brief Read a map written by save()
+     * @param filename [IN] Path of the map file
+     * @return False if the file is missing, malformed or was not closed cleanly
+     */
+    bool load(const std::string& filename);
+
+    /**
+     * @brief Write the map and mark it clean
+     * @param filename [IN] Path of the map file
+     * @return True if the whole map was written
+     */
+    bool save(const std::string& filename);
+
+    /**
+     * @brief Clear the clean byte of a saved map before the blocks change
+     * @param filename [IN] Path of the map file
+     * @return True if the file was updated
+     */
+    bool markDirty(const std::string& filename);
+
+    /**
+     * @brief Add blocks at the end of the file, all in use
+     * @param blockCount [IN] New number of blocks, ignored if not larger
+     */
+    void grow(const uint32_t blockCount);
+
+    /**
+     * @brief Take the free block closest to an RBN
+     * @param nearRBN [IN] Preferred position, 0 takes the lowest free block
+     * @return RBN marked in use, 0 if no block is free
+     */
+    uint32_t allocate(const uint32_t nearRBN);
+
+    /**
+     * @brief Mark a block free
+     */
+    void release(const uint32_t rbn);
+
+    /**
+     * @brief Mark RBNs first..last free
+     */
+    void releaseRange(const uint32_t first, const uint32_t last);
+
+    /**
+     * @brief Check if a block is free
+     */
+    bool isFree(const uint32_t rbn) const;
+
+    /**
+     * @brief Drop free blocks from the end of the file
+     * @return New number of blocks
+     */
+    uint32_t shrinkToFit();
+
+    /**
+     * @brief Number of blocks covered by the map
+     */
+    uint32_t getBlockCount() const;
+
+    /**
+     * @brief Number of free blocks
+     */
+    uint32_t getFreeCount() const;
+
+    /**
+     * @brief Get description of last error
+     */
+    const std::string& getLastError() const;
+
+private:
+    std::vector<uint64_t> words; // Bit (rbn - 1) set if the block is free
+    uint32_t blockCount; // Blocks covered
+    uint32_t freeCount; // Bits set
+    size_t lowestFreeWord; // No free bit below this word
+    std::string lastError; // Last error message
+
+    /**
+     * @brief Lowest free RBN in a word, 0 if none
+     */
+    uint32_t firstFreeIn(const size_t word) const;
+
+    /**
+     * @brief Free RBN in a word closest to an RBN, 0 if none
+     */
+    uint32_t closestFreeIn(const size_t word, const uint32_t nearRBN) const;
+
+    /**
+     * @brief Mark a block in use
+     */
+    void take(const uint32_t rbn);
+
+    void setError(const std::string& message);
+};
+
+#endif // FREE_SPACE_MAP_H
@@ -4,7 +4,7 @@
 #include <vector>
 #include <cstring>
 
-HeaderBuffer::HeaderBuffer() : errorState(false), lastError("") {}
+HeaderBuffer::HeaderBuffer() : errorState(false), lastError(""), cachedFile(), cachedHeader() {}
 
 HeaderBuffer::~HeaderBuffer()
 {
@@ -52,22 +52,121 @@ bool HeaderBuffer::readHeader(const std::string& filename, HeaderRecord& header)
 
     // Deserialize header
     header = HeaderRecord::deserialize(buffer.data());
+    cachedHeader = header;
+    cachedFile = filename;
     return true;
 }
 
 bool HeaderBuffer::writeHeader(const std::string& filename, const HeaderRecord& header)
 {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file.is_open()) 
+    auto headerData = header.serialize();
+
+    // Open without truncating, the blocks after the header must survive
+    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+    if (file.is_open())
     {
-        setError("Cannot create file: " + filename);
-        return false;
+        uint32_t existingSize = 0;
+        file.seekg(6);
+        file.read(reinterpret_cast<char*>(&existingSize), sizeof(existingSize));
+        if (file.gcount() == sizeof(existingSize) && existingSize != headerData.size())
+        {
+            setError("Header size of " + filename + " would change, rewrite the file instead");
+            return false;
+        }
+        file.clear();
+        file.seekp(0);
     }
-    
-    auto headerData = header.serialize();
+    else
+    {
+        file.open(filename, std::ios::binary | std::ios::out); // New file
+        if (!file.is_open())
+        {
+            setError("Cannot create file: " + filename);
+            return false;
+        }
+    }
+
     file.write(reinterpret_cast<char*>(headerData.data()), headerData.size());
     file.close();
-    
+    if (file.fail())
+    {
+        setError("Failed to write header to " + filename);
+        return false;
+    }
+
+    cachedHeader = HeaderRecord::deserialize(headerData.data());
+    cachedFile = filename;
+    return true;
+}
+
+bool HeaderBuffer::updateHeader(const std::string& filename, const HeaderRecord& header)
+{
+    if (cachedFile != filename)
+    {
+        HeaderRecord onDisk;
+        if (!readHeader(filename, onDisk))
+            return false;
+    }
+
+    const HeaderFieldOffsets offsets = header.getFieldOffsets();
+    const HeaderFieldOffsets cachedOffsets = cachedHeader.getFieldOffsets();
+    if (std::memcmp(&offsets, &cachedOffsets, sizeof(offsets)) != 0)
+    {
+        setError("Header layout of " + filename + " differs, fields cannot be patched in place");
+        return false;
+    }
+
+    // Both runs are serialized exactly like serialize() does
+    uint8_t counts[2 * sizeof(uint32_t)];
+    const uint32_t recordCount = header.getRecordCount();
+    const uint32_t blockCount = header.getBlockCount();
+    std::memcpy(counts, &recordCount, sizeof(uint32_t));
+    std::memcpy(counts + sizeof(uint32_t), &blockCount, sizeof(uint32_t));
+    const bool countsChanged = recordCount != cachedHeader.getRecordCount() ||
+                               blockCount != cachedHeader.getBlockCount();
+
+    uint8_t lists[2 * sizeof(uint32_t) + 1];
+    const uint32_t availableListRBN = header.getAvailableListRBN();
+    const uint32_t sequenceSetListRBN = header.getSequenceSetListRBN();
+    std::memcpy(lists, &availableListRBN, sizeof(uint32_t));
+    std::memcpy(lists + sizeof(uint32_t), &sequenceSetListRBN, sizeof(uint32_t));
+    lists[2 * sizeof(uint32_t)] = header.getStaleFlag();
+    const bool listsChanged = availableListRBN != cachedHeader.getAvailableListRBN() ||
+                              sequenceSetListRBN != cachedHeader.getSequenceSetListRBN() ||
+                              header.getStaleFlag() != cachedHeader.getStaleFlag();
+
+    if (!countsChanged && !listsChanged)
+        return true;
+
+    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file.is_open())
+    {
+        setError("Cannot open file: " + filename);
+        return false;
+    }
+    if (countsChanged)
+    {
+        file.seekp(static_cast<std::streamoff>(offsets.recordCount));
+        file.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+    }
+    if (listsChanged)
+    {
+        file.seekp(static_cast<std::streamoff>(offsets.availableListRBN));
+        file.write(reinterpret_cast<const char*>(lists), sizeof(lists));
+    }
+    file.close();
+    if (file.fail())
+    {
+        setError("Failed to update header of " + filename);
+        cachedFile.clear(); // Unknown what reached the file, read it again next time
+        return false;
+    }
+
+    cachedHeader.setRecordCount(recordCount);
+    cachedHeader.setBlockCount(blockCount);
+    cachedHeader.setAvailableListRBN(availableListRBN);
+    cachedHeader.setSequenceSetListRBN(sequenceSetListRBN);
+    cachedHeader.setStaleFlag(header.getStaleFlag());
     return true;
 }
 
@@ -39,13 +39,27 @@ public:
      */
     bool readHeader(const std::string& filename, HeaderRecord& header);
     /**
-     * @brief read header
-     * @details Opens file, writes the header, and closes file
+     * @brief write header
+     * @details Opens file, writes the header over the start of the file, and closes file.
+     *          Creates the file if it does not exist. An existing file keeps everything
+     *          after the header, so its header must have the same size.
      * @param filename name of file being written too
      * @param header the header being written
      * @returns true or false depending on if the header was write was successfully or not
      */
     bool writeHeader(const std::string& filename, const HeaderRecord& header);
+    /**
+     * @brief update header fields in place
+     * @details Patches recordCount, blockCount, availableListRBN, sequenceSetListRBN and
+     *          staleFlag where they differ from the cached header (the one last read or
+     *          written for this file, read first if there is none). The two runs of fields
+     *          are contiguous, so an update is at most two small writes. Fails if the
+     *          header's layout differs from the file's, see HeaderRecord::getFieldOffsets.
+     * @param filename name of file being updated
+     * @param header header holding the new field values
+     * @returns true if the changed fields were written
+     */
+    bool updateHeader(const std::string& filename, const HeaderRecord& header);
     
     /**
      * @brief has error
@@ -64,6 +78,8 @@ public:
 private:
     bool errorState;
     std::string lastError;
+    std::string cachedFile; // File the cached header belongs to, empty if none
+    HeaderRecord cachedHeader; // Header as last read from or written to cachedFile
     
     /**
      * @brief set Error
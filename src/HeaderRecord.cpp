@@ -2,6 +2,7 @@
 
 
 HeaderRecord::HeaderRecord()
+    : fillPercent(0), blockReserve(0)
 {
 }
 
@@ -178,6 +179,14 @@ std::vector<uint8_t> HeaderRecord::serialize() const
     // Stale Flag
     data.push_back(staleFlag);
 
+    // Fill settings, only in headers that record them
+    if (fillPercent != 0)
+    {
+        data.push_back(fillPercent);
+        data.insert(data.end(), reinterpret_cast<const uint8_t*>(&blockReserve),
+                    reinterpret_cast<const uint8_t*>(&blockReserve) + sizeof(blockReserve));
+    }
+
     // Calculate Header Size
     uint32_t trueHeaderSize = data.size();
     memcpy(&data[headerSizePos], &trueHeaderSize, sizeof(trueHeaderSize));
@@ -289,9 +298,41 @@ HeaderRecord HeaderRecord::deserialize(const uint8_t* data)
     // Read Has Valid Index File
     header.staleFlag = data[offset++];
 
+    // Read Fill Settings if the header is long enough to hold them
+    header.fillPercent = 0;
+    header.blockReserve = 0;
+    if (offset + sizeof(uint8_t) + sizeof(uint16_t) <= header.headerSize)
+    {
+        header.fillPercent = data[offset++];
+        memcpy(&header.blockReserve, data + offset, sizeof(uint16_t));
+        offset += sizeof(uint16_t);
+    }
+
     return header;
 }
 
+HeaderFieldOffsets HeaderRecord::getFieldOffsets() const
+{
+    // Same order as serialize(): fixed fields up to the index file name
+    size_t offset = 4 + sizeof(version) + sizeof(headerSize) + sizeof(sizeFormatType)
+                  + sizeof(recordSizeIntBytes) + sizeof(uint8_t) + sizeof(blockSize) + sizeof(minBlockSize);
+    offset += sizeof(uint16_t) + indexFileName.length();
+    offset += sizeof(uint16_t) + indexFileSchemaInfo.length();
+
+    HeaderFieldOffsets offsets;
+    offsets.recordCount = offset;
+    offsets.blockCount = offset + sizeof(recordCount);
+    offset = offsets.blockCount + sizeof(blockCount) + sizeof(fieldCount);
+    for (const auto& field : fields)
+        offset += sizeof(uint16_t) + field.name.length() + sizeof(field.type);
+    offset += sizeof(primaryKeyField);
+
+    offsets.availableListRBN = offset;
+    offsets.sequenceSetListRBN = offset + sizeof(availableListRBN);
+    offsets.staleFlag = offsets.sequenceSetListRBN + sizeof(sequenceSetListRBN);
+    return offsets;
+}
+
 // GETTERS
 const char* HeaderRecord::getFileStructureType() const
 {
@@ -373,6 +414,16 @@ uint8_t HeaderRecord::getStaleFlag() const
     return staleFlag;
 }
 
+uint8_t HeaderRecord::getFillPercent() const
+{
+    return fillPercent;
+}
+
+uint16_t HeaderRecord::getBlockReserve() const
+{
+    return blockReserve;
+}
+
 //SETTERS
 void HeaderRecord::setFileStructureType(const char* type)
 {
@@ -463,4 +514,10 @@ void HeaderRecord::addField(const FieldDef& field)
 void HeaderRecord::setStaleFlag(uint8_t isStale)
 {
     this->staleFlag = isStale;
+}
+
+void HeaderRecord::setFillSettings(uint8_t percent, uint16_t reserve)
+{
+    this->fillPercent = percent;
+    this->blockReserve = reserve;
 }
\ No newline at end of file
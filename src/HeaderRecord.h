@@ -23,6 +23,19 @@ struct FieldDef
     uint8_t type;     // 1=int, 2=float, 3=string, etc.
 };
 
+/**
+ * @struct HeaderFieldOffsets
+ * @brief Byte offsets in the serialized header of the fields that change after creation
+ */
+struct HeaderFieldOffsets
+{
+    size_t recordCount; // uint32_t
+    size_t blockCount; // uint32_t, directly after recordCount
+    size_t availableListRBN; // uint32_t
+    size_t sequenceSetListRBN; // uint32_t, directly after availableListRBN
+    size_t staleFlag; // uint8_t, directly after sequenceSetListRBN
+};
+
 /**
  * @class ZipCodeRecord
  * @brief Represents the information in the header of a file
@@ -50,6 +63,13 @@ public:
      * @returns deserialized data in the form of a HeaderRecord
      */
     static HeaderRecord deserialize(const uint8_t* data); // Read from binary format
+    /**
+     * @brief Field Offsets Getter
+     * @details Offsets follow from the variable length parts (index file name, schema info,
+     *          field names), so two headers with the same layout share their offsets
+     * @returns offsets of the fields serialize() writes for this header
+     */
+    HeaderFieldOffsets getFieldOffsets() const;
 
     
     /**
@@ -129,6 +149,19 @@ public:
      * @returns sequenceSetListRBN
      */
     uint32_t getSequenceSetListRBN() const;
+
+    /**
+     * @brief Fill Percent Getter
+     * @returns share of each block filled by bulk loads and reorganizations, 0 if the header does not record it
+     */
+    uint8_t getFillPercent() const;
+
+    /**
+     * @brief Block Reserve Getter
+     * @returns bytes bulk loads and reorganizations leave free in each block
+     */
+    uint16_t getBlockReserve() const;
+
     /**
      * @brief File Structure Type Setter
      * @details sets fileStructureType[4] to type
@@ -228,6 +261,15 @@ public:
      */
     void setSequenceSetListRBN(uint32_t rbn);
 
+    /**
+     * @brief Fill Settings Setter
+     * @details Headers written before these settings existed end at the stale flag and
+     *          read back with fillPercent 0, serialize() only writes them if fillPercent is set
+     * @param percent share of each block filled, 1 to 100
+     * @param reserve bytes left free in each block
+     */
+    void setFillSettings(uint8_t percent, uint16_t reserve);
+
     uint8_t recordSizeIntBytes = 4;   // number of bytes used for each record length indicator
     enum class SizeFormat : uint8_t { ASCII = 0, Binary = 1 };
     SizeFormat sizeFormat = SizeFormat::Binary;  // how numeric sizes are stored
@@ -263,7 +305,9 @@ private:
 
     uint32_t sequenceSetListRBN; // RBN of the sequence set list
    
-    uint8_t staleFlag; // Boolean flag that determines if the index file is valid
+    uint8_t staleFlag; // Set while the index files may not match the blocks, also across an add or del
+    uint8_t fillPercent; // Share of each block filled by bulk loads and reorganizations (0 = not recorded)
+    uint16_t blockReserve; // Bytes left free in each block by bulk loads and reorganizations
 };
 
 #endif
\ No newline at end of file
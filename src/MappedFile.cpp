@@ -0,0 +1,194 @@
+#include "MappedFile.h"
+#include <cstring>
+#include <cerrno>
+
+#if ZCD_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : fd(-1), base(nullptr), mappedSize(0), logicalSize(0), lastError()
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#if ZCD_HAS_MMAP
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+    fd = ::open(filename.c_str(), O_RDWR);
+    if (fd < 0)
+    {
+        setError("Cannot open file: " + filename + " (" + std::strerror(errno) + ")");
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        setError("Cannot stat file: " + filename);
+        close();
+        return false;
+    }
+
+    logicalSize = static_cast<size_t>(st.st_size);
+    mappedSize = logicalSize;
+    if (mappedSize == 0)
+        return true; // Nothing to map yet, reserve() maps on first growth
+
+    void* addr = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        setError("mmap failed for " + filename + " (" + std::strerror(errno) + ")");
+        close();
+        return false;
+    }
+    base = static_cast<char*>(addr);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (base)
+    {
+        munmap(base, mappedSize);
+        base = nullptr;
+    }
+    if (fd >= 0)
+    {
+        // Drop the spare capacity reserve() allocated past the logical end
+        if (mappedSize > logicalSize && ftruncate(fd, static_cast<off_t>(logicalSize)) != 0)
+            setError("Failed to truncate mapped file");
+        ::close(fd);
+        fd = -1;
+    }
+    mappedSize = 0;
+    logicalSize = 0;
+}
+
+bool MappedFile::reserve(const size_t size)
+{
+    if (fd < 0)
+    {
+        setError("File not open");
+        return false;
+    }
+    if (size <= mappedSize)
+    {
+        if (size > logicalSize) logicalSize = size;
+        return true;
+    }
+
+    // Double the capacity so a run of allocations only remaps a few times
+    size_t newSize = (mappedSize * 2 > size) ? mappedSize * 2 : size;
+    if (ftruncate(fd, static_cast<off_t>(newSize)) != 0)
+    {
+        setError(std::string("ftruncate failed (") + std::strerror(errno) + ")");
+        return false;
+    }
+
+    void* addr = MAP_FAILED;
+    if (base == nullptr)
+    {
+        addr = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    else
+    {
+#ifdef MREMAP_MAYMOVE
+        addr = mremap(base, mappedSize, newSize, MREMAP_MAYMOVE);
+#else
+        // The old mapping is gone whether or not the new one succeeds
+        munmap(base, mappedSize);
+        base = nullptr;
+        mappedSize = 0;
+        addr = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#endif
+    }
+
+    if (addr == MAP_FAILED)
+    {
+        // A failed mremap leaves the old mapping in place, earlier views stay valid
+        setError(std::string("Failed to grow mapping (") + std::strerror(errno) + ")");
+        return false;
+    }
+
+    base = static_cast<char*>(addr);
+    mappedSize = newSize;
+    logicalSize = size;
+    return true;
+}
+
+bool MappedFile::sync()
+{
+    if (!base) return true;
+    if (msync(base, mappedSize, MS_SYNC) != 0)
+    {
+        setError(std::string("msync failed (") + std::strerror(errno) + ")");
+        return false;
+    }
+    return true;
+}
+
+#else // !ZCD_HAS_MMAP
+
+bool MappedFile::open(const std::string& filename)
+{
+    setError("Memory mapped files are not supported on this platform: " + filename);
+    return false;
+}
+
+void MappedFile::close()
+{
+}
+
+bool MappedFile::reserve(const size_t size)
+{
+    setError("Memory mapped files are not supported on this platform");
+    return false;
+}
+
+bool MappedFile::sync()
+{
+    return false;
+}
+
+#endif // ZCD_HAS_MMAP
+
+bool MappedFile::isOpen() const
+{
+    return fd >= 0;
+}
+
+char* MappedFile::data()
+{
+    return base;
+}
+
+const char* MappedFile::data() const
+{
+    return base;
+}
+
+size_t MappedFile::size() const
+{
+    return logicalSize;
+}
+
+const std::string& MappedFile::getLastError() const
+{
+    return lastError;
+}
+
+void MappedFile::setError(const std::string& message)
+{
+    lastError = message;
+}
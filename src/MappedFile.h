@@ -0,0 +1,113 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <string>
+
+/**
+ * @file MappedFile.h
+ * @author Group 2
+ * @brief MappedFile class for memory mapping a block file
+ * @version 0.1
+ * @date 2025-11-04
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ZCD_HAS_MMAP 1
+#else
+#define ZCD_HAS_MMAP 0
+#endif
+
+/**
+ * @class MappedFile
+ * @brief Read/write shared memory mapping of a whole file
+ * @details The mapping can be grown past the end of the file. Growth extends the
+ *          file with ftruncate and the mapping with mremap (or unmap + map where
+ *          mremap does not exist), doubling the capacity so appends are amortized.
+ *          The file is truncated back to its logical size on close.
+ *          On platforms without mmap open() always fails so callers can fall back
+ *          to stream I/O.
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief Default constructor
+     */
+    MappedFile();
+
+    /**
+     * @brief Destructor
+     * @details Unmaps and closes the file if still open
+     */
+    ~MappedFile();
+
+    /**
+     * @brief Open and map a file for reading and writing
+     * @param filename [IN] Path to the file
+     * @return True if the file was opened and mapped
+     */
+    bool open(const std::string& filename);
+
+    /**
+     * @brief Unmap and close the file, truncating it to its logical size
+     */
+    void close();
+
+    /**
+     * @brief Check if a file is mapped
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Make sure at least size bytes of the file are mapped
+     * @details Grows the file and mapping if needed. May move the mapping, so any
+     *          pointer obtained from data() before the call is invalid afterwards.
+     *          If the mapping cannot grow, the existing one is kept where mremap is
+     *          available (the file may already be longer)
+     * @param size [IN] Required logical file size in bytes
+     * @return True if the file and mapping are at least size bytes
+     */
+    bool reserve(const size_t size);
+
+    /**
+     * @brief Start of the mapping
+     */
+    char* data();
+
+    /**
+     * @brief Start of the mapping
+     */
+    const char* data() const;
+
+    /**
+     * @brief Logical size of the file in bytes
+     */
+    size_t size() const;
+
+    /**
+     * @brief Write dirty pages back to the file
+     * @return True if msync succeeded
+     */
+    bool sync();
+
+    /**
+     * @brief Get description of last error
+     */
+    const std::string& getLastError() const;
+
+private:
+    int fd; // File descriptor of the mapped file
+    char* base; // Start of the mapping
+    size_t mappedSize; // Bytes currently mapped (and allocated in the file)
+    size_t logicalSize; // Bytes of the file that hold real data
+    std::string lastError; // Last error message
+
+    /**
+     * @brief Set error message
+     */
+    void setError(const std::string& message);
+};
+
+#endif // MAPPED_FILE_H
@@ -1,9 +1,13 @@
 #include "RecordBuffer.h"
 #include "ZipCodeRecord.h"
+#include "ZipCodeRecordView.h"
+#include "RecordTokenizer.h"
 #include <cstring>
 
 
-RecordBuffer::RecordBuffer(){
+RecordBuffer::RecordBuffer()
+    : errorState(false), lastError(), recordFormat(TEXT_RECORDS)
+{
     // :)
 }
 
@@ -12,28 +16,107 @@ RecordBuffer::~RecordBuffer(){
 
 }
 
+void RecordBuffer::setRecordFormat(const uint8_t format)
+{
+    recordFormat = (format == BINARY_RECORDS || format == SLOTTED_RECORDS) ? format : TEXT_RECORDS;
+}
+
+uint8_t RecordBuffer::getRecordFormat() const
+{
+    return recordFormat;
+}
+
+uint32_t RecordBuffer::packedSize(const ZipCodeRecord& record) const
+{
+    if (recordFormat == SLOTTED_RECORDS)
+        return SlottedPage::SLOT_SIZE + record.getSerializedSize();
+    if (recordFormat == BINARY_RECORDS)
+        return sizeof(uint32_t) + record.getSerializedSize();
+    return record.getRecordSize(); // Already includes the prefix
+}
+
+uint32_t RecordBuffer::blockOverhead() const
+{
+    return (recordFormat == SLOTTED_RECORDS) ? SlottedPage::HEADER_SIZE : 0;
+}
+
+std::string RecordBuffer::recordToText(const ZipCodeRecord& record)
+{
+    return std::to_string(record.getZipCode()) + "," +
+           record.getLocationName() + "," +
+           std::string(record.getState()) + "," +
+           record.getCounty() + "," +
+           std::to_string(record.getLatitude()) + "," +
+           std::to_string(record.getLongitude());
+}
+
 bool RecordBuffer::unpackBlock(const std::vector<char>& blockData, std::vector<ZipCodeRecord>& records)
+{
+    return unpackBlock(blockData.data(), blockData.size(), records);
+}
+
+bool RecordBuffer::unpackBlock(const char* blockData, const size_t blockDataSize, std::vector<ZipCodeRecord>& records)
 {
     records.clear();
 
-    if (blockData.empty()) return false;
+    if (blockData == nullptr || blockDataSize == 0) return false;
+
+    if (SlottedPage::isSlotted(blockData, blockDataSize))
+    {
+        uint16_t slotCount;
+        std::memcpy(&slotCount, blockData + 4, sizeof(slotCount));
+        records.reserve(slotCount);
+        for (uint16_t i = 0; i < slotCount; ++i)
+        {
+            const char* slot = blockData + SlottedPage::HEADER_SIZE + i * SlottedPage::SLOT_SIZE;
+            uint16_t recordOffset, recordLength;
+            std::memcpy(&recordOffset, slot + 4, sizeof(recordOffset));
+            std::memcpy(&recordLength, slot + 6, sizeof(recordLength));
+            if (recordOffset + recordLength > blockDataSize)
+            {
+                setError("Slot points past the end of the block. Block Skipped.");
+                return false;
+            }
+            records.push_back(ZipCodeRecord::deserialize(
+                reinterpret_cast<const uint8_t*>(blockData + recordOffset), recordLength));
+        }
+        return true;
+    }
 
     size_t offset = 0;
 
-    while(offset + 4 <= blockData.size())
+    while(offset + 4 <= blockDataSize)
     {
         uint32_t lengthPrefix;
-        std::memcpy(&lengthPrefix, &blockData[offset], sizeof(uint32_t));
+        std::memcpy(&lengthPrefix, blockData + offset, sizeof(uint32_t));
 
         if(blockData[offset] == '\xFF')
             break;
 
         offset += 4;
 
-        if (lengthPrefix == 0 || offset + lengthPrefix  > blockData.size())
+        const bool binary = (lengthPrefix & BINARY_RECORD_FLAG) != 0;
+        lengthPrefix &= ~BINARY_RECORD_FLAG;
+
+        if (lengthPrefix == 0 || offset + lengthPrefix  > blockDataSize)
             break;
 
-        std::string recordStr(blockData.begin() + offset, blockData.begin() + offset + lengthPrefix);
+        if (binary)
+        {
+            // Fixed header plus two names, no text to parse
+            records.push_back(ZipCodeRecord::deserialize(
+                reinterpret_cast<const uint8_t*>(blockData + offset), lengthPrefix));
+            offset += lengthPrefix;
+            if (records.back().getZipCode() == 0)
+            {
+                records.pop_back();
+                setError("Truncated binary ZipCodeRecord within Unpack Block. Block Skipped.");
+                return false;
+            }
+            continue;
+        }
+
+        const std::string_view recordStr(blockData + offset, lengthPrefix);
 
         offset += lengthPrefix;
         
@@ -53,11 +136,37 @@ bool RecordBuffer::packBlock(const std::vector<ZipCodeRecord>& records, std::vec
     blockData.clear();
     if (records.empty()) return false;
 
+    if (recordFormat == SLOTTED_RECORDS)
+        return packSlottedBlock(records, blockData, blockSize);
+
     uint32_t lengthPrefix;
     blockData.reserve(blockSize);
     for(const auto& record : records)
     {
-        lengthPrefix = record.getRecordSize();
+        if (recordFormat == BINARY_RECORDS)
+        {
+            lengthPrefix = record.getSerializedSize();
+
+            size_t totalBlockSize = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t) +
+                                    sizeof(uint32_t) + blockData.size() + lengthPrefix;
+            if (totalBlockSize > blockSize)
+            {
+               setError("Block size exceeded during packing");
+               return false;
+            }
+
+            const uint32_t flaggedPrefix = lengthPrefix | BINARY_RECORD_FLAG;
+            size_t oldSize = blockData.size();
+            blockData.resize(oldSize + sizeof(uint32_t) + lengthPrefix);
+            std::memcpy(&blockData[oldSize], &flaggedPrefix, sizeof(uint32_t));
+            record.serializeTo(reinterpret_cast<uint8_t*>(&blockData[oldSize + sizeof(uint32_t)]));
+            continue;
+        }
+
+        std::string recordStr = recordToText(record);
+
+        // Prefix holds the length of the text only (getRecordSize() includes the prefix itself)
+        lengthPrefix = static_cast<uint32_t>(recordStr.length());
 
         size_t totalBlockSize = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t) + 
                                 sizeof(uint32_t) + blockData.size() + lengthPrefix;            
@@ -72,108 +181,232 @@ bool RecordBuffer::packBlock(const std::vector<ZipCodeRecord>& records, std::vec
         blockData.resize(oldSize + sizeof(uint32_t));
         std::memcpy(&blockData[oldSize], &lengthPrefix, sizeof(uint32_t));
 
-        std::string recordStr = std::to_string(record.getZipCode()) + "," +
-                               record.getLocationName() + "," +
-                               std::string(record.getState()) + "," +
-                               record.getCounty() + "," +
-                               std::to_string(record.getLatitude()) + "," +
-                               std::to_string(record.getLongitude());
-
         blockData.insert(blockData.end(), recordStr.begin(), recordStr.end());
     }
     return true;
 }
 
-bool RecordBuffer::parseZipCodeRecord(const std::string& recordStr, ZipCodeRecord& record)
+bool RecordBuffer::packSlottedBlock(const std::vector<ZipCodeRecord>& records, std::vector<char>& blockData,
+                                    const uint32_t blockSize)
 {
-    std::vector<std::string> fields;
-    std::stringstream ss(recordStr);
-    std::string field;
+    const size_t regionSize = blockSize - (sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t));
+    if (regionSize > UINT16_MAX)
+    {
+        setError("Slotted blocks are limited to 64 KiB");
+        return false;
+    }
 
-    while(std::getline(ss, field, ','))
+    blockData.assign(regionSize, '\xFF');
+    size_t heapStart = regionSize;
+    uint16_t liveBytes = 0;
+    for (size_t i = 0; i < records.size(); ++i)
     {
-        trimString(field);
-        fields.push_back(field);
+        const uint16_t recordLength = static_cast<uint16_t>(records[i].getSerializedSize());
+        const size_t slotEnd = SlottedPage::HEADER_SIZE + (i + 1) * SlottedPage::SLOT_SIZE;
+        if (slotEnd + recordLength > heapStart)
+        {
+            setError("Block size exceeded during packing");
+            return false;
+        }
+
+        heapStart -= recordLength;
+        records[i].serializeTo(reinterpret_cast<uint8_t*>(&blockData[heapStart]));
+        liveBytes += recordLength;
+
+        char* slot = &blockData[slotEnd - SlottedPage::SLOT_SIZE];
+        const uint32_t key = records[i].getZipCode();
+        const uint16_t recordOffset = static_cast<uint16_t>(heapStart);
+        std::memcpy(slot, &key, sizeof(key));
+        std::memcpy(slot + 4, &recordOffset, sizeof(recordOffset));
+        std::memcpy(slot + 6, &recordLength, sizeof(recordLength));
     }
-    return fieldsToRecord(fields, record);
+
+    const uint32_t mark = SlottedPage::MARK;
+    const uint16_t slotCount = static_cast<uint16_t>(records.size());
+    const uint16_t heapStart16 = static_cast<uint16_t>(heapStart);
+    std::memcpy(&blockData[0], &mark, sizeof(mark));
+    std::memcpy(&blockData[4], &slotCount, sizeof(slotCount));
+    std::memcpy(&blockData[6], &heapStart16, sizeof(heapStart16));
+    std::memcpy(&blockData[8], &liveBytes, sizeof(liveBytes));
+    return true;
 }
 
-bool RecordBuffer::fieldsToRecord(const std::vector<std::string>& fields, ZipCodeRecord& record)
+uint16_t RecordBuffer::lowerBoundSlot(const char* blockData, const uint16_t slotCount, const uint32_t zipCode)
 {
-    if (fields.size() != EXPECTED_FIELD_COUNT) 
-        return false;
-    
-    // Validate and convert each field
-    // Field 0: Zip Code (integer)
-    if (!isValidUInt32(fields[0])) 
-    {
-        return false;
-    }
-    uint32_t zipCode = static_cast<uint32_t>(std::stoul(fields[0]));
-    
-    // Field 4: Latitude (double)
-    if (!isValidDouble(fields[4])) 
+    uint16_t low = 0, high = slotCount;
+    while (low < high)
     {
-        return false;
+        const uint16_t mid = low + (high - low) / 2;
+        uint32_t key;
+        std::memcpy(&key, blockData + SlottedPage::HEADER_SIZE + mid * SlottedPage::SLOT_SIZE, sizeof(key));
+        if (key < zipCode)
+            low = mid + 1;
+        else
+            high = mid;
     }
-    double latitude = std::stod(fields[4]);
-    
-    // Field 5: Longitude (double)  
-    if (!isValidDouble(fields[5])) 
+    return low;
+}
+
+bool RecordBuffer::findRecord(const char* blockData, const size_t blockDataSize, const uint32_t zipCode,
+                              ZipCodeRecord& record)
+{
+    if (SlottedPage::isSlotted(blockData, blockDataSize))
     {
-        return false;
+        uint16_t slotCount;
+        std::memcpy(&slotCount, blockData + 4, sizeof(slotCount));
+        const uint16_t i = lowerBoundSlot(blockData, slotCount, zipCode);
+        if (i == slotCount) return false;
+
+        const char* slot = blockData + SlottedPage::HEADER_SIZE + i * SlottedPage::SLOT_SIZE;
+        uint32_t key;
+        uint16_t recordOffset, recordLength;
+        std::memcpy(&key, slot, sizeof(key));
+        std::memcpy(&recordOffset, slot + 4, sizeof(recordOffset));
+        std::memcpy(&recordLength, slot + 6, sizeof(recordLength));
+        if (key != zipCode || recordOffset + recordLength > blockDataSize) return false;
+
+        record = ZipCodeRecord::deserialize(reinterpret_cast<const uint8_t*>(blockData + recordOffset), recordLength);
+        return true;
     }
-    double longitude = std::stod(fields[5]);
-    
-    // Field 1: Place Name (string)
-    std::string placeName = fields[1];
-    
-    // Field 2: State (string, must be 2 chars)
-    std::string state = fields[2];
-    if (state.length() != 2)
+
+    // Scan in place and only copy out the match
+    BlockRecordIterator it(blockData, blockDataSize);
+    ZipCodeRecordView view;
+    while (it.next(view))
     {
-        return false;
+        if (view.getZipCode() == zipCode)
+        {
+            record = view.toRecord();
+            return true;
+        }
     }
-    
-    // Field 3: County (string)
-    std::string county = fields[3];
-    
-    // Create the record
-    ZipCodeRecord tempRecord(zipCode, latitude, longitude, placeName, state, county);
-    record = tempRecord;
-    
-    return true;
+    return false;
 }
 
-bool RecordBuffer::isValidUInt32(const std::string& str) const
+bool RecordBuffer::insertSlottedRecord(std::vector<char>& blockData, const ZipCodeRecord& record)
 {
-    if (str.empty()) return false;
-    
-    try 
+    if (!SlottedPage::isSlotted(blockData.data(), blockData.size())) return false;
+
+    uint16_t slotCount, heapStart, liveBytes;
+    std::memcpy(&slotCount, &blockData[4], sizeof(slotCount));
+    std::memcpy(&heapStart, &blockData[6], sizeof(heapStart));
+    std::memcpy(&liveBytes, &blockData[8], sizeof(liveBytes));
+
+    const uint32_t key = record.getZipCode();
+    const uint16_t i = lowerBoundSlot(blockData.data(), slotCount, key);
+    if (i < slotCount)
     {
-        long val = std::stol(str);
-        if (val < 0 || val > 4294967295) return false;
-        return true;
-    } 
-    catch (const std::exception&) 
+        uint32_t existing;
+        std::memcpy(&existing, &blockData[SlottedPage::HEADER_SIZE + i * SlottedPage::SLOT_SIZE], sizeof(existing));
+        if (existing == key) return false;
+    }
+
+    const uint16_t recordLength = static_cast<uint16_t>(record.getSerializedSize());
+    const size_t slotEnd = SlottedPage::HEADER_SIZE + (slotCount + 1) * SlottedPage::SLOT_SIZE;
+    if (slotEnd + liveBytes + recordLength > blockData.size()) return false;
+    if (slotEnd + recordLength > heapStart)
     {
-        return false;
+        compactSlottedBlock(blockData);
+        std::memcpy(&heapStart, &blockData[6], sizeof(heapStart));
     }
+
+    // Record below the heap, then open a gap in the slot array for it
+    heapStart = static_cast<uint16_t>(heapStart - recordLength);
+    record.serializeTo(reinterpret_cast<uint8_t*>(&blockData[heapStart]));
+
+    char* slot = &blockData[SlottedPage::HEADER_SIZE + i * SlottedPage::SLOT_SIZE];
+    std::memmove(slot + SlottedPage::SLOT_SIZE, slot, (slotCount - i) * SlottedPage::SLOT_SIZE);
+    std::memcpy(slot, &key, sizeof(key));
+    std::memcpy(slot + 4, &heapStart, sizeof(heapStart));
+    std::memcpy(slot + 6, &recordLength, sizeof(recordLength));
+
+    ++slotCount;
+    liveBytes = static_cast<uint16_t>(liveBytes + recordLength);
+    std::memcpy(&blockData[4], &slotCount, sizeof(slotCount));
+    std::memcpy(&blockData[6], &heapStart, sizeof(heapStart));
+    std::memcpy(&blockData[8], &liveBytes, sizeof(liveBytes));
+    return true;
 }
 
-bool RecordBuffer::isValidDouble(const std::string& str) const
+bool RecordBuffer::removeSlottedRecord(std::vector<char>& blockData, const uint32_t zipCode)
 {
-    if (str.empty()) return false;
-    
-    try 
-    {
-        std::stod(str);
-        return true;
-    } 
-    catch (const std::exception&) 
+    if (!SlottedPage::isSlotted(blockData.data(), blockData.size())) return false;
+
+    uint16_t slotCount, heapStart, liveBytes;
+    std::memcpy(&slotCount, &blockData[4], sizeof(slotCount));
+    std::memcpy(&heapStart, &blockData[6], sizeof(heapStart));
+    std::memcpy(&liveBytes, &blockData[8], sizeof(liveBytes));
+
+    const uint16_t i = lowerBoundSlot(blockData.data(), slotCount, zipCode);
+    if (i == slotCount) return false;
+
+    char* slot = &blockData[SlottedPage::HEADER_SIZE + i * SlottedPage::SLOT_SIZE];
+    uint32_t key;
+    uint16_t recordOffset, recordLength;
+    std::memcpy(&key, slot, sizeof(key));
+    std::memcpy(&recordOffset, slot + 4, sizeof(recordOffset));
+    std::memcpy(&recordLength, slot + 6, sizeof(recordLength));
+    if (key != zipCode) return false;
+
+    std::memmove(slot, slot + SlottedPage::SLOT_SIZE, (slotCount - i - 1) * SlottedPage::SLOT_SIZE);
+
+    // The lowest record can be given back to the free space at once, others stay as holes
+    if (recordOffset == heapStart)
+        heapStart = static_cast<uint16_t>(heapStart + recordLength);
+
+    --slotCount;
+    liveBytes = static_cast<uint16_t>(liveBytes - recordLength);
+    std::memcpy(&blockData[4], &slotCount, sizeof(slotCount));
+    std::memcpy(&blockData[6], &heapStart, sizeof(heapStart));
+    std::memcpy(&blockData[8], &liveBytes, sizeof(liveBytes));
+    return true;
+}
+
+void RecordBuffer::compactSlottedBlock(std::vector<char>& blockData)
+{
+    uint16_t slotCount;
+    std::memcpy(&slotCount, &blockData[4], sizeof(slotCount));
+
+    std::vector<char> heap(blockData.size());
+    size_t heapStart = blockData.size();
+    for (uint16_t i = 0; i < slotCount; ++i)
     {
-        return false;
+        char* slot = &blockData[SlottedPage::HEADER_SIZE + i * SlottedPage::SLOT_SIZE];
+        uint16_t recordOffset, recordLength;
+        std::memcpy(&recordOffset, slot + 4, sizeof(recordOffset));
+        std::memcpy(&recordLength, slot + 6, sizeof(recordLength));
+
+        heapStart -= recordLength;
+        std::memcpy(&heap[heapStart], &blockData[recordOffset], recordLength);
+        recordOffset = static_cast<uint16_t>(heapStart);
+        std::memcpy(slot + 4, &recordOffset, sizeof(recordOffset));
     }
+
+    std::memcpy(&blockData[heapStart], &heap[heapStart], blockData.size() - heapStart);
+    const uint16_t heapStart16 = static_cast<uint16_t>(heapStart);
+    std::memcpy(&blockData[6], &heapStart16, sizeof(heapStart16));
+}
+
+uint32_t RecordBuffer::slottedHighKey(const std::vector<char>& blockData)
+{
+    const uint16_t slotCount = slottedCount(blockData);
+    if (slotCount == 0) return 0;
+    uint32_t key;
+    std::memcpy(&key, &blockData[SlottedPage::HEADER_SIZE + (slotCount - 1) * SlottedPage::SLOT_SIZE], sizeof(key));
+    return key;
+}
+
+uint16_t RecordBuffer::slottedCount(const std::vector<char>& blockData)
+{
+    if (!SlottedPage::isSlotted(blockData.data(), blockData.size())) return 0;
+    uint16_t slotCount;
+    std::memcpy(&slotCount, &blockData[4], sizeof(slotCount));
+    return slotCount;
+}
+
+bool RecordBuffer::parseZipCodeRecord(const std::string_view recordStr, ZipCodeRecord& record)
+{
+    return RecordTokenizer::parseRecord(recordStr, record);
 }
 
 bool RecordBuffer::hasError() const
@@ -187,21 +420,6 @@ void RecordBuffer::setError(const std::string& message)
     lastError = message;
 }
 
-void RecordBuffer::trimString(std::string& str)
-{
-    // Remove leading whitespace
-    str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](unsigned char ch) 
-    {
-        return !std::isspace(ch);
-    }));
-    
-    // Remove trailing whitespace  
-    str.erase(std::find_if(str.rbegin(), str.rend(), [](unsigned char ch) 
-    {
-        return !std::isspace(ch);
-    }).base(), str.end());
-}
-
 std::string RecordBuffer::getLastError() const
 {
     return lastError;
@@ -5,6 +5,7 @@
 #include "Block.h"
 #include "ZipCodeRecord.h"
 #include <vector>
+#include <string_view>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
@@ -14,6 +15,12 @@ class RecordBuffer
 public:
     static const int EXPECTED_FIELD_COUNT = 6;
     static const char* const EXPECTED_HEADERS[EXPECTED_FIELD_COUNT];
+
+    // Record formats inside a block, stored in the header's sizeFormatType
+    static const uint8_t TEXT_RECORDS = 0; // [length][zip,place,state,county,lat,lon]
+    static const uint8_t BINARY_RECORDS = 1; // [length | BINARY_RECORD_FLAG][ZipCodeRecord::serialize()]
+    static const uint8_t SLOTTED_RECORDS = 2; // SlottedPage: sorted key/offset slots, binary records
+    static const uint32_t BINARY_RECORD_FLAG = 0x80000000u; // Length prefix bit marking a binary record
     /**
      * @brief Default constructor
      */
@@ -24,6 +31,72 @@ public:
      */
     ~RecordBuffer();
 
+    /**
+     * @brief Select the format packBlock writes
+     * @details unpackBlock reads both formats regardless, the length prefix says which one
+     *          each record uses
+     * @param format [IN] TEXT_RECORDS, BINARY_RECORDS or SLOTTED_RECORDS
+     */
+    void setRecordFormat(const uint8_t format);
+
+    /**
+     * @brief Format packBlock writes
+     */
+    uint8_t getRecordFormat() const;
+
+    /**
+     * @brief Bytes a record takes in a block in the current format, length prefix included
+     */
+    uint32_t packedSize(const ZipCodeRecord& record) const;
+
+    /**
+     * @brief Bytes of a block's data region used by the format itself (the slotted page header)
+     */
+    uint32_t blockOverhead() const;
+
+    /**
+     * @brief Find one record in a block
+     * @details Slotted blocks binary search the slots and decode only the match, other
+     *          blocks are unpacked and scanned
+     * @param blockData [IN] Start of the block data region
+     * @param blockDataSize [IN] Number of bytes in the data region
+     * @param zipCode [IN] Key to find
+     * @param record [OUT] Matching record
+     * @return True if the key is in the block
+     */
+    bool findRecord(const char* blockData, const size_t blockDataSize, const uint32_t zipCode,
+                    ZipCodeRecord& record);
+
+    /**
+     * @brief Insert a record into a slotted block in place
+     * @details Only the slots after the new key move. The record goes below the heap,
+     *          the heap is compacted first if removals left the room in holes.
+     * @param blockData [IN,OUT] Slotted data region
+     * @param record [IN] Record to insert
+     * @return False if the block is not slotted, the key is present or the record does not fit
+     */
+    bool insertSlottedRecord(std::vector<char>& blockData, const ZipCodeRecord& record);
+
+    /**
+     * @brief Remove a record from a slotted block in place
+     * @details Only the slots after the key move, the record's bytes become a hole
+     * @param blockData [IN,OUT] Slotted data region
+     * @param zipCode [IN] Key to remove
+     * @return False if the block is not slotted or the key is not in it
+     */
+    bool removeSlottedRecord(std::vector<char>& blockData, const uint32_t zipCode);
+
+    /**
+     * @brief Highest key in a slotted block
+     * @return Key of the last slot, 0 if the block is empty
+     */
+    static uint32_t slottedHighKey(const std::vector<char>& blockData);
+
+    /**
+     * @brief Number of records in a slotted block
+     */
+    static uint16_t slottedCount(const std::vector<char>& blockData);
+
     /**
      * @brief Unpack block data into ZipCodeRecords
      * @param blockData [IN] Raw block data
@@ -32,6 +105,15 @@ public:
      */
     bool unpackBlock(const std::vector<char>& blockData, std::vector<ZipCodeRecord>& records);
 
+    /**
+     * @brief Unpack raw block bytes into ZipCodeRecords without copying the block first
+     * @param blockData [IN] Start of the block data region
+     * @param blockDataSize [IN] Number of bytes in the data region
+     * @param records [OUT] Vector to populate with unpacked records
+     * @return True if unpacking was successful
+     */
+    bool unpackBlock(const char* blockData, const size_t blockDataSize, std::vector<ZipCodeRecord>& records);
+
     /**
      * @brief Pack ZipCodeRecords into block data
      * @param records [IN] Vector of ZipCodeRecords to pack
@@ -58,48 +140,39 @@ public:
      * @param record The incoming record object to be modified
      * @return True if parsing was successful
      */
-    bool parseZipCodeRecord(const std::string& recordStr, ZipCodeRecord& record);
+    bool parseZipCodeRecord(const std::string_view recordStr, ZipCodeRecord& record);
 
 private:
     bool errorState; // Has the RecordBuffer encountered a critical error
     std::string lastError; // Last error message thrown by the error record
+    uint8_t recordFormat; // Format packBlock writes
 
     /**
-     * @brief Convert string fields
-     * @param fields [IN] Vector of string fields from data file
-     * @param record [OUT] ZipCodeRecord to populate
-     * @return true if conversion successful
-     * @pre fields must contain exactly 6 valid elements
-     * @post record is populated with converted data
+     * @brief Text form of a record as stored in TEXT_RECORDS blocks
      */
-     bool fieldsToRecord(const std::vector<std::string>& fields, ZipCodeRecord& record);
-        
-     /**
-     * @brief Validate that a string represents a valid integer
-     * @param str [IN] String to validate
-     * @return true if string is a valid integer
+    static std::string recordToText(const ZipCodeRecord& record);
+
+    /**
+     * @brief Lay records out as a slotted page filling the whole data region
      */
-     bool isValidUInt32(const std::string& str) const;
-        
+    bool packSlottedBlock(const std::vector<ZipCodeRecord>& records, std::vector<char>& blockData,
+                          const uint32_t blockSize);
+
     /**
-     * @brief Validate that a string represents a valid double
-     * @param str [IN] String to validate  
-     * @return true if string is a valid double
+     * @brief Index of the first slot whose key is not below zipCode
      */
-     bool isValidDouble(const std::string& str) const;
+    static uint16_t lowerBoundSlot(const char* blockData, const uint16_t slotCount, const uint32_t zipCode);
 
     /**
-     * @brief Set error state and message
-     * @param message [IN] Error message to set
+     * @brief Move live records to the end of the region, removing holes
      */
-     void setError(const std::string& message);
+    static void compactSlottedBlock(std::vector<char>& blockData);
 
     /**
-     * @brief Trim whitespace from string
-     * @param str [IN,OUT] String to trim
-     * @details Removes leading and trailing whitespace
+     * @brief Set error state and message
+     * @param message [IN] Error message to set
      */
-    void trimString(std::string& str);
+     void setError(const std::string& message);
 };
 
 #endif // RECORD_BUFFER_H
\ No newline at end of file
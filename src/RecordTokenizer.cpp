@@ -0,0 +1,222 @@
+#include "RecordTokenizer.h"
+#include "ZipCodeRecord.h"
+#include <cctype>
+#include <charconv>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ZCD_TOKENIZER_STEP 32
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ZCD_TOKENIZER_STEP 16
+#else
+#define ZCD_TOKENIZER_STEP 0
+#endif
+
+#if ZCD_TOKENIZER_STEP
+
+/**
+ * @brief Bit i set if p[i] is a comma, quote or newline, ZCD_TOKENIZER_STEP bytes
+ */
+static inline uint32_t delimiterMask(const char* p)
+{
+#if ZCD_TOKENIZER_STEP == 32
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hits = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(',')),
+                        _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"'))),
+        _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+#else
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(',')),
+                     _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'))),
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+    return static_cast<uint32_t>(_mm_movemask_epi8(hits));
+#endif
+}
+
+/**
+ * @brief Index of the lowest set bit, mask must not be 0
+ */
+static inline unsigned lowestBit(const uint32_t mask)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned bit = 0;
+    while (!((mask >> bit) & 1)) ++bit;
+    return bit;
+#endif
+}
+
+#endif // ZCD_TOKENIZER_STEP
+
+/**
+ * @brief Drop surrounding whitespace, then the quotes of a quoted field
+ */
+static inline std::string_view cleanField(std::string_view field)
+{
+    while (!field.empty() && std::isspace(static_cast<unsigned char>(field.front()))) field.remove_prefix(1);
+    while (!field.empty() && std::isspace(static_cast<unsigned char>(field.back()))) field.remove_suffix(1);
+    if (field.size() >= 2 && field.front() == '"' && field.back() == '"')
+    {
+        field.remove_prefix(1);
+        field.remove_suffix(1);
+    }
+    return field;
+}
+
+/**
+ * @class FieldSplitter
+ * @brief State of one splitRecord call
+ */
+class FieldSplitter
+{
+public:
+    FieldSplitter(const char* inBase, std::string_view* inFields, const size_t inMaxFields)
+        : base(inBase), fields(inFields), maxFields(inMaxFields), fieldCount(0), fieldStart(0), inQuotes(false)
+    {
+    }
+
+    /**
+     * @brief Handle the delimiter at pos
+     * @return True if it ended the record
+     */
+    bool delimiter(const size_t pos)
+    {
+        const char c = base[pos];
+        if (c == '"')
+        {
+            inQuotes = !inQuotes;
+            return false;
+        }
+        if (inQuotes) return false;
+        if (c == '\n')
+        {
+            endRecord(pos);
+            return true;
+        }
+        endField(pos);
+        return false;
+    }
+
+    /**
+     * @brief Close the last field, which ends at pos
+     * @details Like splitting with std::getline, a trailing comma does not start an empty field
+     */
+    void endRecord(const size_t pos)
+    {
+        if (pos > fieldStart || fieldCount == 0) endField(pos);
+    }
+
+    /**
+     * @brief Close the field running up to pos
+     */
+    void endField(const size_t pos)
+    {
+        if (fieldCount < maxFields)
+            fields[fieldCount] = cleanField(std::string_view(base + fieldStart, pos - fieldStart));
+        ++fieldCount;
+        fieldStart = pos + 1;
+    }
+
+    size_t count() const
+    {
+        return fieldCount;
+    }
+
+private:
+    const char* base; // Start of the text
+    std::string_view* fields; // Output views
+    size_t maxFields; // Room at fields
+    size_t fieldCount; // Fields closed so far
+    size_t fieldStart; // Offset of the open field
+    bool inQuotes; // Inside a quoted field
+};
+
+size_t RecordTokenizer::splitRecord(const std::string_view text, std::string_view* fields,
+                                    const size_t maxFields, size_t& fieldCount)
+{
+    const char* const base = text.data();
+    const size_t size = text.size();
+    FieldSplitter splitter(base, fields, maxFields);
+
+    size_t i = 0;
+#if ZCD_TOKENIZER_STEP
+    for (; i + ZCD_TOKENIZER_STEP <= size; i += ZCD_TOKENIZER_STEP)
+    {
+        uint32_t mask = delimiterMask(base + i);
+        while (mask != 0)
+        {
+            const size_t pos = i + lowestBit(mask);
+            mask &= mask - 1;
+            if (splitter.delimiter(pos))
+            {
+                fieldCount = splitter.count();
+                return pos + 1;
+            }
+        }
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        const char c = base[i];
+        if ((c == ',' || c == '"' || c == '\n') && splitter.delimiter(i))
+        {
+            fieldCount = splitter.count();
+            return i + 1;
+        }
+    }
+
+    splitter.endRecord(size);
+    fieldCount = splitter.count();
+    return size;
+}
+
+bool RecordTokenizer::parseUInt32(const std::string_view field, uint32_t& value)
+{
+    const char* const end = field.data() + field.size();
+    const std::from_chars_result result = std::from_chars(field.data(), end, value);
+    return !field.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+bool RecordTokenizer::parseDouble(const std::string_view field, double& value)
+{
+    // from_chars takes no leading '+', skip it like strtod would
+    std::string_view digits = field;
+    if (!digits.empty() && digits.front() == '+') digits.remove_prefix(1);
+    const char* const end = digits.data() + digits.size();
+    const std::from_chars_result result = std::from_chars(digits.data(), end, value);
+    return !digits.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+bool RecordTokenizer::fieldsToRecord(const std::string_view* fields, ZipCodeRecord& record)
+{
+    uint32_t zipCode = 0;
+    double latitude = 0.0;
+    double longitude = 0.0;
+    if (!parseUInt32(fields[0], zipCode) ||
+        !parseDouble(fields[4], latitude) ||
+        !parseDouble(fields[5], longitude) ||
+        fields[2].size() != 2)
+    {
+        return false;
+    }
+
+    record = ZipCodeRecord(static_cast<int>(zipCode), latitude, longitude, std::string(fields[1]),
+                           std::string(fields[2]), std::string(fields[3]));
+    // The constructor leaves a zip or coordinate its setters refuse at 0, such a line is no record
+    return zipCode != 0 && record.getZipCode() == zipCode &&
+           record.getLatitude() == latitude && record.getLongitude() == longitude;
+}
+
+bool RecordTokenizer::parseRecord(const std::string_view line, ZipCodeRecord& record)
+{
+    std::string_view fields[FIELD_COUNT];
+    size_t fieldCount = 0;
+    const size_t used = splitRecord(line, fields, FIELD_COUNT, fieldCount);
+    return used == line.size() && fieldCount == FIELD_COUNT && fieldsToRecord(fields, record);
+}
@@ -0,0 +1,75 @@
+#ifndef RECORD_TOKENIZER_H
+#define RECORD_TOKENIZER_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <string_view>
+
+class ZipCodeRecord;
+
+/**
+ * @file RecordTokenizer.h
+ * @author Group 2
+ * @brief RecordTokenizer class for splitting record text into fields in place
+ * @version 0.1
+ * @date 2025-11-18
+ */
+
+/**
+ * @class RecordTokenizer
+ * @brief Allocation free tokenizer shared by every parser of record text
+ * @details Commas, quotes and newlines are found 32 bytes at a time with AVX2 or 16
+ *          with SSE2 when the build targets them, byte by byte otherwise. Fields are
+ *          string_views into the source text, trimmed of whitespace. A quoted field may
+ *          hold commas and newlines, its outer quotes are dropped ("" is left as is).
+ *          Numbers are parsed with std::from_chars, a field must be a number in full.
+ */
+class RecordTokenizer
+{
+public:
+    static const size_t FIELD_COUNT = 6; // zip, place, state, county, latitude, longitude
+
+    /**
+     * @brief Split the record at the start of text into fields
+     * @details Stops after the first newline outside quotes or at the end of text
+     * @param text [IN] Record text, more records may follow
+     * @param fields [OUT] The first maxFields fields
+     * @param maxFields [IN] Room at fields
+     * @param fieldCount [OUT] Fields in the record, may exceed maxFields
+     * @return Bytes consumed, including the newline
+     */
+    static size_t splitRecord(const std::string_view text, std::string_view* fields,
+                              const size_t maxFields, size_t& fieldCount);
+
+    /**
+     * @brief Parse a whole field as an unsigned 32 bit number
+     * @return False if the field is empty, holds anything but digits or overflows
+     */
+    static bool parseUInt32(const std::string_view field, uint32_t& value);
+
+    /**
+     * @brief Parse a whole field as a decimal number
+     * @return False if the field is empty or not a number in full
+     */
+    static bool parseDouble(const std::string_view field, double& value);
+
+    /**
+     * @brief Convert the six fields of a record
+     * @details The zip must be a valid zip code (1 to 99999), the coordinates numbers in range
+     *          and the state two characters
+     * @param fields [IN] zip, place, state, county, latitude, longitude
+     * @param record [OUT] Populated on success
+     * @return True if every field is valid
+     */
+    static bool fieldsToRecord(const std::string_view* fields, ZipCodeRecord& record);
+
+    /**
+     * @brief Parse one line of record text, e.g. "501,Holtsville,NY,Suffolk,40.8154,-73.0451"
+     * @param line [IN] Record text, a trailing newline is allowed
+     * @param record [OUT] Populated on success
+     * @return True if the line holds exactly six valid fields
+     */
+    static bool parseRecord(const std::string_view line, ZipCodeRecord& record);
+};
+
+#endif // RECORD_TOKENIZER_H
@@ -0,0 +1,514 @@
+#include "WriteAheadLog.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#if ZCD_HAS_MMAP
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const size_t GROUP_HEADER_SIZE = 4 + sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint32_t);
+const size_t GROUP_TRAILER_SIZE = 4 + sizeof(uint32_t);
+
+/**
+ * @brief FNV-1a over a byte range, enough to spot a torn or stale group
+ */
+static uint32_t checksumOf(const char* data, const size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+WriteAheadLog::WriteAheadLog()
+    : logFd(-1), dataFd(-1), blockSize(0), headerSize(0), groupSize(DEFAULT_GROUP_SIZE), operations(0),
+      staged(), committed(), checkpointer(), walLock(), checkpointWake(), checkpointDone(),
+      stopping(false), checkpointRequested(false), checkpointFailed(false),
+      committedSequence(0), appliedSequence(0), logBytes(0),
+      blocksRecovered(0), commits(0), blocksLogged(0), checkpoints(0), lastError()
+{
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    stopCheckpointer();
+    closeFiles();
+}
+
+std::string WriteAheadLog::pathFor(const std::string& zcbFilePath)
+{
+    return zcbFilePath + ".wal";
+}
+
+#if ZCD_HAS_MMAP
+
+// pwrite until every byte is written
+static bool writeFully(const int fd, const char* data, size_t size, off_t offset)
+{
+    while (size > 0)
+    {
+        const ssize_t written = pwrite(fd, data, size, offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return true;
+}
+
+// pread until every byte is read, false at end of file
+static bool readFully(const int fd, char* data, size_t size, off_t offset)
+{
+    while (size > 0)
+    {
+        const ssize_t got = pread(fd, data, size, offset);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= static_cast<size_t>(got);
+        offset += got;
+    }
+    return true;
+}
+
+bool WriteAheadLog::open(const std::string& dataFile, const uint32_t inBlockSize, const size_t inHeaderSize,
+                         const size_t inGroupSize)
+{
+    if (isOpen()) close();
+
+    if (inBlockSize == 0)
+    {
+        setError("Block size must be positive");
+        return false;
+    }
+    dataFd = ::open(dataFile.c_str(), O_RDWR);
+    if (dataFd < 0)
+    {
+        setError("Cannot open file: " + dataFile + " (" + std::strerror(errno) + ")");
+        return false;
+    }
+    const std::string logFile = pathFor(dataFile);
+    logFd = ::open(logFile.c_str(), O_RDWR | O_CREAT, 0644);
+    if (logFd < 0)
+    {
+        setError("Cannot open write-ahead log: " + logFile + " (" + std::strerror(errno) + ")");
+        closeFiles();
+        return false;
+    }
+    // Held until close, the lock is what tells a live log from one left by a crash
+    if (flock(logFd, LOCK_EX | LOCK_NB) != 0)
+    {
+        setError("Write-ahead log is in use by another process: " + logFile);
+        closeFiles();
+        return false;
+    }
+
+    blockSize = inBlockSize;
+    headerSize = inHeaderSize;
+    groupSize = inGroupSize > 0 ? inGroupSize : 1;
+    operations = 0;
+    staged.clear();
+    committed.clear();
+    stopping = false;
+    checkpointRequested = false;
+    checkpointFailed = false;
+    committedSequence = 0;
+    appliedSequence = 0;
+    logBytes = 0;
+    blocksRecovered = 0;
+    commits = 0;
+    blocksLogged = 0;
+    checkpoints = 0;
+
+    if (!replay())
+    {
+        closeFiles();
+        return false;
+    }
+    checkpointer = std::thread(&WriteAheadLog::runCheckpointer, this);
+    return true;
+}
+
+bool WriteAheadLog::replay()
+{
+    struct stat st;
+    if (fstat(logFd, &st) != 0)
+    {
+        setError("Cannot stat write-ahead log");
+        return false;
+    }
+    const uint64_t logSize = static_cast<uint64_t>(st.st_size);
+
+    uint64_t offset = 0;
+    uint64_t expected = 0; // Sequence the next group must carry, 0 before the first
+    std::vector<char> group;
+    while (offset + GROUP_HEADER_SIZE <= logSize)
+    {
+        char head[GROUP_HEADER_SIZE];
+        if (!readFully(logFd, head, GROUP_HEADER_SIZE, static_cast<off_t>(offset)) || memcmp(head, "WALG", 4) != 0)
+            break;
+        uint64_t sequence = 0;
+        uint32_t imageCount = 0, groupBlockSize = 0;
+        memcpy(&sequence, head + 4, sizeof(uint64_t));
+        memcpy(&imageCount, head + 12, sizeof(uint32_t));
+        memcpy(&groupBlockSize, head + 16, sizeof(uint32_t));
+        if (blockSize == 0) blockSize = groupBlockSize;
+        if (groupBlockSize == 0 || groupBlockSize != blockSize || imageCount == 0 || (expected != 0 && sequence != expected))
+            break;
+
+        const size_t entrySize = sizeof(uint32_t) + blockSize;
+        const uint64_t groupBytes = GROUP_HEADER_SIZE + static_cast<uint64_t>(imageCount) * entrySize + GROUP_TRAILER_SIZE;
+        if (offset + groupBytes > logSize)
+            break; // Torn by a crash mid-commit
+        group.resize(static_cast<size_t>(groupBytes));
+        if (!readFully(logFd, group.data(), group.size(), static_cast<off_t>(offset)))
+            break;
+        const char* trailer = group.data() + group.size() - GROUP_TRAILER_SIZE;
+        uint32_t storedChecksum = 0;
+        memcpy(&storedChecksum, trailer + 4, sizeof(uint32_t));
+        if (memcmp(trailer, "WALC", 4) != 0 || storedChecksum != checksumOf(group.data(), group.size() - 4))
+            break;
+
+        for (uint32_t i = 0; i < imageCount; ++i)
+        {
+            const char* entry = group.data() + GROUP_HEADER_SIZE + static_cast<size_t>(i) * entrySize;
+            uint32_t rbn = 0;
+            memcpy(&rbn, entry, sizeof(uint32_t));
+            const off_t blockOffset = static_cast<off_t>(headerSize) + static_cast<off_t>(rbn - 1) * blockSize;
+            if (rbn == 0 || !writeFully(dataFd, entry + sizeof(uint32_t), blockSize, blockOffset))
+            {
+                setError("Failed to replay RBN " + std::to_string(rbn) + " into the data file");
+                return false;
+            }
+            ++blocksRecovered;
+        }
+        expected = sequence + 1;
+        offset += groupBytes;
+    }
+
+    if (blocksRecovered > 0 && fsync(dataFd) != 0)
+    {
+        setError("Failed to sync replayed blocks");
+        return false;
+    }
+    // Empty the log durably so no group of this run can be followed by a stale one
+    if (ftruncate(logFd, 0) != 0 || fsync(logFd) != 0)
+    {
+        setError("Failed to empty write-ahead log");
+        return false;
+    }
+    return true;
+}
+
+bool WriteAheadLog::commit()
+{
+    operations = 0;
+    if (logFd < 0)
+    {
+        setError("Write-ahead log not open");
+        return false;
+    }
+    if (staged.empty()) return true;
+
+    std::vector<uint32_t> rbns;
+    rbns.reserve(staged.size());
+    for (const auto& entry : staged) rbns.push_back(entry.first);
+    std::sort(rbns.begin(), rbns.end());
+
+    uint64_t sequence = 0;
+    uint64_t offset = 0;
+    {
+        std::unique_lock<std::mutex> guard(walLock);
+        if (logBytes >= MAX_LOG_BYTES && !waitForCheckpoint(guard))
+            return false;
+        // Everything in the log is in the data file, start over at the front
+        if (appliedSequence == committedSequence && logBytes > 0 && !truncateLog())
+            return false;
+        sequence = committedSequence + 1;
+        offset = logBytes;
+    }
+
+    const size_t entrySize = sizeof(uint32_t) + blockSize;
+    const uint32_t imageCount = static_cast<uint32_t>(rbns.size());
+    std::vector<char> group(GROUP_HEADER_SIZE + rbns.size() * entrySize + GROUP_TRAILER_SIZE);
+    memcpy(group.data(), "WALG", 4);
+    memcpy(group.data() + 4, &sequence, sizeof(uint64_t));
+    memcpy(group.data() + 12, &imageCount, sizeof(uint32_t));
+    memcpy(group.data() + 16, &blockSize, sizeof(uint32_t));
+    char* entry = group.data() + GROUP_HEADER_SIZE;
+    for (const uint32_t rbn : rbns)
+    {
+        memcpy(entry, &rbn, sizeof(uint32_t));
+        memcpy(entry + sizeof(uint32_t), staged[rbn]->data(), blockSize);
+        entry += entrySize;
+    }
+    char* trailer = group.data() + group.size() - GROUP_TRAILER_SIZE;
+    memcpy(trailer, "WALC", 4);
+    const uint32_t checksum = checksumOf(group.data(), group.size() - 4);
+    memcpy(trailer + 4, &checksum, sizeof(uint32_t));
+
+    // One write and one fsync for the whole group
+    if (!writeFully(logFd, group.data(), group.size(), static_cast<off_t>(offset)) || fdatasync(logFd) != 0)
+    {
+        setError(std::string("Failed to write write-ahead log (") + std::strerror(errno) + ")");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(walLock);
+        logBytes = offset + group.size();
+        committedSequence = sequence;
+        for (auto& image : staged)
+            committed[image.first] = CommittedImage{std::move(image.second), sequence};
+        if (committed.size() >= CHECKPOINT_BLOCKS)
+            checkpointWake.notify_one();
+    }
+    staged.clear();
+    ++commits;
+    blocksLogged += imageCount;
+    return true;
+}
+
+bool WriteAheadLog::applyImages(const std::vector<std::pair<uint32_t, Image>>& images)
+{
+    for (const auto& image : images)
+    {
+        const off_t blockOffset = static_cast<off_t>(headerSize) + static_cast<off_t>(image.first - 1) * blockSize;
+        if (!writeFully(dataFd, image.second->data(), blockSize, blockOffset))
+            return false;
+    }
+    return fdatasync(dataFd) == 0;
+}
+
+bool WriteAheadLog::truncateLog()
+{
+    if (ftruncate(logFd, 0) != 0)
+    {
+        setError("Failed to empty write-ahead log");
+        return false;
+    }
+    logBytes = 0;
+    return true;
+}
+
+void WriteAheadLog::closeFiles()
+{
+    if (logFd >= 0)
+    {
+        ::close(logFd);
+        logFd = -1;
+    }
+    if (dataFd >= 0)
+    {
+        ::close(dataFd);
+        dataFd = -1;
+    }
+}
+
+bool WriteAheadLog::close()
+{
+    if (logFd < 0) return true;
+
+    bool ok = commit() && checkpoint();
+    stopCheckpointer();
+    if (ok)
+    {
+        std::lock_guard<std::mutex> guard(walLock);
+        ok = truncateLog() && fsync(logFd) == 0;
+    }
+    staged.clear();
+    committed.clear();
+    closeFiles();
+    return ok;
+}
+
+#else // !ZCD_HAS_MMAP
+
+bool WriteAheadLog::open(const std::string& dataFile, const uint32_t inBlockSize, const size_t inHeaderSize,
+                         const size_t inGroupSize)
+{
+    setError("Write-ahead logging is not supported on this platform: " + dataFile);
+    return false;
+}
+
+bool WriteAheadLog::replay()
+{
+    return false;
+}
+
+bool WriteAheadLog::commit()
+{
+    setError("Write-ahead log not open");
+    return false;
+}
+
+bool WriteAheadLog::applyImages(const std::vector<std::pair<uint32_t, Image>>& images)
+{
+    return false;
+}
+
+bool WriteAheadLog::truncateLog()
+{
+    return false;
+}
+
+void WriteAheadLog::closeFiles()
+{
+}
+
+bool WriteAheadLog::close()
+{
+    return true;
+}
+
+#endif // ZCD_HAS_MMAP
+
+void WriteAheadLog::stage(const uint32_t rbn, const char* image)
+{
+    staged[rbn] = std::make_shared<const std::vector<char>>(image, image + blockSize);
+}
+
+bool WriteAheadLog::lookup(const uint32_t rbn, char* image) const
+{
+    const auto stagedImage = staged.find(rbn);
+    if (stagedImage != staged.end())
+    {
+        memcpy(image, stagedImage->second->data(), blockSize);
+        return true;
+    }
+
+    std::lock_guard<std::mutex> guard(walLock);
+    const auto committedImage = committed.find(rbn);
+    if (committedImage == committed.end()) return false;
+    memcpy(image, committedImage->second.bytes->data(), blockSize);
+    return true;
+}
+
+bool WriteAheadLog::endOperation()
+{
+    return ++operations >= groupSize;
+}
+
+bool WriteAheadLog::checkpoint()
+{
+    std::unique_lock<std::mutex> guard(walLock);
+    return waitForCheckpoint(guard);
+}
+
+bool WriteAheadLog::waitForCheckpoint(std::unique_lock<std::mutex>& guard)
+{
+    if (!checkpointer.joinable())
+    {
+        setError("Checkpoint thread not running");
+        return false;
+    }
+    checkpointRequested = true;
+    checkpointFailed = false;
+    checkpointWake.notify_one();
+    checkpointDone.wait(guard, [this]
+    {
+        return !checkpointRequested && (appliedSequence == committedSequence || checkpointFailed);
+    });
+    if (checkpointFailed)
+    {
+        setError("Failed to write checkpoint to the data file");
+        return false;
+    }
+    return true;
+}
+
+void WriteAheadLog::runCheckpointer()
+{
+    std::unique_lock<std::mutex> guard(walLock);
+    while (true)
+    {
+        checkpointWake.wait(guard, [this]
+        {
+            return stopping || checkpointRequested || (!checkpointFailed && committed.size() >= CHECKPOINT_BLOCKS);
+        });
+        if (stopping) return;
+        checkpointRequested = false;
+
+        // Snapshot under the lock, write without it so commits keep going
+        const uint64_t target = committedSequence;
+        std::vector<std::pair<uint32_t, Image>> images;
+        images.reserve(committed.size());
+        for (const auto& image : committed) images.emplace_back(image.first, image.second.bytes);
+        guard.unlock();
+
+        std::sort(images.begin(), images.end(),
+            [](const std::pair<uint32_t, Image>& a, const std::pair<uint32_t, Image>& b)
+            {
+                return a.first < b.first;
+            });
+        const bool ok = images.empty() || applyImages(images);
+
+        guard.lock();
+        if (ok)
+        {
+            // Images committed again since the snapshot stay for the next checkpoint
+            for (auto it = committed.begin(); it != committed.end();)
+                it = (it->second.sequence <= target) ? committed.erase(it) : std::next(it);
+            appliedSequence = target;
+            ++checkpoints;
+        }
+        checkpointFailed = !ok;
+        checkpointDone.notify_all();
+    }
+}
+
+void WriteAheadLog::stopCheckpointer()
+{
+    if (!checkpointer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(walLock);
+        stopping = true;
+    }
+    checkpointWake.notify_one();
+    checkpointer.join();
+}
+
+bool WriteAheadLog::isOpen() const
+{
+    return logFd >= 0;
+}
+
+uint32_t WriteAheadLog::getBlocksRecovered() const
+{
+    return blocksRecovered;
+}
+
+uint64_t WriteAheadLog::getCommits() const
+{
+    return commits;
+}
+
+uint64_t WriteAheadLog::getBlocksLogged() const
+{
+    return blocksLogged;
+}
+
+uint64_t WriteAheadLog::getCheckpoints() const
+{
+    std::lock_guard<std::mutex> guard(walLock);
+    return checkpoints;
+}
+
+const std::string& WriteAheadLog::getLastError() const
+{
+    return lastError;
+}
+
+void WriteAheadLog::setError(const std::string& message)
+{
+    lastError = message;
+}
@@ -0,0 +1,239 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @file WriteAheadLog.h
+ * @author Group 2
+ * @brief WriteAheadLog class for making block mutations durable and atomic
+ * @version 0.1
+ * @date 2025-11-14
+ */
+
+/**
+ * @class WriteAheadLog
+ * @brief Redo log of full block images kept next to a blocked file
+ * @details While the log is open the data file is only written by checkpoints. Block
+ *          images written back by the buffer pool are staged in memory, and once enough
+ *          operations have completed they are appended to the log as one group and made
+ *          durable with a single fsync (group commit). A background thread then copies
+ *          committed images into the data file, fsyncs it, and the log is emptied once
+ *          every committed group has been applied.
+ *
+ *          Because only whole operations are committed, a split or merge reaches the
+ *          data file completely or not at all. Opening the log replays every complete
+ *          group left by a crash, a torn group at the end is ignored.
+ *
+ *          Log layout, one entry per commit group:
+ *            magic "WALG" | sequence (8) | imageCount (4) | blockSize (4)
+ *            imageCount x { rbn (4) | block image (blockSize) }
+ *            magic "WALC" | checksum (4) over everything before it
+ *          Sequences of consecutive groups increase by one, replay stops at the first
+ *          group that is incomplete, fails its checksum or breaks the sequence.
+ *          The writer holds an exclusive flock on the log, a log nobody holds is left
+ *          over from a crash and only the next writer to open it replays it. Readers
+ *          never do, emptying it behind that writer would hide the crash from it.
+ *          Without POSIX file APIs open() fails and blocks are written directly.
+ */
+class WriteAheadLog
+{
+public:
+    static const size_t DEFAULT_GROUP_SIZE = 32; // Operations committed with one fsync
+    static const size_t CHECKPOINT_BLOCKS = 256; // Committed images that wake the checkpointer
+    static const uint64_t MAX_LOG_BYTES = 64ULL << 20; // Commits wait for a checkpoint past this
+
+    /**
+     * @brief Default constructor
+     */
+    WriteAheadLog();
+
+    /**
+     * @brief Destructor
+     * @details Stops the checkpointer without committing staged images
+     */
+    ~WriteAheadLog();
+
+    /**
+     * @brief Companion file name used for a blocked file
+     * @param zcbFilePath [IN] Path to the blocked sequence set file
+     * @return zcbFilePath with ".wal" appended
+     */
+    static std::string pathFor(const std::string& zcbFilePath);
+
+    /**
+     * @brief Open the log of a blocked file, replaying any groups left by a crash
+     * @details Replayed images are written to the data file and fsynced before the log
+     *          is emptied, see getBlocksRecovered. Starts the checkpoint thread.
+     * @param dataFile [IN] Path to the blocked file
+     * @param blockSize [IN] Bytes per block
+     * @param headerSize [IN] Bytes before RBN 1
+     * @param groupSize [IN] Operations per commit group (at least 1)
+     * @return True if the log is ready
+     */
+    bool open(const std::string& dataFile, const uint32_t blockSize, const size_t headerSize,
+              const size_t groupSize = DEFAULT_GROUP_SIZE);
+
+    /**
+     * @brief Stage the newest image of a block, durable at the next commit
+     * @param rbn [IN] Block the image belongs to
+     * @param image [IN] blockSize bytes
+     */
+    void stage(const uint32_t rbn, const char* image);
+
+    /**
+     * @brief Copy the newest image of a block not yet in the data file
+     * @param rbn [IN] Block to look for
+     * @param image [OUT] blockSize bytes, untouched if the block is not held by the log
+     * @return True if the log held an image
+     */
+    bool lookup(const uint32_t rbn, char* image) const;
+
+    /**
+     * @brief Count a completed operation
+     * @return True if the group is full and should be committed
+     */
+    bool endOperation();
+
+    /**
+     * @brief Append the staged images as one group and fsync the log
+     * @return True if the group is durable (also true when nothing was staged)
+     */
+    bool commit();
+
+    /**
+     * @brief Wait until every committed group is in the data file
+     * @return True if the checkpoint succeeded
+     */
+    bool checkpoint();
+
+    /**
+     * @brief Commit, checkpoint, empty the log and stop the checkpointer
+     * @return True if everything reached the data file
+     */
+    bool close();
+
+    /**
+     * @brief Check if the log is open
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Blocks replayed from the log by open()
+     */
+    uint32_t getBlocksRecovered() const;
+
+    /**
+     * @brief Groups committed since open
+     */
+    uint64_t getCommits() const;
+
+    /**
+     * @brief Block images appended to the log since open
+     */
+    uint64_t getBlocksLogged() const;
+
+    /**
+     * @brief Checkpoints completed since open
+     */
+    uint64_t getCheckpoints() const;
+
+    /**
+     * @brief Get description of last error
+     */
+    const std::string& getLastError() const;
+
+private:
+    using Image = std::shared_ptr<const std::vector<char>>;
+
+    /**
+     * @struct CommittedImage
+     * @brief Image that is durable in the log but maybe not yet in the data file
+     */
+    struct CommittedImage
+    {
+        Image bytes; // Block image
+        uint64_t sequence; // Group that committed it
+    };
+
+    int logFd; // Log file descriptor
+    int dataFd; // Data file descriptor used by replay and checkpoints
+    uint32_t blockSize; // Bytes per block
+    size_t headerSize; // Bytes before RBN 1
+    size_t groupSize; // Operations per commit group
+    size_t operations; // Operations completed since the last commit
+
+    std::unordered_map<uint32_t, Image> staged; // Images not yet committed, owner thread only
+    std::unordered_map<uint32_t, CommittedImage> committed; // Images not yet checkpointed
+
+    std::thread checkpointer; // Background checkpoint thread
+    mutable std::mutex walLock; // Guards committed and everything below
+    std::condition_variable checkpointWake; // Wakes the checkpointer
+    std::condition_variable checkpointDone; // Signals a finished checkpoint
+    bool stopping; // Checkpointer should exit
+    bool checkpointRequested; // A caller is waiting for a checkpoint
+    bool checkpointFailed; // The last checkpoint could not write the data file
+    uint64_t committedSequence; // Last group made durable
+    uint64_t appliedSequence; // Last group written to the data file
+    uint64_t logBytes; // Bytes in the log
+
+    uint32_t blocksRecovered; // Blocks replayed by open
+    uint64_t commits; // Groups committed since open
+    uint64_t blocksLogged; // Images appended since open
+    uint64_t checkpoints; // Checkpoints completed since open, guarded by walLock
+    std::string lastError; // Last error message
+
+    /**
+     * @brief Apply every complete group in the log to the data file and empty the log
+     * @return False if the data file could not be written
+     */
+    bool replay();
+
+    /**
+     * @brief Checkpoint thread body
+     */
+    void runCheckpointer();
+
+    /**
+     * @brief Write a snapshot of the committed images to the data file and fsync it
+     * @return True on success
+     */
+    bool applyImages(const std::vector<std::pair<uint32_t, Image>>& images);
+
+    /**
+     * @brief Ask the checkpointer to apply every committed group and wait for it
+     * @param guard [IN] Held lock on walLock
+     * @return True if the data file caught up with the log
+     */
+    bool waitForCheckpoint(std::unique_lock<std::mutex>& guard);
+
+    /**
+     * @brief Empty the log file, walLock must be held and every group applied
+     */
+    bool truncateLog();
+
+    /**
+     * @brief Stop and join the checkpoint thread if it is running
+     */
+    void stopCheckpointer();
+
+    /**
+     * @brief Close both descriptors
+     */
+    void closeFiles();
+
+    /**
+     * @brief Set error message
+     */
+    void setError(const std::string& message);
+};
+
+#endif // WRITE_AHEAD_LOG_H
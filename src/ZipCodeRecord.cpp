@@ -207,82 +207,69 @@ std::ostream& operator<<(std::ostream& outputStream, const ZipCodeRecord& record
 
  std::vector<uint8_t> ZipCodeRecord::serialize() const
  {
-    std::vector<uint8_t> data; // Stores the binary data
-
-    // Zip Code
-    data.insert(data.end(), reinterpret_cast<const uint8_t*>(&zipCode),
-                reinterpret_cast<const uint8_t*>(&zipCode) + sizeof(zipCode));
-
-    // Location Name Length
-    uint16_t locationNameLength = locationName.length();
-    data.insert(data.end(), reinterpret_cast<const uint8_t*>(&locationNameLength),
-                reinterpret_cast<const uint8_t*>(&locationNameLength) + sizeof(locationNameLength));
-    // Location Name
-    data.insert(data.end(), locationName.begin(), locationName.end());
-    
-    // County Name Length
-    uint16_t countyLength = county.length();
-    data.insert(data.end(), reinterpret_cast<const uint8_t*>(&countyLength),
-                reinterpret_cast<const uint8_t*>(&countyLength) + sizeof(countyLength));
-    // County Name
-    data.insert(data.end(), county.begin(), county.end());
-
-    // State
-    data.insert(data.end(), state, state + 3);
-
-    // Latitude
-    data.insert(data.end(), reinterpret_cast<const uint8_t*>(&latitude),
-                reinterpret_cast<const uint8_t*>(&latitude) + sizeof(latitude));
-
-    // Longitude
-    data.insert(data.end(), reinterpret_cast<const uint8_t*>(&longitude),
-                reinterpret_cast<const uint8_t*>(&longitude) + sizeof(longitude));
-
+    std::vector<uint8_t> data(getSerializedSize()); // Stores the binary data
+    serializeTo(data.data());
     return data;
  }
 
+ void ZipCodeRecord::serializeTo(uint8_t* out) const
+ {
+    const uint16_t locationNameLength = static_cast<uint16_t>(locationName.length());
+    const uint16_t countyLength = static_cast<uint16_t>(county.length());
+
+    // Fixed header
+    memcpy(out, &zipCode, sizeof(zipCode));
+    memcpy(out + 4, &latitude, sizeof(latitude));
+    memcpy(out + 12, &longitude, sizeof(longitude));
+    memcpy(out + 20, state, 2);
+    memcpy(out + 22, &locationNameLength, sizeof(locationNameLength));
+    memcpy(out + 24, &countyLength, sizeof(countyLength));
+
+    // Names
+    memcpy(out + SERIALIZED_HEADER_SIZE, locationName.data(), locationNameLength);
+    memcpy(out + SERIALIZED_HEADER_SIZE + locationNameLength, county.data(), countyLength);
+ }
+
  ZipCodeRecord ZipCodeRecord::deserialize(const uint8_t* data, size_t length)
  {
     ZipCodeRecord record;
-    size_t offset = 0;
-
-    // Read Zipcode
-    memcpy(&record.zipCode, data + offset, sizeof(int));
-    offset += sizeof(int);
-
-    // Read Location Name Length
-    uint16_t locationNameLength;
-    memcpy(&locationNameLength, data + offset, sizeof(uint16_t));
-    offset += sizeof(uint16_t);
-
-    // Read Location Name
-    record.locationName = std::string(reinterpret_cast<const char*>(data + offset), locationNameLength);
-    offset += locationNameLength;
-
-    // Read County Name Length
-    uint16_t countyNameLength;
-    memcpy(&countyNameLength, data + offset, sizeof(uint16_t));
-    offset += sizeof(uint16_t);
-
-    // Read County Name
-    record.county = std::string(reinterpret_cast<const char*>(data + offset), countyNameLength);
-    offset += countyNameLength;
-
-    // Read State
-    memcpy(record.state, data + offset, 3);
-    offset += 3;
-
-    // Read Latitude
-    memcpy(&record.latitude, data + offset, sizeof(double));
-    offset += sizeof(double);
-
-    // Read Longitude
-    memcpy(&record.longitude, data + offset, sizeof(double));
-    offset += sizeof(double);
+    if (length < SERIALIZED_HEADER_SIZE)
+        return record;
+
+    uint16_t locationNameLength, countyLength;
+    memcpy(&locationNameLength, data + 22, sizeof(locationNameLength));
+    memcpy(&countyLength, data + 24, sizeof(countyLength));
+    if (length < SERIALIZED_HEADER_SIZE + locationNameLength + countyLength)
+        return record;
+
+    // Read fixed header
+    memcpy(&record.zipCode, data, sizeof(uint32_t));
+    memcpy(&record.latitude, data + 4, sizeof(double));
+    memcpy(&record.longitude, data + 12, sizeof(double));
+    memcpy(record.state, data + 20, 2);
+    record.state[2] = '\0';
+
+    // Read names
+    const char* names = reinterpret_cast<const char*>(data + SERIALIZED_HEADER_SIZE);
+    record.locationName.assign(names, locationNameLength);
+    record.county.assign(names + locationNameLength, countyLength);
 
     return record;
  }
 
+uint32_t ZipCodeRecord::getSerializedSize() const
+{
+    return SERIALIZED_HEADER_SIZE + static_cast<uint32_t>(locationName.length() + county.length());
+}
+
+uint32_t ZipCodeRecord::serializedNamesLength(const uint8_t* data)
+{
+    uint16_t locationNameLength, countyLength;
+    memcpy(&locationNameLength, data + 22, sizeof(locationNameLength));
+    memcpy(&countyLength, data + 24, sizeof(countyLength));
+    return static_cast<uint32_t>(locationNameLength) + countyLength;
+}
+
 uint32_t ZipCodeRecord::getRecordSize() const
 {
     std::string recordStr = std::to_string(zipCode) + "," +
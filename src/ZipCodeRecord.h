@@ -179,19 +179,41 @@ public:
      */
     friend std::ostream& operator<<(std::ostream& outputStream, const ZipCodeRecord& record);
     
+    static const uint32_t SERIALIZED_HEADER_SIZE = 26; // Fixed part of the binary format
+
     /**
      * @brief Serialize
+     * @details Binary format: a fixed 26 byte header followed by the two names
+     *          zipCode (4) | latitude (8) | longitude (8) | state (2) | locationNameLength (2) | countyLength (2)
+     *          locationName | county
      * @return Serializes the Zipcode record represented by the ZipCodeRecord and returns that as a uint8_t vector
      */
     std::vector<uint8_t> serialize() const; // Convert to binary format
+    /**
+     * @brief Serialize into a caller provided buffer
+     * @param out [OUT] At least getSerializedSize() bytes
+     */
+    void serializeTo(uint8_t* out) const;
     /**
      * @brief deserialize
      * @param data the serialized ZipCodeRecord
      * @param length the length of data
-     * @return converts data into a ZipCodeRecord and returns that
+     * @return converts data into a ZipCodeRecord and returns that (zip code 0 if data is too short)
      */
     static ZipCodeRecord deserialize(const uint8_t* data, size_t length); // Read from binary format
 
+    /**
+     * @brief Get the size of the binary format of this record
+     * @return Bytes serialize() produces
+     */
+    uint32_t getSerializedSize() const;
+
+    /**
+     * @brief Bytes of names that follow the fixed header of a serialized record
+     * @param data [IN] At least SERIALIZED_HEADER_SIZE bytes of a serialized record
+     */
+    static uint32_t serializedNamesLength(const uint8_t* data);
+
     /**
      * @brief Get the total size of the variable length ZipCodeRecord
      * @return Size of the ZipCodeRecord as uint32_t
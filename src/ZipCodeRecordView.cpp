@@ -0,0 +1,168 @@
+#include "ZipCodeRecordView.h"
+#include "Block.h"
+#include "RecordBuffer.h"
+#include "RecordTokenizer.h"
+#include <cstring>
+#include <string>
+
+ZipCodeRecordView::ZipCodeRecordView()
+    : data(nullptr), length(0), binary(false), fields(),
+      numbersDecoded(false), zipCode(0), latitude(0.0), longitude(0.0)
+{
+}
+
+bool ZipCodeRecordView::reset(const char* inData, const uint32_t inLength, const bool inBinary)
+{
+    data = nullptr;
+    length = 0;
+    numbersDecoded = false;
+
+    if (inBinary)
+    {
+        if (inLength < ZipCodeRecord::SERIALIZED_HEADER_SIZE) return false;
+        uint16_t placeLength, countyLength;
+        std::memcpy(&placeLength, inData + 22, sizeof(placeLength));
+        std::memcpy(&countyLength, inData + 24, sizeof(countyLength));
+        if (inLength < ZipCodeRecord::SERIALIZED_HEADER_SIZE + placeLength + countyLength) return false;
+
+        const char* names = inData + ZipCodeRecord::SERIALIZED_HEADER_SIZE;
+        fields[PLACE] = std::string_view(names, placeLength);
+        fields[STATE] = std::string_view(inData + 20, strnlen(inData + 20, 2));
+        fields[COUNTY] = std::string_view(names + placeLength, countyLength);
+    }
+    else
+    {
+        // Exactly six fields, split like every other parser of record text
+        size_t fieldCount = 0;
+        const std::string_view text(inData, inLength);
+        if (RecordTokenizer::splitRecord(text, fields, FIELD_COUNT, fieldCount) != inLength ||
+            fieldCount != FIELD_COUNT)
+            return false;
+    }
+
+    data = inData;
+    length = inLength;
+    binary = inBinary;
+    return true;
+}
+
+void ZipCodeRecordView::decodeNumbers() const
+{
+    if (numbersDecoded) return;
+    numbersDecoded = true;
+    zipCode = 0;
+    latitude = 0.0;
+    longitude = 0.0;
+    if (data == nullptr) return;
+
+    if (binary)
+    {
+        std::memcpy(&zipCode, data, sizeof(zipCode));
+        std::memcpy(&latitude, data + 4, sizeof(latitude));
+        std::memcpy(&longitude, data + 12, sizeof(longitude));
+        return;
+    }
+
+    const std::string_view& zip = fields[ZIP];
+    const std::string_view& lat = fields[LATITUDE];
+    const std::string_view& lon = fields[LONGITUDE];
+    RecordTokenizer::parseUInt32(zip, zipCode);
+    RecordTokenizer::parseDouble(lat, latitude);
+    RecordTokenizer::parseDouble(lon, longitude);
+}
+
+uint32_t ZipCodeRecordView::getZipCode() const
+{
+    decodeNumbers();
+    return zipCode;
+}
+
+double ZipCodeRecordView::getLatitude() const
+{
+    decodeNumbers();
+    return latitude;
+}
+
+double ZipCodeRecordView::getLongitude() const
+{
+    decodeNumbers();
+    return longitude;
+}
+
+std::string_view ZipCodeRecordView::getLocationName() const
+{
+    return fields[PLACE];
+}
+
+std::string_view ZipCodeRecordView::getState() const
+{
+    return fields[STATE];
+}
+
+std::string_view ZipCodeRecordView::getCounty() const
+{
+    return fields[COUNTY];
+}
+
+ZipCodeRecord ZipCodeRecordView::toRecord() const
+{
+    if (data == nullptr) return ZipCodeRecord();
+    if (binary)
+        return ZipCodeRecord::deserialize(reinterpret_cast<const uint8_t*>(data), length);
+
+    return ZipCodeRecord(static_cast<int>(getZipCode()), getLatitude(), getLongitude(),
+                         std::string(fields[PLACE]), std::string(fields[STATE]), std::string(fields[COUNTY]));
+}
+
+BlockRecordIterator::BlockRecordIterator(const char* blockData, const size_t blockDataSize)
+    : data(blockData), size(blockData ? blockDataSize : 0), offset(0),
+      slotted(SlottedPage::isSlotted(blockData, blockDataSize)), slotCount(0), slotIndex(0),
+      errorState(false)
+{
+    if (slotted)
+        std::memcpy(&slotCount, data + 4, sizeof(slotCount));
+}
+
+bool BlockRecordIterator::next(ZipCodeRecordView& view)
+{
+    if (errorState) return false;
+
+    if (slotted)
+    {
+        if (slotIndex >= slotCount) return false;
+        const char* slot = data + SlottedPage::HEADER_SIZE + slotIndex * SlottedPage::SLOT_SIZE;
+        uint16_t recordOffset, recordLength;
+        std::memcpy(&recordOffset, slot + 4, sizeof(recordOffset));
+        std::memcpy(&recordLength, slot + 6, sizeof(recordLength));
+        ++slotIndex;
+        if (recordOffset + recordLength > size || !view.reset(data + recordOffset, recordLength, true))
+        {
+            errorState = true;
+            return false;
+        }
+        return true;
+    }
+
+    // Same framing as RecordBuffer::unpackBlock: stop at padding or a prefix that runs off the block
+    if (offset + 4 > size || data[offset] == '\xFF') return false;
+
+    uint32_t lengthPrefix;
+    std::memcpy(&lengthPrefix, data + offset, sizeof(lengthPrefix));
+    const bool binary = (lengthPrefix & RecordBuffer::BINARY_RECORD_FLAG) != 0;
+    lengthPrefix &= ~RecordBuffer::BINARY_RECORD_FLAG;
+    if (lengthPrefix == 0 || offset + 4 + lengthPrefix > size) return false;
+
+    const char* record = data + offset + 4;
+    offset += 4 + lengthPrefix;
+    if (!view.reset(record, lengthPrefix, binary))
+    {
+        errorState = true;
+        return false;
+    }
+    return true;
+}
+
+bool BlockRecordIterator::hasError() const
+{
+    return errorState;
+}
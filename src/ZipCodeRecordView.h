@@ -0,0 +1,137 @@
+#ifndef ZIP_CODE_RECORD_VIEW_H
+#define ZIP_CODE_RECORD_VIEW_H
+
+#include "stdint.h"
+#include <cstddef>
+#include <string_view>
+#include "ZipCodeRecord.h"
+
+/**
+ * @file ZipCodeRecordView.h
+ * @author Group 2
+ * @brief ZipCodeRecordView and BlockRecordIterator for reading records in place
+ * @version 0.1
+ * @date 2025-11-10
+ */
+
+/**
+ * @class ZipCodeRecordView
+ * @brief Read only view of one record inside a block
+ * @details Points into the block bytes (a file mapping, a buffer pool frame or an
+ *          ActiveBlock's data) and owns nothing, so it is only valid as long as those
+ *          bytes are. Text fields are string_views. Numeric fields are decoded on first
+ *          use. Works for both text and binary records.
+ */
+class ZipCodeRecordView
+{
+public:
+    /**
+     * @brief Default constructor
+     * @details The view is empty until reset() succeeds
+     */
+    ZipCodeRecordView();
+
+    /**
+     * @brief Point the view at a record image
+     * @param data [IN] First byte of the record, after its length prefix
+     * @param length [IN] Bytes in the record
+     * @param binary [IN] True for a ZipCodeRecord::serialize() image, false for CSV text
+     * @return False if the image is malformed, the view is then empty
+     */
+    bool reset(const char* data, const uint32_t length, const bool binary);
+
+    /**
+     * @brief Zipcode Getter
+     * @return zipcode
+     */
+    uint32_t getZipCode() const;
+    /**
+     * @brief Latitude Getter
+     * @return latitude
+     */
+    double getLatitude() const;
+    /**
+     * @brief Longitude Getter
+     * @return longitude
+     */
+    double getLongitude() const;
+    /**
+     * @brief Location Name Getter
+     * @return locationName, pointing into the block
+     */
+    std::string_view getLocationName() const;
+    /**
+     * @brief State Code Getter
+     * @return state, pointing into the block
+     */
+    std::string_view getState() const;
+    /**
+     * @brief County Name Getter
+     * @return county, pointing into the block
+     */
+    std::string_view getCounty() const;
+
+    /**
+     * @brief Copy the viewed record into an owning ZipCodeRecord
+     * @return The record
+     */
+    ZipCodeRecord toRecord() const;
+
+private:
+    enum Field { ZIP = 0, PLACE, STATE, COUNTY, LATITUDE, LONGITUDE, FIELD_COUNT };
+
+    const char* data; // Record bytes, not owned
+    uint32_t length; // Bytes at data
+    bool binary; // Binary image rather than CSV text
+    std::string_view fields[FIELD_COUNT]; // Text fields (trimmed), binary uses PLACE, STATE and COUNTY only
+
+    mutable bool numbersDecoded; // zipCode, latitude and longitude are valid
+    mutable uint32_t zipCode; // Decoded zip code
+    mutable double latitude; // Decoded latitude
+    mutable double longitude; // Decoded longitude
+
+    /**
+     * @brief Decode the numeric fields on first use
+     */
+    void decodeNumbers() const;
+};
+
+/**
+ * @class BlockRecordIterator
+ * @brief Walks the records of a block's data region yielding views
+ * @details Handles length prefixed text and binary records and slotted pages, in key
+ *          order. Nothing is allocated per record.
+ */
+class BlockRecordIterator
+{
+public:
+    /**
+     * @brief Constructor
+     * @param blockData [IN] Start of the block data region
+     * @param blockDataSize [IN] Number of bytes in the data region
+     */
+    BlockRecordIterator(const char* blockData, const size_t blockDataSize);
+
+    /**
+     * @brief Move to the next record
+     * @param view [OUT] View of the record
+     * @return False at the end of the block or on a malformed record
+     */
+    bool next(ZipCodeRecordView& view);
+
+    /**
+     * @brief Check if iteration stopped on a malformed record
+     */
+    bool hasError() const;
+
+private:
+    const char* data; // Block data region, not owned
+    size_t size; // Bytes at data
+    size_t offset; // Next length prefix (length prefixed blocks)
+    bool slotted; // Block is a slotted page
+    uint16_t slotCount; // Slots in a slotted page
+    uint16_t slotIndex; // Next slot (slotted pages)
+    bool errorState; // Stopped on a malformed record
+};
+
+#endif // ZIP_CODE_RECORD_VIEW_H